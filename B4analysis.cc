@@ -0,0 +1,611 @@
+/// \file B4analysis.cc
+/// \brief Post-processing tool of the B4c columnar files
+///
+/// It replaces plotHisto.C for the scans: the columnar files of all the
+/// threads of a run (B4_t<N>.b4col, and the parts B4_t<N>_g<G>_p<K>.b4col
+/// written at the checkpoints of an interrupted and resumed run) are
+/// memory-mapped and scanned in a
+/// single parallel pass, which computes the diode, annular and collective
+/// efficiencies, the fraction of partial depositors and the energy spectra.
+/// One row per scan point is appended to the result table, with binomial
+/// errors and the collective efficiency counting a deposit in either
+/// detector, and the spectra to the spectra file. The efficiencies are also
+/// appended to the files written by plotHisto.C, with its definitions, so
+/// that the existing plots are unchanged.
+///
+/// With a source activity (-a), the events are also overlaid in time: each
+/// event gets the timestamp of a Poisson process, and the deposits of each
+/// detector are streamed through a pile-up and dead-time model, which gives
+/// the rate-dependent spectra and the live-time efficiencies.
+///
+/// It does not depend on Geant4 nor ROOT.
+
+#include "ColumnarFormat.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace {
+
+constexpr int kMaxSlots = 257;           // as B4c::RunProgress
+constexpr int kNofBins = 1000;           // as the Ediode/Eannular histograms
+constexpr double kMaxEnergy = 10.;       // MeV
+constexpr double kFullEnergyTolerance = 1.e-6;  // MeV, as B4c::EventAction
+constexpr std::uint64_t kChunkSize = 1 << 18;  // rows per task
+constexpr int kNofDetectors = 2;         // diode, annular
+
+void PrintUsage() {
+  std::cerr << " Usage: " << std::endl;
+  std::cerr << " B4analysis [-l label] [-t nThreads] [-p prefix] [-o table]"
+            << " [-s spectra]" << std::endl;
+  std::cerr << "            [-a activity(Bq) [-w shaping(us)] [-d deadTime(us)] [-r seed]]"
+            << " [files...]" << std::endl;
+  std::cerr << "   default: the files <prefix>_t<N>.b4col and their checkpoint parts" << std::endl;
+  std::cerr << "   <prefix>_t<N>_g<G>_p<K>.b4col, of prefix B4," << std::endl;
+  std::cerr << "   table scan_results.dat, spectra scan_spectra.dat," << std::endl;
+  std::cerr << "   no pile-up overlay, shaping 2 us, dead time 10 us" << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// one memory-mapped columnar file
+struct MappedFile {
+  std::string name;
+  void* data = nullptr;
+  std::size_t size = 0;
+  std::uint64_t nofRows = 0;
+  const double* ediode = nullptr;
+  const double* eannular = nullptr;
+  const double* eprimary = nullptr;
+};
+
+// parameters of the pile-up overlay
+struct Overlay {
+  double activity = 0.;     // 1/s, 0 = no overlay
+  double shaping = 2.e-6;   // s, pulses closer than this are summed
+  double deadTime = 10.e-6; // s, non-paralysable, from the first pulse
+  std::uint64_t seed = 12345;
+};
+
+// pile-up counts of one detector
+struct PileupCounts {
+  std::uint64_t pulses = 0;     // events with a deposit
+  std::uint64_t recorded = 0;   // pulses (or sums of pulses) recorded
+  std::uint64_t piledUp = 0;    // recorded sums of more than one pulse
+  std::uint64_t lost = 0;       // pulses lost in the dead time
+  double busyTime = 0.;         // s
+  std::vector<std::uint64_t> spectrum = std::vector<std::uint64_t>(kNofBins);
+
+  void Add(const PileupCounts& other) {
+    pulses += other.pulses;
+    recorded += other.recorded;
+    piledUp += other.piledUp;
+    lost += other.lost;
+    busyTime += other.busyTime;
+    for ( int i=0; i<kNofBins; ++i ) spectrum[i] += other.spectrum[i];
+  }
+};
+
+// counts of one thread, merged at the end
+struct Accumulator {
+  std::uint64_t events = 0;
+  std::uint64_t diode = 0;
+  std::uint64_t annular = 0;
+  std::uint64_t collective = 0;
+  std::uint64_t fullEnergy = 0;
+  std::vector<std::uint64_t> diodeSpectrum = std::vector<std::uint64_t>(kNofBins);
+  std::vector<std::uint64_t> annularSpectrum = std::vector<std::uint64_t>(kNofBins);
+  double streamTime = 0.;   // s, of the pile-up overlay
+  PileupCounts pileup[kNofDetectors];
+
+  void Add(const Accumulator& other) {
+    events += other.events;
+    diode += other.diode;
+    annular += other.annular;
+    collective += other.collective;
+    fullEnergy += other.fullEnergy;
+    for ( int i=0; i<kNofBins; ++i ) {
+      diodeSpectrum[i] += other.diodeSpectrum[i];
+      annularSpectrum[i] += other.annularSpectrum[i];
+    }
+    streamTime += other.streamTime;
+    for ( int i=0; i<kNofDetectors; ++i ) pileup[i].Add(other.pileup[i]);
+  }
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Pile-up and dead time of one detector. The pulses of the current shaping
+// window are kept in a ring buffer sized to the number of pulses expected
+// in the window; when the next pulse falls outside the window, they are
+// summed into one recorded pulse. The detector stays busy for the longer of
+// the shaping and the dead time after the first pulse of a window.
+class PileupChannel
+{
+  public:
+    PileupChannel(const Overlay& overlay, PileupCounts& counts)
+      : fShaping(overlay.shaping),
+        fBusyTime(std::max(overlay.shaping, overlay.deadTime)),
+        fCounts(counts)
+    {
+      // mean number of pulses in a window, with a wide margin
+      auto capacity = std::size_t(8.*overlay.activity*overlay.shaping) + 16;
+      std::size_t size = 1;
+      while ( size < capacity ) size <<= 1;
+      fRing.resize(size);
+    }
+
+    void Add(double time, double energy) {
+      if ( energy <= 0. ) return;
+      ++fCounts.pulses;
+
+      if ( fCount > 0 && time - fTrigger >= fShaping ) Close();
+      if ( fCount == 0 ) {
+        if ( time < fBusyUntil ) {
+          ++fCounts.lost;
+          return;
+        }
+        fTrigger = time;
+        fBusyUntil = time + fBusyTime;
+        fCounts.busyTime += fBusyTime;
+      }
+      if ( fCount == fRing.size() ) {
+        ++fCounts.lost;
+        return;
+      }
+      fRing[(fHead + fCount) & (fRing.size() - 1)] = energy;
+      ++fCount;
+    }
+
+    void Close() {
+      if ( fCount == 0 ) return;
+
+      double sum = 0.;
+      for ( std::size_t i=0; i<fCount; ++i ) sum += fRing[(fHead + i) & (fRing.size() - 1)];
+      fHead = (fHead + fCount) & (fRing.size() - 1);
+
+      ++fCounts.recorded;
+      if ( fCount > 1 ) ++fCounts.piledUp;
+      auto bin = std::uint64_t(sum*kNofBins/kMaxEnergy);
+      if ( bin < kNofBins ) ++fCounts.spectrum[bin];
+      fCount = 0;
+    }
+
+  private:
+    double fShaping;
+    double fBusyTime;
+    PileupCounts& fCounts;
+    std::vector<double> fRing;   // energies, size a power of 2
+    std::size_t fHead = 0;
+    std::size_t fCount = 0;
+    double fTrigger = 0.;
+    double fBusyUntil = 0.;
+};
+
+// a range of rows of one file
+struct Task {
+  const MappedFile* file;
+  std::uint64_t begin;
+  std::uint64_t end;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const double* FindColumn(const MappedFile& file, const B4c::Columnar::ColumnHeader* columns,
+                         std::uint32_t nofColumns, const char* name)
+{
+  for ( std::uint32_t i=0; i<nofColumns; ++i ) {
+    const auto& column = columns[i];
+    if ( std::strncmp(column.name, name, sizeof(column.name)) != 0 ) continue;
+
+    if ( column.type != B4c::Columnar::kFloat64 ||
+         column.offset % B4c::Columnar::kAlignment != 0 ||
+         column.size != file.nofRows*sizeof(double) ||
+         column.offset + column.size > file.size ) {
+      std::cerr << file.name << ": invalid column " << name << std::endl;
+      return nullptr;
+    }
+    return reinterpret_cast<const double*>(static_cast<const char*>(file.data) + column.offset);
+  }
+  std::cerr << file.name << ": column " << name << " not found" << std::endl;
+  return nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool MapFile(const std::string& name, MappedFile& file)
+{
+  using namespace B4c::Columnar;
+
+  file.name = name;
+  int fd = open(name.c_str(), O_RDONLY);
+  if ( fd < 0 ) return false;
+
+  struct stat status;
+  if ( fstat(fd, &status) != 0 || std::size_t(status.st_size) < sizeof(FileHeader) ) {
+    close(fd);
+    std::cerr << name << ": not a columnar file" << std::endl;
+    return false;
+  }
+  file.size = status.st_size;
+  file.data = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ( file.data == MAP_FAILED ) {
+    file.data = nullptr;
+    std::cerr << name << ": cannot map the file" << std::endl;
+    return false;
+  }
+
+  // sequential scan of the columns
+  madvise(file.data, file.size, MADV_SEQUENTIAL);
+
+  auto header = static_cast<const FileHeader*>(file.data);
+  auto columns = reinterpret_cast<const ColumnHeader*>(header + 1);
+  if ( ! HasMagic(*header) || header->version != kVersion ||
+       sizeof(FileHeader) + header->nofColumns*sizeof(ColumnHeader) > file.size ) {
+    std::cerr << name << ": not a columnar file of version " << kVersion << std::endl;
+    return false;
+  }
+
+  file.nofRows = header->nofRows;
+  file.ediode = FindColumn(file, columns, header->nofColumns, "Ediode");
+  file.eannular = FindColumn(file, columns, header->nofColumns, "Eannular");
+  file.eprimary = FindColumn(file, columns, header->nofColumns, "Eprimary");
+  return file.ediode && file.eannular && file.eprimary;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// the events of a task are an independent Poisson stream, with its own
+// seed, so that the results do not depend on the number of threads
+void ProcessOverlay(const Task& task, std::size_t taskIndex, const Overlay& overlay,
+                    Accumulator& accumulator)
+{
+  std::mt19937_64 engine(overlay.seed + 0x9e3779b97f4a7c15ULL*(taskIndex + 1));
+  std::exponential_distribution<double> interval(overlay.activity);
+
+  PileupChannel diode(overlay, accumulator.pileup[0]);
+  PileupChannel annular(overlay, accumulator.pileup[1]);
+
+  double time = 0.;
+  for ( std::uint64_t i=task.begin; i<task.end; ++i ) {
+    time += interval(engine);
+    diode.Add(time, task.file->ediode[i]);
+    annular.Add(time, task.file->eannular[i]);
+  }
+  diode.Close();
+  annular.Close();
+  accumulator.streamTime += time;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Process(const Task& task, Accumulator& accumulator)
+{
+  const double* ediode = task.file->ediode;
+  const double* eannular = task.file->eannular;
+  const double* eprimary = task.file->eprimary;
+  const double binsPerMeV = kNofBins/kMaxEnergy;
+
+  // branch-free counts, the compiler vectorises this loop
+  std::uint64_t diode = 0, annular = 0, collective = 0, fullEnergy = 0;
+  for ( std::uint64_t i=task.begin; i<task.end; ++i ) {
+    bool hitDiode = ediode[i] > 0.;
+    bool hitAnnular = eannular[i] > 0.;
+    diode += hitDiode;
+    annular += hitAnnular;
+    collective += ( hitDiode | hitAnnular );
+    fullEnergy += ( hitDiode & (std::fabs(ediode[i] - eprimary[i]) < kFullEnergyTolerance) );
+  }
+
+  // spectra: only the detected events
+  for ( std::uint64_t i=task.begin; i<task.end; ++i ) {
+    if ( ediode[i] > 0. ) {
+      auto bin = std::uint64_t(ediode[i]*binsPerMeV);
+      if ( bin < kNofBins ) ++accumulator.diodeSpectrum[bin];
+    }
+    if ( eannular[i] > 0. ) {
+      auto bin = std::uint64_t(eannular[i]*binsPerMeV);
+      if ( bin < kNofBins ) ++accumulator.annularSpectrum[bin];
+    }
+  }
+
+  accumulator.events += task.end - task.begin;
+  accumulator.diode += diode;
+  accumulator.annular += annular;
+  accumulator.collective += collective;
+  accumulator.fullEnergy += fullEnergy;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// efficiency and binomial error, in %
+void Efficiency(std::uint64_t k, std::uint64_t n, double& efficiency, double& error)
+{
+  efficiency = error = 0.;
+  if ( n == 0 ) return;
+  double p = double(k)/n;
+  efficiency = 100.*p;
+  error = 100.*std::sqrt(p*(1. - p)/n);
+}
+
+// efficiency and error as plotHisto.C, in %: the error is eff/sqrt(k)
+void LegacyEfficiency(std::uint64_t k, std::uint64_t n, double& efficiency, double& error)
+{
+  efficiency = error = 0.;
+  if ( n == 0 || k == 0 ) return;
+  efficiency = 100.*double(k)/n;
+  error = efficiency/std::sqrt(double(k));
+}
+
+// the columnar files of a run: per thread slot, the checkpoint parts, in
+// generation and part order, then the file of the end of run
+std::vector<std::string> FindFiles(const std::string& prefix)
+{
+  std::filesystem::path path(prefix);
+  auto directory = path.parent_path();
+  if ( directory.empty() ) directory = ".";
+  auto stem = path.filename().string() + "_t";
+
+  std::vector<std::tuple<int, int, int, std::string>> found;
+  std::error_code error;
+  for ( const auto& entry : std::filesystem::directory_iterator(directory, error) ) {
+    auto name = entry.path().filename().string();
+    if ( name.compare(0, stem.size(), stem) != 0 ) continue;
+
+    int slot = 0, generation = 0, part = 0;
+    char end[8] = {};
+    auto rest = name.c_str() + stem.size();
+    if ( std::sscanf(rest, "%d_g%d_p%d.%6s", &slot, &generation, &part, end) != 4 ) {
+      if ( std::sscanf(rest, "%d.%6s", &slot, end) != 2 ) continue;
+      generation = part = std::numeric_limits<int>::max();   // after the parts
+    }
+    if ( std::strcmp(end, "b4col") != 0 || slot < 0 || slot >= kMaxSlots ) continue;
+
+    auto fileName = ( path.parent_path().empty() ) ? name : entry.path().string();
+    found.emplace_back(slot, generation, part, fileName);
+  }
+
+  std::sort(found.begin(), found.end());
+  std::vector<std::string> names;
+  for ( const auto& file : found ) names.push_back(std::get<3>(file));
+  return names;
+}
+
+bool IsEmpty(const std::string& name)
+{
+  std::ifstream file(name);
+  return ! file || file.peek() == std::ifstream::traits_type::eof();
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  // Evaluate arguments
+  //
+  std::string label = "-";
+  std::string prefix = "B4";
+  std::string tableName = "scan_results.dat";
+  std::string spectraName = "scan_spectra.dat";
+  unsigned int nThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> fileNames;
+  Overlay overlay;
+
+  for ( int i=1; i<argc; ++i ) {
+    std::string arg = argv[i];
+    if ( arg.size() == 2 && arg[0] == '-' ) {
+      if ( i+1 >= argc ) {
+        PrintUsage();
+        return 1;
+      }
+      std::string value = argv[++i];
+      if      ( arg == "-l" ) label = value;
+      else if ( arg == "-p" ) prefix = value;
+      else if ( arg == "-o" ) tableName = value;
+      else if ( arg == "-s" ) spectraName = value;
+      else if ( arg == "-t" ) nThreads = std::max(1, std::atoi(value.c_str()));
+      else if ( arg == "-a" ) overlay.activity = std::max(0., std::atof(value.c_str()));
+      else if ( arg == "-w" ) overlay.shaping = std::max(0., std::atof(value.c_str()))*1.e-6;
+      else if ( arg == "-d" ) overlay.deadTime = std::max(0., std::atof(value.c_str()))*1.e-6;
+      else if ( arg == "-r" ) overlay.seed = std::strtoull(value.c_str(), nullptr, 10);
+      else {
+        PrintUsage();
+        return 1;
+      }
+    }
+    else {
+      fileNames.push_back(arg);
+    }
+  }
+
+  if ( fileNames.empty() ) fileNames = FindFiles(prefix);
+  if ( fileNames.empty() ) {
+    std::cerr << "No columnar file found." << std::endl;
+    return 1;
+  }
+  if ( ! B4c::Columnar::IsLittleEndian() ) {
+    std::cerr << "The columnar files can only be mapped on a little-endian host." << std::endl;
+    return 1;
+  }
+
+  // Map the files and split them in tasks
+  //
+  std::vector<MappedFile> files(fileNames.size());
+  std::vector<Task> tasks;
+  for ( std::size_t i=0; i<fileNames.size(); ++i ) {
+    if ( ! MapFile(fileNames[i], files[i]) ) return 1;
+    for ( std::uint64_t begin=0; begin<files[i].nofRows; begin += kChunkSize ) {
+      tasks.push_back({ &files[i], begin, std::min(begin + kChunkSize, files[i].nofRows) });
+    }
+  }
+
+  // Single parallel pass
+  //
+  nThreads = std::min<std::size_t>(nThreads, std::max<std::size_t>(1, tasks.size()));
+  std::vector<Accumulator> accumulators(nThreads);
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> threads;
+  for ( unsigned int t=0; t<nThreads; ++t ) {
+    threads.emplace_back([&, t]() {
+      for ( auto i = next++; i < tasks.size(); i = next++ ) {
+        Process(tasks[i], accumulators[t]);
+        if ( overlay.activity > 0. ) ProcessOverlay(tasks[i], i, overlay, accumulators[t]);
+      }
+    });
+  }
+  for ( auto& thread : threads ) thread.join();
+
+  Accumulator total;
+  for ( const auto& accumulator : accumulators ) total.Add(accumulator);
+
+  for ( auto& file : files ) munmap(file.data, file.size);
+
+  // Results
+  //
+  double diodeEff, diodeErr, annularEff, annularErr, collectiveEff, collectiveErr;
+  double partialFrac, partialErr;
+  Efficiency(total.diode, total.events, diodeEff, diodeErr);
+  Efficiency(total.annular, total.events, annularEff, annularErr);
+  Efficiency(total.collective, total.events, collectiveEff, collectiveErr);
+  Efficiency(total.diode - total.fullEnergy, total.diode, partialFrac, partialErr);
+
+  // the definitions of plotHisto.C: errors eff/sqrt(k), collective
+  // efficiency as the sum of the two, with the relative errors added in
+  // quadrature, and partial depositors per full-energy depositor
+  double legacyDiodeEff, legacyDiodeErr, legacyAnnularEff, legacyAnnularErr;
+  LegacyEfficiency(total.diode, total.events, legacyDiodeEff, legacyDiodeErr);
+  LegacyEfficiency(total.annular, total.events, legacyAnnularEff, legacyAnnularErr);
+  auto relative = [](double error, double efficiency) {
+    return ( efficiency > 0. ) ? error/efficiency : 0.;
+  };
+  auto legacyCollectiveEff = legacyDiodeEff + legacyAnnularEff;
+  auto legacyCollectiveErr = legacyCollectiveEff
+    * std::sqrt(std::pow(relative(legacyDiodeErr, legacyDiodeEff), 2)
+                + std::pow(relative(legacyAnnularErr, legacyAnnularEff), 2));
+  auto legacyPartial = ( total.fullEnergy > 0 )
+    ? 100.*double(total.diode - total.fullEnergy)/total.fullEnergy : 0.;
+
+  std::cout << "Events = " << total.events << " in " << files.size() << " files" << std::endl;
+  std::cout << "As plotHisto.C:" << std::endl;
+  std::cout << "Efficiency of PIN diode = " << legacyDiodeEff << "+/-" << legacyDiodeErr
+            << std::endl;
+  std::cout << "Efficiency of Annular detector = " << legacyAnnularEff << "+/-"
+            << legacyAnnularErr << std::endl;
+  std::cout << "Collective efficiency = " << legacyCollectiveEff << "+/-" << legacyCollectiveErr
+            << std::endl;
+  std::cout << "percentage of partial depositors = " << legacyPartial << " percent" << std::endl;
+  std::cout << "Binomial (" << tableName << "):" << std::endl;
+  std::cout << "Diode efficiency = " << diodeEff << "+/-" << diodeErr << " %" << std::endl;
+  std::cout << "Annular efficiency = " << annularEff << "+/-" << annularErr << " %" << std::endl;
+  std::cout << "Either detector efficiency = " << collectiveEff << "+/-" << collectiveErr
+            << " %" << std::endl;
+  std::cout << "Partial depositors = " << partialFrac << "+/-" << partialErr
+            << " % of the diode events" << std::endl;
+
+  // one row per scan point
+  bool newTable = IsEmpty(tableName);
+  std::ofstream table(tableName, std::ios_base::app);
+  if ( newTable ) {
+    table << "# label events diode_eff diode_err annular_eff annular_err"
+          << " either_eff either_err partial_frac partial_err  (in %, binomial errors;"
+          << " either: a deposit in either detector; partial_frac: of the diode events)\n";
+  }
+  table << std::setprecision(8) << label << " " << total.events
+        << " " << diodeEff << " " << diodeErr
+        << " " << annularEff << " " << annularErr
+        << " " << collectiveEff << " " << collectiveErr
+        << " " << partialFrac << " " << partialErr << "\n";
+
+  // spectra of the scan point
+  std::ofstream spectra(spectraName, std::ios_base::app);
+  spectra << "# label " << label << " events " << total.events << "\n"
+          << "# E_low(MeV) diode annular\n";
+  for ( int i=0; i<kNofBins; ++i ) {
+    spectra << i*kMaxEnergy/kNofBins << " " << total.diodeSpectrum[i]
+            << " " << total.annularSpectrum[i] << "\n";
+  }
+
+  // files of plotHisto.C, with its definitions
+  std::ofstream("diode_efficiency_data.dat", std::ios_base::app)
+    << legacyDiodeEff << "," << legacyDiodeErr << "\n";
+  std::ofstream("annular_efficiency_data.dat", std::ios_base::app)
+    << legacyAnnularEff << "," << legacyAnnularErr << "\n";
+  std::ofstream("collective_efficiency_data.dat", std::ios_base::app)
+    << legacyCollectiveEff << "," << legacyCollectiveErr << "\n";
+
+  // pile-up overlay: one row per scan point and activity, and the spectra
+  if ( overlay.activity > 0. ) {
+    const char* names[kNofDetectors] = { "diode", "annular" };
+
+    std::cout << "Pile-up overlay: activity " << overlay.activity << " Bq, shaping "
+              << overlay.shaping*1.e6 << " us, dead time " << overlay.deadTime*1.e6
+              << " us, " << total.streamTime << " s" << std::endl;
+
+    bool newPileupTable = IsEmpty("pileup_results.dat");
+    std::ofstream pileupTable("pileup_results.dat", std::ios_base::app);
+    if ( newPileupTable ) {
+      pileupTable << "# label activity(Bq) shaping(us) dead_time(us) events time(s)"
+                  << " then per detector (diode, annular): pulses recorded piled_up lost"
+                  << " live_frac eff err  (eff: recorded per event, in %)\n";
+    }
+    pileupTable << std::setprecision(8) << label << " " << overlay.activity
+                << " " << overlay.shaping*1.e6 << " " << overlay.deadTime*1.e6
+                << " " << total.events << " " << total.streamTime;
+
+    std::ofstream pileupSpectra("pileup_spectra.dat", std::ios_base::app);
+    pileupSpectra << "# label " << label << " activity " << overlay.activity
+                  << " events " << total.events << "\n"
+                  << "# E_low(MeV) diode annular\n";
+
+    for ( int i=0; i<kNofDetectors; ++i ) {
+      const auto& counts = total.pileup[i];
+      double liveFraction = ( total.streamTime > 0. )
+        ? std::max(0., 1. - counts.busyTime/total.streamTime) : 0.;
+      double efficiency, error;
+      Efficiency(counts.recorded, total.events, efficiency, error);
+
+      std::cout << "  " << names[i] << ": pulses " << counts.pulses
+                << " recorded " << counts.recorded << " piled-up " << counts.piledUp
+                << " lost " << counts.lost << " live fraction " << liveFraction
+                << " live-time efficiency = " << efficiency << "+/-" << error << std::endl;
+
+      pileupTable << " " << counts.pulses << " " << counts.recorded << " " << counts.piledUp
+                  << " " << counts.lost << " " << liveFraction
+                  << " " << efficiency << " " << error;
+    }
+    pileupTable << "\n";
+
+    for ( int i=0; i<kNofBins; ++i ) {
+      pileupSpectra << i*kMaxEnergy/kNofBins << " " << total.pileup[0].spectrum[i]
+                    << " " << total.pileup[1].spectrum[i] << "\n";
+    }
+  }
+
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -29,8 +29,13 @@
 
 #include "DetectorConstruction.hh"
 #include "ActionInitialization.hh"
+#include "Checkpoint.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RandomEngine.hh"
+#include "WorkerInitialization.hh"
 
 #include "G4RunManagerFactory.hh"
+#include "G4MTRunManager.hh"
 #include "G4SteppingVerbose.hh"
 #include "G4UIcommand.hh"
 #include "G4UImanager.hh"
@@ -44,10 +49,17 @@
 namespace {
   void PrintUsage() {
     G4cerr << " Usage: " << G4endl;
-    G4cerr << " exampleB4c [-m macro ] [-u UIsession] [-t nThreads] [-vDefault]"
-           << G4endl;
+    G4cerr << " exampleB4c [-m macro ] [-u UIsession] [-t nThreads] [-p nPrimaries]"
+           << " [-e engine] [-s seed] [-vDefault] [--resume]" << G4endl;
     G4cerr << "   note: -t option is available only for multi-threaded mode."
            << G4endl;
+    G4cerr << "   -p: independent primaries per event, each scored as an event."
+           << G4endl;
+    G4cerr << "   -e: random engine, one of " << B4c::RandomEngine::GetNames()
+           << G4endl;
+    G4cerr << "   -s: seed of the random engine." << G4endl;
+    G4cerr << "   --resume: continue the scan from the last checkpoint."
+           << G4endl;
   }
 }
 
@@ -57,7 +69,7 @@ int main(int argc,char** argv)
 {
   // Evaluate arguments
   //
-  if ( argc > 7 ) {
+  if ( argc > 15 ) {
     PrintUsage();
     return 1;
   }
@@ -65,12 +77,23 @@ int main(int argc,char** argv)
   G4String macro;
   G4String session;
   G4bool verboseBestUnits = true;
+  G4bool resume = false;
+  G4int nPrimaries = 1;
+  G4String engine = "mixmax";
+  G4long seed = 0;
 #ifdef G4MULTITHREADED
   G4int nThreads = 0;
 #endif
   for ( G4int i=1; i<argc; i=i+2 ) {
     if      ( G4String(argv[i]) == "-m" ) macro = argv[i+1];
     else if ( G4String(argv[i]) == "-u" ) session = argv[i+1];
+    else if ( G4String(argv[i]) == "-p" ) {
+      nPrimaries = G4UIcommand::ConvertToInt(argv[i+1]);
+    }
+    else if ( G4String(argv[i]) == "-e" ) engine = argv[i+1];
+    else if ( G4String(argv[i]) == "-s" ) {
+      seed = G4UIcommand::ConvertToLongInt(argv[i+1]);
+    }
 #ifdef G4MULTITHREADED
     else if ( G4String(argv[i]) == "-t" ) {
       nThreads = G4UIcommand::ConvertToInt(argv[i+1]);
@@ -80,6 +103,10 @@ int main(int argc,char** argv)
       verboseBestUnits = false;
       --i;  // this option is not followed with a parameter
     }
+    else if ( G4String(argv[i]) == "--resume" ) {
+      resume = true;
+      --i;  // this option is not followed with a parameter
+    }
     else {
       PrintUsage();
       return 1;
@@ -93,8 +120,22 @@ int main(int argc,char** argv)
     ui = new G4UIExecutive(argc, argv, session);
   }
 
-  // Optionally: choose a different Random engine...
-  // G4Random::setTheEngine(new CLHEP::MTwistEngine);
+  // Continue an interrupted scan from its checkpoint files
+  B4c::Checkpoint::SetResume(resume);
+
+  // Several primaries per event share the event overhead
+  if ( nPrimaries < 1 ) {
+    PrintUsage();
+    return 1;
+  }
+  B4::PrimaryGeneratorAction::SetNofPrimaries(nPrimaries);
+
+  // Choose the random engine, before the run manager: in MT mode the
+  // workers create an engine of the same type
+  if ( ! B4c::RandomEngine::Select(engine, seed) ) {
+    PrintUsage();
+    return 1;
+  }
 
   // Use G4SteppingVerboseWithUnits
   if ( verboseBestUnits ) {
@@ -123,6 +164,13 @@ int main(int argc,char** argv)
   auto actionInitialization = new B4c::ActionInitialization();
   runManager->SetUserInitialization(actionInitialization);
 
+#ifdef G4MULTITHREADED
+  // pinning of the worker threads (/B4/affinity/policy)
+  if ( dynamic_cast<G4MTRunManager*>(runManager) ) {
+    runManager->SetUserInitialization(new B4c::WorkerInitialization());
+  }
+#endif
+
   // Initialize visualization
   auto visManager = new G4VisExecutive;
   // G4VisExecutive can take a verbosity argument - see /vis/verbose guidance.
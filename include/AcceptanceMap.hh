@@ -0,0 +1,112 @@
+/// Acceptance map class
+///
+/// It maps the detection probability of each detector over a 3D grid of
+/// source positions (x, y, z), in world coordinates (the axial scan of
+/// run2.mac is x = y = 0, z = -zpos).
+///
+/// In the mapping mode, the index of an event selects the grid cell of its
+/// source, the cells being interleaved (index modulo the number of cells).
+/// A single run on the one initialised geometry thus covers the whole grid,
+/// and the events of all the cells are distributed to the worker threads as
+/// they ask for them; an aborted run still covers all the cells evenly.
+///
+/// There is one map per detector: the diode (any module), the diode of each
+/// side module (upper, lower, right and left, from the copy number of the
+/// module placement) and the annular detector. An event is detected when its
+/// deposit in the detector is positive. With several primaries per event,
+/// each primary has its own grid cell and is counted as an event. The counts
+/// are accumulated in the Run, and at the end of run the master writes the
+/// map file: a 64-byte header, the axes, the number of events per cell, then
+/// for each map the acceptance and its binomial error per cell (x varies
+/// fastest).
+///
+/// There is one object per thread, owned by RunAction. The configuration
+/// commands are broadcast; /B4/acceptance/run is executed on the master.
+
+/// \file AcceptanceMap.hh
+/// \brief Definition of the B4c::AcceptanceMap class
+
+#ifndef B4cAcceptanceMap_h
+#define B4cAcceptanceMap_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class Run;
+
+class AcceptanceMap
+{
+  public:
+    enum Map { kDiode, kUpper, kLower, kRight, kLeft, kAnnular, kNofMaps };
+    static constexpr G4int kNofModules = 4;
+
+    AcceptanceMap();
+    ~AcceptanceMap();
+
+    G4bool IsEnabled() const { return fEnabled; }
+    std::size_t GetNofCells() const;
+
+    // source position of an event
+    G4ThreeVector GetPosition(G4long eventIndex) const;
+
+    // worker: deposits of each primary of one event
+    void BeginOfEvent(G4int nofPrimaries) { fModuleEdep.assign(nofPrimaries, {}); }
+    inline void AddModuleEdep(G4int primary, G4int module, G4double edep);
+    void EndOfEvent(G4int primary, G4long primaryIndex, G4double diodeEdep,
+                    G4double annularEdep, Run* run) const;
+
+    // master: write the map of the run
+    void EndOfRun(const Run* run) const;
+
+    static const char* GetName(G4int map);
+
+  private:
+    struct FileHeader {
+      char          magic[8];
+      std::uint32_t version;
+      std::uint32_t nofMaps;
+      std::uint64_t geometryHash;
+      std::uint32_t nofCells[3];    // x, y, z
+      std::uint32_t byteOrder;
+      std::uint8_t  reserved[24];
+    };
+
+    void SetX(const G4String& value) { SetAxis(0, value); }
+    void SetY(const G4String& value) { SetAxis(1, value); }
+    void SetZ(const G4String& value) { SetAxis(2, value); }
+    void SetAxis(G4int axis, const G4String& value);
+    void Start();
+
+    G4bool Write(const Run* run) const;
+
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kByteOrder = 0x01020304;
+
+    std::array<std::vector<G4double>, 3> fAxes;  // cell centres
+    G4int    fNofEvents = 10000;                 // per cell
+    G4String fFileName = "acceptance_map.b4am";
+    G4bool   fEnabled = false;
+    G4GenericMessenger* fMessenger = nullptr;
+
+    std::vector<std::array<G4double, kNofModules>> fModuleEdep;  // per primary, current event
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void AcceptanceMap::AddModuleEdep(G4int primary, G4int module, G4double edep) {
+  if ( module >= 0 && module < kNofModules ) fModuleEdep[primary][module] += edep;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
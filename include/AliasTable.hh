@@ -0,0 +1,60 @@
+/// Alias table class
+///
+/// Walker's alias method, built with Vose's algorithm: after an O(n) set-up
+/// from n weights, an index is sampled with one random number in constant
+/// time, whatever the number of entries.
+
+/// \file AliasTable.hh
+/// \brief Definition of the B4c::AliasTable class
+
+#ifndef B4cAliasTable_h
+#define B4cAliasTable_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+namespace B4c
+{
+class AliasTable
+{
+  public:
+    AliasTable() = default;
+    ~AliasTable() = default;
+
+    // false if the weights are empty, negative or all zero
+    G4bool Build(const std::vector<G4double>& weights);
+    void Clear();
+
+    G4bool IsEmpty() const { return fProbabilities.empty(); }
+    std::size_t GetSize() const { return fProbabilities.size(); }
+
+    // normalised probability of an entry
+    G4double GetProbability(std::size_t i) const { return fNormalised[i]; }
+
+    // index of an entry, from a uniform number in [0,1)
+    inline std::size_t Sample(G4double u) const;
+
+  private:
+    std::vector<G4double> fProbabilities;  // of keeping the column
+    std::vector<std::size_t> fAliases;
+    std::vector<G4double> fNormalised;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline std::size_t AliasTable::Sample(G4double u) const
+{
+  // the integer part selects the column, the fraction decides between the
+  // column and its alias
+  G4double x = u*fProbabilities.size();
+  auto column = std::size_t(x);
+  if ( column >= fProbabilities.size() ) column = fProbabilities.size() - 1;
+  return ( x - column < fProbabilities[column] ) ? column : fAliases[column];
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
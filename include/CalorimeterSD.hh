@@ -1,10 +1,21 @@
 /// Calorimeter sensitive detector class
 ///
 /// In Initialize(), it creates one hit for each calorimeter layer and one more
-/// hit for accounting the total quantities in all layers.
+/// hit for accounting the total quantities in all layers, for each primary of
+/// the event. The deposits are accounted in the hits of the primary of the
+/// current track, given by the EventAction.
 ///
 /// The values are accounted in hits in ProcessHits() function which is called
 /// by Geant4 kernel at each step.
+///
+/// The sensitive detector of a Run detector (diode or annular) also counts
+/// the entries of the primaries into its volume in the EntryMaps of the
+/// Run: the step of a primary starting on the volume boundary gives the
+/// entry point and direction in the local frame, the outward normal of the
+/// solid there and the kinetic energy at entry.
+///
+/// AddEdep() adds the energy of a track killed at creation by the
+/// StackingAction to the hits of the cell where it was created.
 
 /// \file CalorimeterSD.hh
 /// \brief Definition of the B4c::CalorimeterSD class
@@ -17,14 +28,20 @@
 #include <vector>
 
 class G4Step;
+class G4StepPoint;
 class G4HCofThisEvent;
+class G4VTouchable;
 
 namespace B4c
 {
+class EventAction;
+
 class CalorimeterSD : public G4VSensitiveDetector
 {
   public:
-    CalorimeterSD(const G4String& name, const G4String& hitsCollectionName,  G4int nofCells);
+    // detector is the Run detector of the entry maps, none if negative
+    CalorimeterSD(const G4String& name, const G4String& hitsCollectionName,  G4int nofCells,
+                  G4int detector = -1);
     ~CalorimeterSD() override;
 
     // methods from base class
@@ -32,9 +49,17 @@ class CalorimeterSD : public G4VSensitiveDetector
     G4bool ProcessHits(G4Step* step, G4TouchableHistory* history) override;
     void   EndOfEvent(G4HCofThisEvent* hitCollection) override;
 
+    void   AddEdep(const G4VTouchable* touchable, G4double edep);
+
   private:
+    CalorHit* GetHit(const G4VTouchable* touchable) const;
+    CalorHit* GetTotalHit() const;
+    void AddEntry(const G4StepPoint* point) const;
+
     CalorHitsCollection* fHitsCollection = nullptr;
     G4int fNofCells = 0;
+    G4int fDetector = -1;
+    const EventAction* fEventAction = nullptr;
 };
 }
 
@@ -0,0 +1,161 @@
+/// Checkpoint class
+///
+/// It saves the state of a long run periodically so that an interrupted job
+/// can be resumed with the --resume option of exampleB4c.
+///
+/// Each thread writes, every /B4/checkpoint/interval events, a shard file
+/// with its random engine state, its Run counters, its histogram contents,
+/// its number of events and the ID of its last event. The master writes, at
+/// the beginning of each run, a master file with the scan point tag, the
+/// number of events of the point, its random engine state and the data
+/// restored from a previous job. All files are written to a temporary file
+/// which is then renamed, so a checkpoint is never left half written.
+///
+/// The scan macro declares each point with /B4/checkpoint/point, which sets
+/// the aliases RunPoint and EventsLeft. On resume, the points completed
+/// before are skipped (RunPoint = 0) and the interrupted point runs the
+/// missing events only: in multi-threaded mode the master engine is restored
+/// and the seeds of the events already started are discarded, so that the
+/// remaining events use random numbers never used before; in sequential mode
+/// the engine saved with the last shard is restored. The restored Run and
+/// histograms are added to the results at the end of run.
+/// The event IDs used before the interruption are kept as an offset, so
+/// that the quasi-random points of the resumed events are new ones.
+///
+/// Before each shard, the thread finishes its columnar file as a part of
+/// the checkpoint generation (ColumnarWriter::Commit()) and the shard
+/// records its number of parts. On resume, the parts beyond these numbers
+/// are removed and the others are kept, so that the columnar files of the
+/// point hold the same events as the restored Run. The ROOT ntuple cannot
+/// be split this way: it only holds the events run after the resume, which
+/// is reported with a warning.
+///
+/// The runs of the internal scans (RunProgress::IsInternalScan()) are not
+/// checkpointed, and the restored data wait for the next user run.
+
+/// \file Checkpoint.hh
+/// \brief Definition of the B4c::Checkpoint class
+
+#ifndef B4cCheckpoint_h
+#define B4cCheckpoint_h 1
+
+#include "globals.hh"
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+class G4Event;
+class G4GenericMessenger;
+
+namespace B4c
+{
+class ColumnarWriter;
+class Run;
+
+class Checkpoint
+{
+  public:
+    Checkpoint();
+    ~Checkpoint();
+
+    // set from the command line before the first run
+    static void SetResume(G4bool resume) { fResume = resume; }
+
+    // event IDs of the scan point used by the interrupted jobs
+    static G4int GetEventOffset() { return fEventOffset; }
+
+    // the columnar output of the thread, committed with each shard
+    void SetColumnarWriter(ColumnarWriter* writer) { fColumnarWriter = writer; }
+    // master: the run adds the data of an interrupted one
+    G4bool HasRestored() const { return fHasRestored; }
+
+    // called from RunAction (master and workers)
+    void BeginOfRun();
+    void EndOfRun(Run* run);   // master: add the restored data
+    void CompleteRun();        // master: mark the scan point as done
+
+    // called from EventAction
+    void BeginOfEvent();
+    G4bool IsShardDue() const
+      { return ! fSuspended && fInterval > 0 && fEventsSinceShard >= fInterval; }
+    void EndOfEvent(const G4Event* event);
+
+  private:
+    // the bin contents of one histogram, including under/overflow
+    struct H1Data {
+      std::vector<unsigned int> entries;
+      std::vector<G4double> sumW, sumW2, sumXW, sumX2W;
+    };
+    using H1List = std::vector<H1Data>;
+
+    // the content of a master or shard file
+    struct State {
+      G4int generation = -1;
+      G4String tag;
+      G4int nofEvents = 0;          // master: events of the scan point
+      G4int nofDone = 0;            // events done
+      G4int lastEventID = -1;       // shard: last event ID of the thread
+      G4int eventOffset = 0;        // master: event IDs used before the run
+      G4int nofParts = 0;           // shard: columnar parts of the thread
+      std::vector<unsigned long> engine;
+      std::unique_ptr<Run> run;
+      H1List h1s;
+    };
+
+    void SetPoint(const G4String& value);
+    G4bool LoadCheckpoint();
+    void WriteMaster() const;
+    void WriteShard() const;
+    void RemoveFiles(G4bool all) const;
+
+    G4String GetMasterPath() const;
+    G4String GetShardPath(G4int slot) const;
+    G4String GetCompletedPath() const;
+    G4bool IsCompleted(const G4String& tag) const;
+
+    static G4bool WriteFile(const G4String& path,
+                            const std::function<void(std::ostream&)>& write);
+    static void WriteState(std::ostream& os, const G4String& type, const State& state,
+                           const Run& run, const H1List& h1s);
+    static G4bool ReadState(const G4String& path, const G4String& type, State& state);
+
+    // histograms of the analysis manager
+    static H1List GetH1s();
+    static void AddToH1s(const H1List& h1s);
+    static void AddH1s(H1List& sum, const H1List& h1s);
+
+    static G4bool fResume;       // set by --resume
+    static G4int  fGeneration;   // master file generation, written by the master
+    static G4int  fEventOffset;  // written by the master before the run
+
+    // configuration
+    G4int    fInterval = 0;                // events between two shards, 0 = off
+    G4String fDirectory = "checkpoint";
+    G4GenericMessenger* fMessenger = nullptr;
+    ColumnarWriter* fColumnarWriter = nullptr;   // owned by RunAction
+
+    // master: current scan point and restored data
+    G4String fTag;
+    G4int    fNofEvents = 0;
+    G4bool   fCleared = false;
+    State    fRestored;
+    G4bool   fHasRestored = false;
+    G4bool   fRestoreEngine = false;
+    std::vector<unsigned long> fEngine;    // engine at the beginning of run
+    G4long   fNofDiscarded = 0;            // randoms to skip after restoring it
+
+    // the run is an internal scan: no checkpoint, the restored data wait
+    G4bool fSuspended = false;
+
+    // thread: events since the last shard
+    G4int fEventsSinceShard = 0;
+    G4int fLastEventID = -1;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,98 @@
+/// Columnar file format
+///
+/// Layout of the per-event columnar files (*.b4col) written by the
+/// ColumnarWriter and read by the B4analysis tool. It only depends on the
+/// standard library, so that analysis tools can use it without Geant4.
+///
+/// A file holds one run of one thread:
+///   FileHeader                      64 bytes
+///   ColumnHeader x nofColumns       64 bytes each
+///   column data                     each column a contiguous array of
+///                                   nofRows values, starting at a 64-byte
+///                                   aligned offset from the file start
+/// All numbers are little-endian. A reader can mmap the file and use each
+/// column directly as an aligned array; the files of several threads (or
+/// runs) are simply read one after the other.
+
+/// \file ColumnarFormat.hh
+/// \brief Definition of the B4c columnar file format
+
+#ifndef B4cColumnarFormat_h
+#define B4cColumnarFormat_h 1
+
+#include <cstdint>
+#include <cstring>
+
+namespace B4c
+{
+namespace Columnar
+{
+
+constexpr char kMagic[8] = { 'B', '4', 'C', 'O', 'L', '\0', '\0', '\0' };
+constexpr std::uint32_t kVersion = 1;
+constexpr std::uint64_t kAlignment = 64;
+
+enum ColumnType : std::uint32_t { kFloat64 = 1, kInt64 = 2 };
+
+struct FileHeader {
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t nofColumns;
+  std::uint64_t nofRows;
+  std::int32_t  runID;
+  std::int32_t  threadID;
+  std::uint8_t  reserved[32];
+};
+
+struct ColumnHeader {
+  char          name[40];
+  std::uint32_t type;
+  std::uint32_t elementSize;
+  std::uint64_t offset;       // from the file start, multiple of kAlignment
+  std::uint64_t size;         // in bytes
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+static_assert(sizeof(ColumnHeader) == 64, "ColumnHeader must be 64 bytes");
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline std::uint64_t AlignUp(std::uint64_t offset)
+{
+  return (offset + kAlignment - 1)/kAlignment*kAlignment;
+}
+
+inline bool IsLittleEndian()
+{
+  const std::uint16_t one = 1;
+  std::uint8_t first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// convert in place between the host and the file byte order
+inline void SwapBytes(void* data, std::uint64_t nofValues, std::uint32_t elementSize)
+{
+  if ( IsLittleEndian() ) return;
+
+  auto bytes = static_cast<std::uint8_t*>(data);
+  for ( std::uint64_t i=0; i<nofValues; ++i, bytes += elementSize ) {
+    for ( std::uint32_t j=0; j<elementSize/2; ++j ) {
+      std::uint8_t tmp = bytes[j];
+      bytes[j] = bytes[elementSize-1-j];
+      bytes[elementSize-1-j] = tmp;
+    }
+  }
+}
+
+inline bool HasMagic(const FileHeader& header)
+{
+  return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,108 @@
+/// Columnar writer class
+///
+/// It writes the per-event quantities of the B4 ntuple (and the primary
+/// energy) to a columnar file per thread and per run, <prefix>_t<N>.b4col,
+/// in the format defined in ColumnarFormat.hh, as an alternative to the ROOT
+/// ntuple which needs ROOT to be read.
+///
+/// The values are buffered per column and appended to one spill file per
+/// column; at the end of run the columns are copied one after the other
+/// into the final file, which is then renamed into place.
+///
+/// With checkpointing, the file is also finished at each checkpoint of the
+/// thread, as the part <prefix>_t<N>_g<G>_p<K>.b4col of the checkpoint
+/// generation G, and the next events go to a new file. The parts hold
+/// exactly the events saved by the checkpoints, so that on resume they are
+/// kept, with the parts finished after the last checkpoint removed, and the
+/// columnar output covers the whole run.
+///
+/// The output is selected with /B4/output/columnar and /B4/output/ntuple.
+
+/// \file ColumnarWriter.hh
+/// \brief Definition of the B4c::ColumnarWriter class
+
+#ifndef B4cColumnarWriter_h
+#define B4cColumnarWriter_h 1
+
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class ColumnarWriter
+{
+  public:
+    enum Column { kEdiode, kEannular, kLdiode, kLannular, kEprimary, kNofColumns };
+
+    ColumnarWriter();
+    ~ColumnarWriter();
+
+    G4bool IsEnabled() const { return fEnabled; }
+    G4bool IsNtupleEnabled() const { return fNtupleEnabled; }
+
+    // called on the thread filling the file
+    void Open(G4int runID);
+    inline void Fill(const std::array<G4double, kNofColumns>& values);
+    void Close();
+    // checkpoint: finish the events so far as the next part of the thread
+    void Commit(G4int generation);
+    G4int GetNofParts() const { return fNofParts; }
+
+    // remove the files of all threads (master, before a run); the parts are
+    // kept when the run resumes an interrupted one
+    void RemoveFiles(G4bool keepParts) const;
+    // resume: remove the parts of a generation beyond the number saved by
+    // the checkpoint of each thread slot
+    void RemoveParts(G4int generation, const std::vector<G4int>& nofParts) const;
+
+    static const char* GetColumnName(G4int column);
+
+  private:
+    G4String GetFileName(G4int slot) const;
+    G4String GetPartName(G4int slot, G4int generation, G4int part) const;
+    // the parts on disk, with their slot and generation
+    struct Part { G4String name; G4int slot; G4int generation; G4int part; };
+    std::vector<Part> ListParts() const;
+
+    void OpenSpills();
+    void Flush();
+    void Finish(const G4String& fileName);
+
+    static constexpr std::size_t kBufferSize = 8192;   // values per column
+
+    G4bool   fEnabled = false;
+    G4bool   fNtupleEnabled = true;
+    G4String fPrefix = "B4";
+    G4GenericMessenger* fMessenger = nullptr;
+
+    G4bool   fOpen = false;
+    G4int    fRunID = -1;
+    G4String fFileName;
+    std::uint64_t fNofRows = 0;
+    G4int    fNofParts = 0;
+    std::array<std::vector<G4double>, kNofColumns> fBuffers;
+    std::array<std::ofstream, kNofColumns> fSpills;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void ColumnarWriter::Fill(const std::array<G4double, kNofColumns>& values)
+{
+  if ( ! fOpen ) return;
+
+  for ( G4int i=0; i<kNofColumns; ++i ) fBuffers[i].push_back(values[i]);
+  ++fNofRows;
+  if ( fBuffers[0].size() == kBufferSize ) Flush();
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -13,6 +13,27 @@
 /// In ConstructSDandField() sensitive detectors of DetectorSD type are 
 /// created and associated with the Diode and Backing plate volumes. In addition a 
 /// transverse uniform magnetic field is defined via G4GlobalMagFieldMessenger class.
+/// A tabulated field (FieldMap) can be used instead, set with /B4/field/map
+/// before /run/initialize.
+///
+/// The Hamamatsu modules and the Canberra annular detector are defined as the
+/// "Hamamatsu" and "Canberra" regions.
+///
+/// The layout of the array can be changed with the /B4/geometry/ commands:
+/// the rotation angle of the side modules, the aperture between them, their
+/// z distance, the z distance and the inner radius of the annular detector.
+/// The geometry is then rebuilt at the next run (ReinitializeGeometry).
+/// The placements of the modules and the annular detector are checked for
+/// overlaps, and HasOverlaps() tells whether the last build had any.
+///
+/// With /B4/geometry/flat, the same material layout is built with hollow
+/// (subtraction) solids instead of vacuum hole daughters, and with all the
+/// layers of a module placed directly in its envelope (World -> Detector ->
+/// Diode instead of five levels); the annular layers are placed in the world.
+///
+/// With /B4/geometry/cache, the volumes of a layout are read from its GDML
+/// cache file when there is one (GeometryCache), keyed by GetParameterHash();
+/// the regions are then defined on the volumes read.
  
 
 /// \file DetectorConstruction.hh
@@ -24,11 +45,16 @@
 #include "G4VUserDetectorConstruction.hh"
 #include "globals.hh"
 
+#include <cstdint>
+
 class G4VPhysicalVolume;
+class G4GenericMessenger;
 class G4GlobalMagFieldMessenger;
 
 namespace B4c
 {
+class FieldMap;
+class GeometryCache;
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -40,18 +66,70 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4VPhysicalVolume* Construct() override;
     void ConstructSDandField() override;
 
+    // at the beginning of each run: warn if the field map of the thread, when
+    // one is set, is not the field of the run
+    static void CheckFieldMap();
+
+    // layout parameters
+    void SetAngle(G4double value);
+    void SetAperture(G4double value);
+    void SetDetectZdist(G4double value);
+    void SetAnDetectZdist(G4double value);
+    void SetAnInnerRadius(G4double value);
+    void SetFlat(G4bool value);
+    // start from and write the GDML cache files (GeometryCache)
+    void SetCache(G4bool value);
+
+    G4double GetAngle() const { return fAngle; }
+    G4double GetAperture() const { return fAperture; }
+    G4double GetDetectZdist() const { return fDetectZdist; }
+    G4double GetAnDetectZdist() const { return fAnDetectZdist; }
+    G4double GetAnInnerRadius() const { return fAnInnerRadius; }
+    G4bool IsFlat() const { return fFlat; }
+
+    G4bool HasOverlaps() const { return fOverlaps; }
+
+    // hash of the layout parameters and of the builder version
+    std::uint64_t GetParameterHash() const;
+
   private:
     // methods
     //
     void DefineMaterials();
     G4VPhysicalVolume* DefineVolumes();
+    void DefineRegions();
+    void DefineCommands();
+    void BenchmarkFieldMap(G4int nofPoints);
+    void WriteTestFieldMap(const G4String& fileName);
+    void GeometryModified();
 
     // data members
     //
     static G4ThreadLocal G4GlobalMagFieldMessenger*  fMagFieldMessenger; // magnetic field messenger
+    static G4ThreadLocal FieldMap*  fFieldMap;   // tabulated field
+
+    // to be increased when the built geometry changes (DefineVolumes,
+    // DefineMaterials or the headers they use), so that the cached
+    // geometries are rebuilt
+    static constexpr G4int kBuilderVersion = 1;
 
     G4bool fCheckOverlaps = true; // option to activate checking of volumes overlaps
     G4int  fNofLayers = -1;       // number of layers
+
+    // layout of the array
+    G4double fAngle;              // rotation of the side modules
+    G4double fAperture;           // aperture between the side modules
+    G4double fDetectZdist;        // z distance of the side modules
+    G4double fAnDetectZdist;      // z distance of the annular detector
+    G4double fAnInnerRadius;      // inner radius of the annular detector
+    G4bool   fFlat = false;       // hollow solids, minimal nesting
+    G4bool   fOverlaps = false;   // found by the last build
+    G4bool   fConstructed = false;
+    G4String fFieldMapFile;       // tabulated field, if not empty
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4GenericMessenger* fFieldMessenger = nullptr;
+    GeometryCache* fGeometryCache = nullptr;
 };
 
 }
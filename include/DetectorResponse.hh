@@ -0,0 +1,87 @@
+/// Detector response class
+///
+/// It turns the ideal energy deposits of the diode and the annular detector
+/// into digitised energies, per detector:
+///  - a dead-layer loss subtracted from the deposit,
+///  - a Gaussian resolution with variance  F*w*E + noise^2  (Fano factor F,
+///    pair creation energy w, RMS electronic noise),
+///  - a threshold on the digitised energy.
+///
+/// The deposits are buffered and processed in batches: the Gaussian numbers
+/// of a whole batch are generated at once (Box-Muller on an array of flat
+/// numbers) before the digitised energies are histogrammed in Ediode_digi
+/// and Eannular_digi, next to the raw Ediode and Eannular spectra.
+///
+/// The stage is configured with the /B4/response/ commands.
+
+/// \file DetectorResponse.hh
+/// \brief Definition of the B4c::DetectorResponse class
+
+#ifndef B4cDetectorResponse_h
+#define B4cDetectorResponse_h 1
+
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+#include <array>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class DetectorResponse
+{
+  public:
+    enum Detector { kDiode, kAnnular, kNofDetectors };
+
+    DetectorResponse();
+    ~DetectorResponse();
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    void BeginOfRun();
+    inline void Add(G4double diodeEdep, G4double annularEdep);
+    void Flush();   // process the buffered events
+
+    static const char* GetName(G4int detector);
+
+  private:
+    struct Channel {
+      G4double fano = 0.12;           // silicon
+      G4double pairEnergy = 3.62*eV;
+      G4double noise = 0.;            // RMS
+      G4double deadLayer = 0.;        // energy lost before the active volume
+      G4double threshold = 0.;
+      G4GenericMessenger* messenger = nullptr;
+      std::vector<G4double> edep;     // buffered raw deposits
+      std::vector<G4double> gauss;    // normal numbers of the batch
+      G4int h1ID = -1;
+    };
+
+    void GenerateGaussians(std::size_t n);
+
+    G4bool fEnabled = false;
+    G4int  fBatchSize = 4096;
+    G4GenericMessenger* fMessenger = nullptr;
+
+    std::array<Channel, kNofDetectors> fChannels;
+    std::vector<G4double> fFlats;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void DetectorResponse::Add(G4double diodeEdep, G4double annularEdep)
+{
+  if ( ! fEnabled ) return;
+
+  fChannels[kDiode].edep.push_back(diodeEdep);
+  fChannels[kAnnular].edep.push_back(annularEdep);
+  if ( G4int(fChannels[kDiode].edep.size()) >= fBatchSize ) Flush();
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,93 @@
+/// Energy budget class
+///
+/// It tallies the energy deposit of one event per logical volume of the
+/// detector array into a small fixed array. The mapping from a logical volume
+/// to its slot in the array is precomputed in Initialize() from the volume
+/// instance IDs, so that Add() does neither hash lookups nor string compares.
+///
+/// All the volumes which are not part of the budget (the world, the vacuum
+/// envelopes and holes) are accounted in the kOther slot.
+
+/// \file EnergyBudget.hh
+/// \brief Definition of the B4c::EnergyBudget class
+
+#ifndef B4cEnergyBudget_h
+#define B4cEnergyBudget_h 1
+
+#include "G4LogicalVolume.hh"
+#include "globals.hh"
+
+#include <array>
+#include <vector>
+
+namespace B4c
+{
+class EnergyBudget
+{
+  public:
+    enum Volume : G4int {
+      kDiode = 0,
+      kAnnular,
+      kAlring,
+      kSiBuff,
+      kAlShield,
+      kBacking,
+      kExtrusion,
+      kAnEnclosing,
+      kAnBacking,
+      kOther,
+      kNofVolumes
+    };
+
+    EnergyBudget() = default;
+    ~EnergyBudget() = default;
+
+    // (re)build the logical volume -> slot table from the volume store
+    void Initialize();
+
+    // methods to handle data
+    inline G4int GetIndex(const G4LogicalVolume* volume) const;
+    inline void  Add(G4int index, G4double edep);
+    inline void  Add(const G4LogicalVolume* volume, G4double edep);
+    void Clear();
+
+    // get methods
+    inline G4double GetEdep(G4int index) const;
+    inline const std::array<G4double, kNofVolumes>& GetEdeps() const;
+
+    static const char* GetName(G4int index);
+    static const char* GetVolumeName(G4int index);
+
+  private:
+    std::array<G4double, kNofVolumes> fEdep{}; ///< Energy deposit per volume in the event
+    std::vector<G4int> fIndex;                 ///< Slot per logical volume instance ID
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline G4int EnergyBudget::GetIndex(const G4LogicalVolume* volume) const {
+  auto id = static_cast<std::size_t>(volume->GetInstanceID());
+  return ( id < fIndex.size() ) ? fIndex[id] : kOther;
+}
+
+inline void EnergyBudget::Add(G4int index, G4double edep) {
+  fEdep[index] += edep;
+}
+
+inline void EnergyBudget::Add(const G4LogicalVolume* volume, G4double edep) {
+  fEdep[GetIndex(volume)] += edep;
+}
+
+inline G4double EnergyBudget::GetEdep(G4int index) const {
+  return fEdep[index];
+}
+
+inline const std::array<G4double, EnergyBudget::kNofVolumes>& EnergyBudget::GetEdeps() const {
+  return fEdep;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,126 @@
+/// Entry maps class
+///
+/// It counts the entries of the primaries into one sensitive volume, in the
+/// local frame of the volume, to show the edge effects of the frames around
+/// the detectors. An entry is the step of a primary starting on the boundary
+/// of the volume; a primary scattered out and back in is counted again.
+///
+/// The counts are dense 32-bit integer histograms with fixed binning:
+///  - the entry position (x, y), over the bounding box of the solid;
+///  - the incidence angle versus the kinetic energy at entry;
+///  - the incidence angle versus the distance of the entry point to the
+///    axis of the volume, over the half diagonal of the bounding box.
+/// The incidence angle is the angle to the inward normal of the surface at
+/// the entry point, 0 to 90 deg. The entries are also counted per face:
+/// the -z and +z faces and the sides. The last energy bin holds the overflow.
+///
+/// There is one object per detector in each Run; they are filled without
+/// allocation and merged with the Run.
+
+/// \file EntryMaps.hh
+/// \brief Definition of the B4c::EntryMaps class
+
+#ifndef B4cEntryMaps_h
+#define B4cEntryMaps_h 1
+
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace B4c
+{
+class EntryMaps
+{
+  public:
+    enum Face { kMinusZ, kPlusZ, kSide, kNofFaces };
+
+    // binning of the maps
+    static constexpr G4int    kNofPositionBins = 50;   // per axis
+    static constexpr G4int    kNofRadiusBins = 25;
+    static constexpr G4int    kNofAngleBins = 45;
+    static constexpr G4double kAngleBinWidth = 2.*deg;
+    static constexpr G4int    kNofEnergyBins = 100;
+    static constexpr G4double kEnergyBinWidth = 100.*keV;
+
+    EntryMaps();
+    ~EntryMaps() = default;
+
+    // an entry in the local frame, relative to the centre of the bounding
+    // box of the solid; normal is the outward normal at the entry point
+    inline void Add(const G4ThreeVector& halfSize, const G4ThreeVector& position,
+                    const G4ThreeVector& direction, const G4ThreeVector& normal,
+                    G4double energy);
+
+    void Merge(const EntryMaps& other);
+
+    G4long GetNofEntries() const { return fNofEntries; }
+
+    // save/restore the counters (Run checkpoints)
+    void Write(std::ostream& os) const;
+    void Read(std::istream& is);
+    std::size_t GetMemorySize() const;
+
+    // print the summary of the entries into the named volume
+    void Print(const G4String& name) const;
+    // the filled bins of each map, at the bin centres
+    void WriteMaps(std::ostream& os, G4int runID, const G4String& name) const;
+
+  private:
+    G4ThreeVector fHalfSize;           ///< Half size of the bounding box
+    G4long   fNofEntries = 0;
+    G4double fAngleSum = 0.;           ///< Sum of the incidence angles
+    G4double fEnergySum = 0.;          ///< Sum of the kinetic energies at entry
+    std::array<G4long, kNofFaces> fFaces{};
+
+    /// Entries per (x, y) bin, x varying fastest
+    std::vector<std::uint32_t> fPosition;
+    /// Entries per (energy, angle) bin, energy varying fastest
+    std::vector<std::uint32_t> fAngleEnergy;
+    /// Entries per (radius, angle) bin, radius varying fastest
+    std::vector<std::uint32_t> fAngleRadius;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void EntryMaps::Add(const G4ThreeVector& halfSize, const G4ThreeVector& position,
+                           const G4ThreeVector& direction, const G4ThreeVector& normal,
+                           G4double energy) {
+  // bin of a value in [0, 1), the edges included
+  auto bin = [](G4double u, G4int nofBins) {
+    return std::min(std::max(G4int(u*nofBins), 0), nofBins-1);
+  };
+
+  fHalfSize = halfSize;
+  auto cosIncidence = std::min(std::max(-direction.dot(normal), 0.), 1.);
+  auto angle = std::acos(cosIncidence);
+  auto radius = std::sqrt(position.x()*position.x() + position.y()*position.y());
+  auto maxRadius = std::sqrt(halfSize.x()*halfSize.x() + halfSize.y()*halfSize.y());
+
+  auto ix = bin(0.5*(position.x()/halfSize.x() + 1.), kNofPositionBins);
+  auto iy = bin(0.5*(position.y()/halfSize.y() + 1.), kNofPositionBins);
+  auto ir = bin(radius/maxRadius, kNofRadiusBins);
+  auto ia = std::min(G4int(angle/kAngleBinWidth), kNofAngleBins-1);
+  auto ie = std::min(G4int(energy/kEnergyBinWidth), kNofEnergyBins-1);
+
+  ++fPosition[iy*kNofPositionBins + ix];
+  ++fAngleEnergy[ia*kNofEnergyBins + ie];
+  ++fAngleRadius[ia*kNofRadiusBins + ir];
+
+  ++fNofEntries;
+  fAngleSum += angle;
+  fEnergySum += energy;
+  ++fFaces[ normal.z() < -0.5 ? kMinusZ : ( normal.z() > 0.5 ? kPlusZ : kSide ) ];
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,66 @@
+/// Escape filter class
+///
+/// It decides whether a track in the world volume can still reach any
+/// material. In Initialize() the bounding boxes of the volumes placed in the
+/// world (the four Hamamatsu modules and the annular detector) are computed
+/// in the world frame; IsEscaping() then tests the straight-line
+/// continuation of the track against these boxes.
+///
+/// The straight-line test is only valid without a magnetic field, so the
+/// filter disables itself when a detector field is defined.
+///
+/// The filter is switched on/off with /B4/escape/enable.
+
+/// \file EscapeFilter.hh
+/// \brief Definition of the B4c::EscapeFilter class
+
+#ifndef B4cEscapeFilter_h
+#define B4cEscapeFilter_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+class G4VPhysicalVolume;
+
+namespace B4c
+{
+class EscapeFilter
+{
+  public:
+    EscapeFilter();
+    ~EscapeFilter();
+
+    // compute the bounding boxes of the current geometry
+    void Initialize();
+
+    // get methods
+    G4bool IsActive() const { return fActive; }
+    const G4VPhysicalVolume* GetWorld() const { return fWorld; }
+
+    // true if the ray from position along direction misses all the boxes
+    G4bool IsEscaping(const G4ThreeVector& position, const G4ThreeVector& direction) const;
+
+  private:
+    struct Box {
+      G4ThreeVector min;
+      G4ThreeVector max;
+    };
+
+    G4bool Intersects(const Box& box, const G4ThreeVector& position,
+                      const G4ThreeVector& direction) const;
+
+    std::vector<Box> fBoxes;
+    const G4VPhysicalVolume* fWorld = nullptr;
+    G4bool fEnabled = true;   // set by the user
+    G4bool fActive = false;   // enabled and valid for the current geometry
+    G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
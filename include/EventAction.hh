@@ -3,6 +3,26 @@
 /// In EndOfEventAction(), it prints the accumulated quantities of the energy
 /// deposit and track lengths of charged particles in Diode and Backing plate layers
 /// stored in the hits collections.
+///
+/// The per-volume energy budget of the event is filled by the SteppingAction;
+/// at the end of event it is histogrammed and accumulated in the Run.
+///
+/// Each event is also counted in the thread slot of RunProgress, and the
+/// run is aborted when the SequentialStopping criterion is met.
+/// The events are also counted by the Checkpoint, which saves the thread
+/// state periodically, and the per-event quantities are passed to the
+/// ColumnarWriter when the columnar output is enabled.
+/// The deposits of the diode and the annular detector are also passed to
+/// the DetectorResponse, which fills the digitised spectra in batches.
+/// With quasi-random directions, the detections are counted per replica.
+/// In the acceptance mapping mode, the detections are counted per source
+/// grid cell, with the diode deposits of each module added by the
+/// SteppingAction.
+///
+/// With several primaries per event, each track is attributed to the primary
+/// it descends from (SetCurrentPrimary(), from the TrackingAction), and the
+/// hits, energy budget and steps are kept per primary. At the end of event,
+/// all the above is done for each primary, as if it were its own event.
 
 /// \file EventAction.hh
 /// \brief Definition of the B4c::EventAction class
@@ -12,10 +32,24 @@
 
 #include "G4UserEventAction.hh"
 #include "CalorHit.hh"
+#include "DetectorResponse.hh"
+#include "EnergyBudget.hh"
+#include "EscapeFilter.hh"
+#include "RunProgress.hh"
+#include "SequentialStopping.hh"
 #include "globals.hh"
 
+#include <vector>
+
+class G4Track;
+
 namespace B4c
 {
+class AcceptanceMap;
+class Checkpoint;
+class ColumnarWriter;
+class QuasiRandom;
+
 class EventAction : public G4UserEventAction
 {
 public:
@@ -25,6 +59,24 @@ public:
   void  BeginOfEventAction(const G4Event* event) override;
   void  EndOfEventAction(const G4Event* event) override;
 
+  // called from RunAction on worker threads
+  void  BeginOfRun();
+  void  EndOfRun();
+
+  void  SetCheckpoint(Checkpoint* checkpoint) { fCheckpoint = checkpoint; }
+  void  SetColumnarWriter(ColumnarWriter* writer) { fColumnarWriter = writer; }
+  void  SetAcceptanceMap(AcceptanceMap* map) { fAcceptanceMap = map; }
+
+  AcceptanceMap* GetAcceptanceMap() const { return fAcceptanceMap; }
+
+  // primary of the current track
+  void  SetCurrentPrimary(const G4Track* track);
+  G4int GetCurrentPrimary() const { return fCurrentPrimary; }
+
+  EnergyBudget& GetEnergyBudget() { return fEnergyBudgets[fCurrentPrimary]; }
+  void  AddStep() { ++fNofSteps[fCurrentPrimary]; }
+  const EscapeFilter& GetEscapeFilter() const { return fEscapeFilter; }
+
 private:
   // methods
   CalorHitsCollection* GetHitsCollection(G4int hcID, const G4Event* event) const;
@@ -33,6 +85,26 @@ private:
   // data members
   G4int fDioHCID = -1;
   G4int fAnnHCID = -1;
+
+  std::vector<EnergyBudget> fEnergyBudgets;  // per primary
+  G4int fBudgetH1ID = -1; // ID of the first energy budget histogram
+
+  EscapeFilter fEscapeFilter;
+
+  DetectorResponse fResponse;
+
+  SequentialStopping fStopping;
+  RunProgress::Slot* fProgressSlot = nullptr;
+  std::vector<G4long> fNofSteps;      // per primary, of the current event
+
+  G4int fNofPrimaries = 1;
+  G4int fCurrentPrimary = 0;
+  std::vector<G4int> fPrimaryOfTrack; // per track ID, of the current event
+
+  Checkpoint* fCheckpoint = nullptr;  // owned by RunAction
+  ColumnarWriter* fColumnarWriter = nullptr;  // owned by RunAction
+  const QuasiRandom* fQuasiRandom = nullptr;  // owned by PrimaryGeneratorAction
+  AcceptanceMap* fAcceptanceMap = nullptr;    // owned by RunAction
 };
 
 }
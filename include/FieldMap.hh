@@ -0,0 +1,121 @@
+/// Field map class
+///
+/// A magnetic field tabulated on a regular 3D grid, read from a binary file
+/// and interpolated trilinearly; the field is zero outside the grid.
+///
+/// The file has an 80-byte header (FileHeader: magic "B4FMAP", version,
+/// byte order, number of points along x, y, z, origin and spacing in mm),
+/// followed by the field (bx, by, bz) in tesla at each point as floats,
+/// x running fastest.
+///
+/// The grid is read once per file and shared by the threads. It is stored
+/// in bricks of 4x4x4 cells: the 5x5x5 points of a brick (its faces being
+/// repeated in the neighbouring bricks) are contiguous, each padded to 16
+/// bytes, so that the 8 corners of any cell lie in one brick, within 2 KB.
+/// The interpolation is done on the (bx, by, bz) vectors with SSE when
+/// available. Each field object (one per thread) caches the cell of its
+/// last query, which successive steps of a track usually hit again.
+///
+/// Benchmark() compares the evaluations per second with a straightforward
+/// implementation (a flat array of points, with the index computed and
+/// 24 values loaded for each query), on random tracks through the grid.
+
+/// \file FieldMap.hh
+/// \brief Definition of the B4c::FieldMap class
+
+#ifndef B4cFieldMap_h
+#define B4cFieldMap_h 1
+
+#include "G4MagneticField.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace B4c
+{
+class FieldMap : public G4MagneticField
+{
+  public:
+    // the map of the file, shared with the other threads
+    explicit FieldMap(const G4String& fileName);
+    ~FieldMap() override = default;
+
+    G4bool IsValid() const { return fGrid != nullptr; }
+
+    void GetFieldValue(const G4double point[4], G4double* field) const override;
+
+    // field evaluations/s, with the map of the file, or a test map if empty
+    static void Benchmark(const G4String& fileName, G4int nofPoints);
+    // write the test map, as an example of the format
+    static G4bool WriteTestMap(const G4String& fileName);
+
+  private:
+    struct FileHeader {
+      char          magic[8];
+      std::uint32_t version;
+      std::uint32_t byteOrder;
+      std::uint32_t nofPoints[3];   // x, y, z
+      std::uint32_t reserved;
+      G4double      origin[3];      // mm
+      G4double      spacing[3];     // mm
+    };
+
+    struct alignas(16) Point {
+      float b[4];                   // bx, by, bz (tesla), padding
+    };
+
+    static constexpr G4int kBrickCells = 4;
+    static constexpr G4int kBrickPoints = kBrickCells + 1;
+
+    struct Grid {
+      std::array<G4int, 3> nofPoints{};
+      std::array<G4int, 3> nofBricks{};
+      G4ThreeVector origin;
+      G4ThreeVector spacing;
+      G4ThreeVector invSpacing;
+      std::vector<Point> bricks;
+    };
+
+    // per-thread cache of the last query
+    struct Cache {
+      std::array<G4int, 3> cell{ -1, -1, -1 };
+      const Point* corner = nullptr;  // lowest corner of the cell in its brick
+    };
+
+    explicit FieldMap(std::shared_ptr<const Grid> grid) : fGrid(std::move(grid)) {}
+
+    static std::shared_ptr<const Grid> GetGrid(const G4String& fileName);
+    // the grid, and the field at each point
+    static std::shared_ptr<Grid> Read(const G4String& fileName, std::vector<float>& field);
+    // the grid from the field at each point, x running fastest
+    static std::shared_ptr<Grid> Build(const std::array<G4int, 3>& nofPoints,
+                                       const G4ThreeVector& origin, const G4ThreeVector& spacing,
+                                       const std::vector<float>& field);
+    static std::shared_ptr<Grid> MakeTestGrid(std::vector<float>& field);
+
+    static void Interpolate(const Point* corner, G4double fx, G4double fy, G4double fz,
+                            G4double* field);
+    void Evaluate(const G4double point[4], G4double* field, G4bool useCache) const;
+
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kByteOrder = 0x01020304;
+
+    std::shared_ptr<const Grid> fGrid;
+    mutable Cache fCache;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void FieldMap::GetFieldValue(const G4double point[4], G4double* field) const {
+  Evaluate(point, field, true);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,74 @@
+/// Geometry cache class
+///
+/// It exports the built geometry to GDML, and starts from a cached GDML
+/// file instead of the C++ builder when one is available.
+///
+/// The cache is off by default, and enabled with /B4/geometry/cache. The
+/// cache file of a layout is named after the hash of the layout parameters
+/// and of the builder version of the DetectorConstruction
+/// (geometry_<hash>.gdml by default): it is written when the builder runs and the layout has no overlaps, and
+/// read at the next construction with the same parameters, which skips the
+/// builder, its overlap checks and its visualisation attributes. Each file
+/// stores, as GDML auxiliary information, the parameter hash, the
+/// GeometryHash of the built geometry (its content hash, also stored by the
+/// response matrix and the acceptance map) and the time taken by the builder,
+/// so that the startup time saved is reported. A file with another parameter
+/// hash is ignored, and the builder used.
+///
+/// /B4/gdml/export writes the current geometry to a given file, to be shared.
+///
+/// GDML needs Geant4 built with it (B4_USE_GDML); otherwise the builder is
+/// always used.
+///
+/// It lives on the master, with the DetectorConstruction; the commands are
+/// not broadcast.
+
+/// \file GeometryCache.hh
+/// \brief Definition of the B4c::GeometryCache class
+
+#ifndef B4cGeometryCache_h
+#define B4cGeometryCache_h 1
+
+#include "globals.hh"
+
+#include <cstdint>
+
+class G4GenericMessenger;
+class G4VPhysicalVolume;
+
+namespace B4c
+{
+class GeometryCache
+{
+  public:
+    GeometryCache();
+    ~GeometryCache();
+
+    // the cache files are used and written only when enabled (by default not)
+    void SetEnabled(G4bool enabled) { fEnabled = enabled; }
+
+    // the world read from the cache file of the parameters, nullptr if none
+    G4VPhysicalVolume* Read(std::uint64_t parameterHash);
+    // a world just built in the given time; cached unless it has overlaps
+    void Built(const G4VPhysicalVolume* world, std::uint64_t parameterHash,
+               G4double buildTime, G4bool overlaps);
+
+  private:
+    void Export(const G4String& fileName);
+    G4String GetFileName(std::uint64_t parameterHash) const;
+    G4bool Write(const G4String& fileName, const G4VPhysicalVolume* world) const;
+
+    G4bool   fEnabled = false;
+    G4String fPrefix = "geometry_";
+    G4GenericMessenger* fMessenger = nullptr;
+
+    // last construction
+    std::uint64_t fParameterHash = 0;
+    G4double fBuildTime = 0.;       // of the builder, 0 if unknown
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,45 @@
+/// Geometry hash class
+///
+/// It computes a 64-bit FNV-1a hash of the geometry in memory: for each
+/// physical volume of the tree, its name, copy number, placement, logical
+/// volume, material (name and density) and solid parameters. Files derived
+/// from a simulation (e.g. the response matrix cache) store it, so that they
+/// are recognised as outdated when the geometry changes. The hash of any
+/// string (e.g. of the layout parameters, GeometryCache) is computed the
+/// same way.
+
+/// \file GeometryHash.hh
+/// \brief Definition of the B4c::GeometryHash class
+
+#ifndef B4cGeometryHash_h
+#define B4cGeometryHash_h 1
+
+#include "globals.hh"
+
+#include <cstdint>
+#include <string>
+
+class G4VPhysicalVolume;
+
+namespace B4c
+{
+class GeometryHash
+{
+  public:
+    // hash of the tracking world, 0 if there is no geometry
+    static std::uint64_t Compute();
+    static std::uint64_t Compute(const G4VPhysicalVolume* world);
+    static std::uint64_t Compute(const std::string& data);
+
+    static std::string ToString(std::uint64_t hash);
+
+  private:
+    static void Add(std::uint64_t& hash, const G4VPhysicalVolume* volume);
+    static void Add(std::uint64_t& hash, const std::string& data);
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
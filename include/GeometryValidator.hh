@@ -0,0 +1,75 @@
+/// Geometry validator class
+///
+/// It compares the nested and the flat builds of the DetectorConstruction
+/// (/B4/geometry/flat) by tracing the same random straight rays through
+/// them with a navigator, without any physics:
+///
+/// - /B4/validator/run checks that both builds have the same material
+///   layout: along each ray, the sequences of materials and segment lengths
+///   (adjacent segments of the same material merged) must agree within
+///   a tolerance;
+/// - /B4/validator/benchmark times the navigation of the rays in each build,
+///   and reports the steps per second and the time per step; the results
+///   are appended to navigation_benchmark.dat.
+///
+/// The rays start uniformly in the world and aim at the array. The geometry
+/// is rebuilt for each build, then restored.
+///
+/// It lives on the master; the commands are not broadcast.
+
+/// \file GeometryValidator.hh
+/// \brief Definition of the B4c::GeometryValidator class
+
+#ifndef B4cGeometryValidator_h
+#define B4cGeometryValidator_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+class G4Material;
+class G4VPhysicalVolume;
+
+namespace B4c
+{
+class GeometryValidator
+{
+  public:
+    GeometryValidator();
+    ~GeometryValidator();
+
+  private:
+    struct Segment {
+      const G4Material* material;
+      G4double length;
+    };
+    using Path = std::vector<Segment>;
+
+    void Validate();
+    void Benchmark();
+
+    // rebuild the geometry in the given build; false if it failed
+    G4bool Build(G4bool flat) const;
+    void GenerateRays();
+    // trace all the rays; the paths are filled if not null
+    G4long Trace(std::vector<Path>* paths) const;
+
+    static constexpr G4int kMaxSteps = 100000;   // per ray
+
+    G4int    fNofRays = 100000;
+    G4int    fSeed = 12345;
+    G4double fTolerance;
+    G4String fFileName = "navigation_benchmark.dat";
+    G4GenericMessenger* fMessenger = nullptr;
+
+    std::vector<G4ThreeVector> fOrigins;
+    std::vector<G4ThreeVector> fDirections;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
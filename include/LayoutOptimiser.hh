@@ -0,0 +1,101 @@
+/// Layout optimiser class
+///
+/// It searches the layout parameters of the DetectorConstruction (the
+/// /B4/geometry/ commands) for the maximum collective efficiency, averaged
+/// over a list of source positions (the source at (0, 0, -z), as in
+/// run2.mac).
+///
+/// The candidates are the current layout and a Latin hypercube sample of the
+/// parameter ranges. They are evaluated by successive halving: in each round
+/// every remaining candidate runs a batch of events at each position, the
+/// geometry being rebuilt in-process for it, and the better half by running
+/// efficiency is kept for the next round, with twice the events, until one
+/// candidate is kept. Most of the events thus go to the promising layouts.
+/// A layout with overlapping volumes is dropped. The events of each
+/// candidate run on all the threads.
+///
+/// Each round is appended to layout_optimiser.dat, and the best layout is
+/// applied at the end.
+///
+/// It lives on the master; the commands are not broadcast.
+
+/// \file LayoutOptimiser.hh
+/// \brief Definition of the B4c::LayoutOptimiser class
+
+#ifndef B4cLayoutOptimiser_h
+#define B4cLayoutOptimiser_h 1
+
+#include "Run.hh"
+#include "globals.hh"
+
+#include <array>
+#include <iosfwd>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class LayoutOptimiser
+{
+  public:
+    LayoutOptimiser();
+    ~LayoutOptimiser();
+
+    // master: count the detections of the candidate being evaluated
+    void EndOfRun(const Run* run);
+
+  private:
+    enum Parameter { kAngle, kAperture, kDetectZdist, kAnDetectZdist, kAnInnerRadius,
+                     kNofParameters };
+    using Values = std::array<G4double, kNofParameters>;
+
+    struct Range {
+      G4bool   active = false;
+      G4double min = 0.;
+      G4double max = 0.;
+    };
+
+    struct Candidate {
+      G4int  id = 0;
+      Values values{};
+      std::vector<G4long> nofEvents;    // per source position
+      std::vector<G4long> nofDetected;
+      G4double GetEfficiency() const;
+      G4double GetError() const;
+      G4long GetNofEvents() const;
+    };
+
+    void SetRange(const G4String& value);
+    void SetPositions(const G4String& value);
+    void Optimise();
+
+    Values GetCurrentValues() const;
+    std::vector<Candidate> Sample() const;
+    // rebuild the geometry with the values; false if it has overlaps
+    G4bool Apply(const Values& values) const;
+    void Evaluate(Candidate& candidate, G4int nofEvents);
+    void Print(std::ostream& os, G4int round, const Candidate& candidate, G4bool kept) const;
+
+    static G4double GetUnit(G4int parameter);
+    static const char* GetUnitName(G4int parameter);
+
+    // configuration
+    std::array<Range, kNofParameters> fRanges;
+    std::vector<G4double> fPositions;   // source distances
+    G4int    fNofCandidates = 16;
+    G4int    fNofEvents = 2000;         // per position in the first round
+    G4int    fSeed = 12345;
+    G4String fFileName = "layout_optimiser.dat";
+    G4GenericMessenger* fMessenger = nullptr;
+
+    // candidate being evaluated
+    Candidate* fCurrent = nullptr;
+    G4int fCurrentPosition = -1;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
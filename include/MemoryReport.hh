@@ -0,0 +1,98 @@
+/// Memory report class
+///
+/// It accounts for the memory of the process and of the structures owned by
+/// the project in each thread, by category:
+///
+/// - run counters: the B4c::Run object (threshold spectra, replica and
+///   acceptance counters);
+/// - hit pool: the pages of the CalorHit allocator;
+/// - histograms: the bins of the H1s of the analysis manager;
+/// - ntuple buffers: the configured baskets of the ntuple columns;
+/// - random engine: the state of the thread engine.
+///
+/// Each thread records its structures after its initialisation (beginning
+/// of run) and at the end of run, in its own slot. At the end of run the
+/// master prints them per category (mean and maximum over the workers,
+/// master, all threads), with the resident memory of the process; the
+/// remainder of the resident memory is shared or owned by Geant4 (physics
+/// tables, geometry, libraries). The workers are created during the first
+/// run of the job: the growth of the resident memory over that run, divided
+/// by the number of workers, is the measured cost of a thread, and is not
+/// given for the later runs. A line per run is appended to memory_report.dat,
+/// after a header line when the file is new.
+///
+/// The report is enabled with /B4/memory/report.
+
+/// \file MemoryReport.hh
+/// \brief Definition of the B4c::MemoryReport class
+
+#ifndef B4cMemoryReport_h
+#define B4cMemoryReport_h 1
+
+#include "globals.hh"
+
+#include <array>
+#include <cstddef>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class Run;
+
+class MemoryReport
+{
+  public:
+    static constexpr G4int kMaxSlots = 257; // sequential/master + 256 workers
+
+    enum Category { kRunCounters, kHitPool, kHistograms, kNtupleBuffers, kRandomEngine,
+                    kNofCategories };
+    enum Phase { kInitialisation, kEndOfRun, kNofPhases };
+
+    using Usage = std::array<std::size_t, kNofCategories>;   // bytes
+
+    struct Process {
+      std::size_t resident = 0;   // 0 if unknown
+      std::size_t peak = 0;
+    };
+
+    static MemoryReport* Instance();
+    static Process ReadProcess();
+    static const char* GetName(G4int category);
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    // the project structures of the calling thread
+    static Usage Measure(const Run* run, std::size_t ntupleBytes);
+
+    // master, at each run: clear the slots, read the process memory before
+    // the workers start
+    void BeginOfRun();
+    // record the usage of the calling thread
+    void Record(Phase phase, const Usage& usage);
+    // master: print and append to memory_report.dat
+    void EndOfRun(G4int runID) const;
+
+  private:
+    MemoryReport();
+
+    struct Slot {
+      G4bool recorded = false;
+      std::array<Usage, kNofPhases> usage{};
+    };
+
+    G4bool fEnabled = false;
+    G4GenericMessenger* fMessenger = nullptr;
+
+    G4int  fNofRuns = 0;            // in the job
+    G4bool fFirstRun = false;       // the workers start in the current run
+
+    Process fStart;                 // at the beginning of run
+    std::array<Slot, kMaxSlots> fSlots;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -4,6 +4,21 @@
 /// perpendicular to the input face. The type of the particle
 /// can be changed via the G4 build-in commands of G4ParticleGun class
 /// (see the macros provided with this example).
+///
+/// The emission point is spread around the gun position and the energy is
+/// sampled from a spectrum according to the B4c::Source settings.
+/// The direction is isotropic, from pseudo-random numbers or, when enabled,
+/// from the randomised Sobol points of B4c::QuasiRandom. The directions are
+/// counted in the B4c::Run, which tests their isotropy at the end of run.
+/// In the acceptance mapping mode, the gun position is replaced by the grid
+/// cell of the event given by B4c::AcceptanceMap, and the directions are
+/// pseudo-random.
+///
+/// An event may carry several independent primaries (option -p of
+/// exampleB4c), each in its own vertex and sampled as the primary of a
+/// separate event would be: primary k of an event has the index
+/// GetPrimaryIndex(event, k) in the quasi-random sequence and the
+/// acceptance grid.
 
 /// \file PrimaryGeneratorAction.hh
 /// \brief Definition of the PrimaryGeneratorAction class
@@ -12,6 +27,9 @@
 #define B4PrimaryGeneratorAction_h 1
 
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "AcceptanceMap.hh"
+#include "QuasiRandom.hh"
+#include "Source.hh"
 #include "globals.hh"
 
 class G4ParticleGun;
@@ -31,8 +49,30 @@ public:
   // set methods
   void SetRandomFlag(G4bool value);
 
+  // get methods
+  const B4c::QuasiRandom& GetQuasiRandom() const { return fQuasiRandom; }
+
+  void SetAcceptanceMap(const B4c::AcceptanceMap* map) { fAcceptanceMap = map; }
+
+  // index of an event in the quasi-random sequence
+  static G4long GetEventIndex(const G4Event* event);
+  // index of a primary of an event, as if each primary were an event
+  static G4long GetPrimaryIndex(const G4Event* event, G4int primary);
+
+  // number of primaries per event, set from the command line before the first run
+  static void SetNofPrimaries(G4int value) { fNofPrimaries = value; }
+  static G4int GetNofPrimaries() { return fNofPrimaries; }
+  // number of events to generate at least a number of primaries
+  static G4int GetNofEvents(G4long nofPrimaries)
+    { return G4int((nofPrimaries + fNofPrimaries - 1)/fNofPrimaries); }
+
 private:
   G4ParticleGun* fParticleGun = nullptr; // G4 particle gun
+  B4c::Source fSource;
+  B4c::QuasiRandom fQuasiRandom;
+  const B4c::AcceptanceMap* fAcceptanceMap = nullptr; // owned by RunAction
+
+  static G4int fNofPrimaries;
 };
 
 }
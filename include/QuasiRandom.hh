@@ -0,0 +1,71 @@
+/// Quasi-random class
+///
+/// It provides the emission directions from a two-dimensional Sobol
+/// sequence instead of pseudo-random numbers. The points are randomised
+/// with a digital shift (XOR with a random 32-bit word per dimension), which
+/// keeps their low discrepancy.
+///
+/// The events are split into R replicas: event ID i belongs to replica
+/// i % R and uses point i / R of the sequence, shifted by the replica's own
+/// shift. The point of an event therefore depends only on its ID, whatever
+/// the thread that processes it. Each replica is an independent randomised
+/// QMC estimate, and the spread of the replica efficiencies gives the error
+/// (see Run).
+///
+/// The mode is configured with the /B4/qmc/ commands.
+
+/// \file QuasiRandom.hh
+/// \brief Definition of the B4c::QuasiRandom class
+
+#ifndef B4cQuasiRandom_h
+#define B4cQuasiRandom_h 1
+
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class QuasiRandom
+{
+  public:
+    static constexpr G4int kNofDimensions = 2;
+    static constexpr G4int kNofBits = 32;
+
+    QuasiRandom();
+    ~QuasiRandom();
+
+    G4bool IsEnabled() const { return fEnabled; }
+    G4int GetNofReplicas() const { return fNofReplicas; }
+
+    // replica of an event, -1 when disabled
+    G4int GetReplica(G4long eventIndex) const
+      { return fEnabled ? G4int(eventIndex % fNofReplicas) : -1; }
+
+    // point of an event in [0,1)^2
+    void GetPoint(G4long eventIndex, G4double point[kNofDimensions]);
+
+  private:
+    void BuildShifts();
+
+    G4bool fEnabled = false;
+    G4int  fNofReplicas = 16;
+    G4long fSeed = 12345;
+    G4GenericMessenger* fMessenger = nullptr;
+
+    // shifts of each replica, built for the current seed and replicas
+    std::vector<std::array<std::uint32_t, kNofDimensions>> fShifts;
+    G4long fShiftSeed = -1;
+
+    static const std::array<std::array<std::uint32_t, kNofBits>, kNofDimensions>& GetDirections();
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
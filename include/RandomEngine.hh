@@ -0,0 +1,68 @@
+/// Random engine class
+///
+/// It selects the CLHEP random engine of the job, with the -e and -s
+/// options of exampleB4c, before the run manager is created: mixmax (the
+/// Geant4 default), ranluxpp, ranlux, ranlux64, mtwist, ranecu, james,
+/// ranshi or dualrand. In multi-threaded mode the workers get an engine of
+/// the same type when they start, and each event is seeded from the master
+/// engine, so that the events are reproducible for a given engine and seed
+/// whatever the number of threads. The MT and tasking run managers record
+/// the master engine when they are created, so the /B4/random/engine
+/// command is only accepted in sequential mode, before the first run.
+///
+/// /B4/random/benchmark times each engine on its own: the random numbers
+/// per second, one at a time (flat) and in arrays (flatArray), and the
+/// cost of seeding it with two seeds, as the MT run manager does for each
+/// event. The results are appended to rng_benchmark.dat; the events per
+/// second of each engine are measured by rng.sh.
+///
+/// It lives on the master; the commands are not broadcast.
+
+/// \file RandomEngine.hh
+/// \brief Definition of the B4c::RandomEngine class
+
+#ifndef B4cRandomEngine_h
+#define B4cRandomEngine_h 1
+
+#include "globals.hh"
+
+namespace CLHEP
+{
+class HepRandomEngine;
+}
+class G4GenericMessenger;
+
+namespace B4c
+{
+class RandomEngine
+{
+  public:
+    RandomEngine();
+    ~RandomEngine();
+
+    // set the engine of the job, and its seed if positive
+    static G4bool Select(const G4String& name, G4long seed = 0);
+    // a new engine, nullptr if the name is unknown
+    static CLHEP::HepRandomEngine* Create(const G4String& name);
+    static const char* GetNames() { return kNames; }
+
+    // master: the engine is reported, and kept, from the first run
+    void BeginOfRun();
+
+  private:
+    void SetEngine(const G4String& name);
+    void Benchmark(G4int nofNumbers) const;
+
+    static constexpr const char* kNames
+      = "mixmax ranluxpp ranlux ranlux64 mtwist ranecu james ranshi dualrand";
+
+    static G4String fName;
+    G4bool fStarted = false;
+    G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,113 @@
+/// Response matrix class
+///
+/// It builds and uses a cache of the detector response: the deposit spectra
+/// of the diode and the annular detector, per emitted particle, over a grid
+/// of source distances z (the source at (0, 0, -z), as in run2.mac) and
+/// energies E.
+///
+/// /B4/matrix/build runs one run per grid point and stores the Run spectra
+/// (1 keV bins) in a binary file, with an index giving the position of each
+/// grid point in the file, and the geometry hash (GeometryHash).
+///
+/// /B4/matrix/fold answers a query (z, source spectrum) from the cache only:
+/// the spectra of the four neighbouring grid points are interpolated
+/// linearly in z and in E, the energy axis of each being scaled to the
+/// requested energy, and folded with the source spectrum. A cache built for
+/// another geometry is rejected.
+///
+/// It lives on the master; the commands are not broadcast.
+
+/// \file ResponseMatrix.hh
+/// \brief Definition of the B4c::ResponseMatrix class
+
+#ifndef B4cResponseMatrix_h
+#define B4cResponseMatrix_h 1
+
+#include "Run.hh"
+#include "globals.hh"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class ResponseMatrix
+{
+  public:
+    ResponseMatrix();
+    ~ResponseMatrix();
+
+    // master: store the spectra of the grid point being built
+    void EndOfRun(const Run* run);
+
+    // parse a grid "min max n" of n equidistant values; false if malformed
+    static G4bool ParseGrid(const G4String& value, G4double unit, std::vector<G4double>& grid);
+
+  private:
+    // file layout: header, positions, energies, index, then the spectra of
+    // each grid point as (bin, count) pairs of the filled bins
+    struct FileHeader {
+      char          magic[8];
+      std::uint32_t version;
+      std::uint32_t nofDetectors;
+      std::uint64_t geometryHash;
+      std::uint32_t nofPositions;
+      std::uint32_t nofEnergies;
+      std::uint32_t nofBins;
+      std::uint32_t byteOrder;
+      G4double      binWidth;       // MeV
+      std::uint8_t  reserved[16];
+    };
+    struct IndexEntry {
+      std::uint64_t offset;         // from the file start
+      std::uint64_t nofEvents;
+      std::uint32_t nofFilled[Run::kNofDetectors];
+    };
+    using Spectrum = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+    struct GridPoint {
+      G4long nofEvents = 0;
+      std::array<Spectrum, Run::kNofDetectors> spectra;
+      std::array<G4long, Run::kNofDetectors> nofDetected{};
+    };
+
+    void SetPositions(const G4String& value);
+    void SetEnergies(const G4String& value);
+    void Build();
+    void Fold(const G4String& value);
+
+    G4bool Write() const;
+    G4bool Load();
+
+    // interpolation interval and weight of the upper point
+    static G4bool Locate(const std::vector<G4double>& grid, G4double value,
+                         std::size_t& lower, G4double& weight);
+
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kByteOrder = 0x01020304;
+
+    // configuration
+    std::vector<G4double> fPositions;   // source distances, increasing
+    std::vector<G4double> fEnergies;    // increasing
+    G4int    fNofEvents = 100000;       // per grid point
+    G4String fFileName = "response_matrix.b4rm";
+    G4GenericMessenger* fMessenger = nullptr;
+
+    // grid points being built or loaded
+    std::vector<GridPoint> fGrid;
+    G4int  fCurrentPoint = -1;
+    std::vector<G4double> fGridPositions;
+    std::vector<G4double> fGridEnergies;
+    G4bool fLoaded = false;             // fGrid matches the cache file
+    std::uint64_t fLoadedHash = 0;      // geometry of the cache
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
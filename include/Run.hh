@@ -0,0 +1,246 @@
+/// Run class
+///
+/// It accumulates the run statistics which are not handled by the analysis
+/// manager. In multi-threading mode each thread fills its own Run object,
+/// which is merged into the master one in Merge().
+///
+/// The per-volume energy budget is accumulated for all events and separately
+/// for the partial depositors, i.e. the events with an energy deposit in
+/// the diode lower than the primary energy.
+///
+/// The number of secondaries stacked and killed by the StackingAction,
+/// with the energy deposited locally and the maximum stack size, are
+/// accumulated to report the stacking statistics and throughput, as well as
+/// the number of primaries killed as geometrically escaped.
+///
+/// The number of events with an energy deposit in the diode, in the annular
+/// detector and in either of them give the detection efficiencies.
+/// The deposits in each detector are also counted in fine-binned 32-bit
+/// integer spectra (a run has fewer events than that), as each thread holds
+/// a copy; at the end of run their reverse cumulative sum gives the
+/// efficiency versus discriminator threshold curve of each detector, which
+/// is appended to threshold_curve.dat.
+///
+/// With quasi-random directions, the detections are also counted per
+/// replica; the spread of the replica efficiencies gives the randomised QMC
+/// error, appended to rqmc_summary.dat.
+///
+/// In the acceptance mapping mode, the events and detections of each
+/// detector are counted per source grid cell (AcceptanceMap).
+///
+/// The directions of the primaries are counted, by the generator, in a
+/// (cos theta, phi) map and in a histogram of each of px, py, pz and phi,
+/// all uniform for an isotropic source. At the end of run, the map is
+/// tested with a chi-square, and each histogram with a chi-square and a
+/// Kolmogorov-Smirnov test (at the bin edges); the results are appended
+/// to isotropy_summary.dat.
+///
+/// The entries of the primaries into the diode and the annular detector
+/// are counted, by the sensitive detectors, in the EntryMaps of each
+/// detector; at the end of run they are summarised and appended to
+/// entry_maps.dat.
+///
+/// An event with several primaries is recorded as that many events, so that
+/// the number of events and all the efficiencies are per primary.
+///
+/// Write() and Read() save and restore all the counters for checkpointing.
+///
+/// In EndOfRun(), the merged statistics are printed, and the efficiencies
+/// with their binomial errors are appended to efficiency_summary.dat.
+
+/// \file Run.hh
+/// \brief Definition of the B4c::Run class
+
+#ifndef B4cRun_h
+#define B4cRun_h 1
+
+#include "G4Run.hh"
+#include "AcceptanceMap.hh"
+#include "EnergyBudget.hh"
+#include "EntryMaps.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace B4c
+{
+class Run : public G4Run
+{
+  public:
+    enum Detector { kDiodeDetector, kAnnularDetector, kNofDetectors };
+    enum Component { kPx, kPy, kPz, kPhi, kNofComponents };
+
+    // binning of the threshold spectra
+    static constexpr G4int    kNofThresholdBins = 10000;
+    static constexpr G4double kThresholdBinWidth = 1.*keV;
+
+    // binning of the direction histograms
+    static constexpr G4int kNofDirectionBins = 200;   // px, py, pz and phi
+    static constexpr G4int kNofCosThetaBins = 20;
+    static constexpr G4int kNofPhiBins = 36;
+
+    Run();
+    ~Run() override = default;
+
+    // methods from base class
+    void RecordEvent(const G4Event* event) override;
+    void Merge(const G4Run* run) override;
+
+    // methods to handle data
+    void AddBudget(const EnergyBudget& budget, G4bool partialDepositor);
+    inline void AddStackedSecondary(G4int stackSize);
+    inline void AddKilledSecondary(G4double energy);
+    inline void AddEscaped();
+    inline void AddDetection(G4double diodeEdep, G4double annularEdep);
+    inline void AddReplica(G4int replica, G4bool diode, G4bool annular);
+    inline void AddAcceptance(std::size_t cell, unsigned detected);
+    // direction of a primary, phi in [0, 2 pi)
+    inline void AddDirection(G4double px, G4double py, G4double pz, G4double phi);
+    // entry of a primary into a detector (EntryMaps::Add)
+    inline void AddEntry(G4int detector, const G4ThreeVector& halfSize,
+                         const G4ThreeVector& position, const G4ThreeVector& direction,
+                         const G4ThreeVector& normal, G4double energy);
+
+    // get methods
+    G4long GetNofDiode() const { return fNofDiode; }
+    G4long GetNofAnnular() const { return fNofAnnular; }
+    G4long GetNofCollective() const { return fNofCollective; }
+    const std::vector<std::uint32_t>& GetSpectrum(G4int detector) const
+      { return fSpectra[detector]; }
+    const EntryMaps& GetEntryMaps(G4int detector) const { return fEntryMaps[detector]; }
+
+    // number of events, then of detections per map, per acceptance grid cell
+    using AcceptanceCounts = std::array<G4long, 1+AcceptanceMap::kNofMaps>;
+    const std::vector<AcceptanceCounts>& GetAcceptance() const { return fAcceptance; }
+
+    // save/restore all the counters, including the number of events
+    void Write(std::ostream& os) const;
+    void Read(std::istream& is);
+
+    // bytes held by the object (MemoryReport)
+    std::size_t GetMemorySize() const;
+
+    // print the merged statistics; realTime is the elapsed time of the run
+    void EndOfRun(G4double realTime) const;
+
+  private:
+    inline void AddToSpectrum(G4int detector, G4double edep);
+    void WriteThresholdCurve() const;
+    void WriteReplicaEfficiencies() const;
+    void WriteIsotropy() const;
+    void WriteEntryMaps() const;
+
+    using BudgetArray = std::array<G4double, EnergyBudget::kNofVolumes>;
+
+    BudgetArray fBudgetSum{};        ///< Sum of Edep per volume
+    BudgetArray fBudgetSum2{};       ///< Sum of Edep^2 per volume
+    BudgetArray fPartialBudgetSum{}; ///< Sum of Edep per volume for partial depositors
+    G4int fNofPartial = 0;           ///< Number of partial depositors
+
+    G4long   fNofStacked = 0;        ///< Number of secondaries pushed to the stack
+    G4long   fNofKilled = 0;         ///< Number of secondaries killed at creation
+    G4double fKilledEnergy = 0.;     ///< Energy deposited locally by killed secondaries
+    G4int    fMaxStackSize = 0;      ///< Maximum number of tracks in the stack
+
+    G4long   fNofEscaped = 0;        ///< Number of geometrically escaped primaries
+
+    G4long   fNofDiode = 0;          ///< Number of events detected in the diode
+    G4long   fNofAnnular = 0;        ///< Number of events detected in the annular
+    G4long   fNofCollective = 0;     ///< Number of events detected in either
+
+    /// Number of events per Edep bin (Edep > 0, last bin with overflow)
+    std::array<std::vector<std::uint32_t>, kNofDetectors> fSpectra;
+
+    /// Number of events, diode, annular and collective detections per QMC replica
+    std::vector<std::array<G4long, 4>> fReplicas;
+
+    /// Number of events and detections per map, per acceptance grid cell
+    std::vector<AcceptanceCounts> fAcceptance;
+
+    /// Number of primaries per bin of px, py, pz and phi
+    std::array<std::vector<std::uint32_t>, kNofComponents> fDirections;
+    /// Number of primaries per (cos theta, phi) bin, phi varying fastest
+    std::vector<std::uint32_t> fDirectionMap;
+
+    /// Entries of the primaries into each detector
+    std::array<EntryMaps, kNofDetectors> fEntryMaps;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void Run::AddStackedSecondary(G4int stackSize) {
+  ++fNofStacked;
+  if ( stackSize > fMaxStackSize ) fMaxStackSize = stackSize;
+}
+
+inline void Run::AddKilledSecondary(G4double energy) {
+  ++fNofKilled;
+  fKilledEnergy += energy;
+}
+
+inline void Run::AddEscaped() {
+  ++fNofEscaped;
+}
+
+inline void Run::AddDetection(G4double diodeEdep, G4double annularEdep) {
+  G4bool diode = ( diodeEdep > 0. );
+  G4bool annular = ( annularEdep > 0. );
+  if ( diode ) ++fNofDiode;
+  if ( annular ) ++fNofAnnular;
+  if ( diode || annular ) ++fNofCollective;
+
+  if ( diode ) AddToSpectrum(kDiodeDetector, diodeEdep);
+  if ( annular ) AddToSpectrum(kAnnularDetector, annularEdep);
+}
+
+inline void Run::AddReplica(G4int replica, G4bool diode, G4bool annular) {
+  if ( replica >= G4int(fReplicas.size()) ) fReplicas.resize(replica+1, {});
+  auto& counts = fReplicas[replica];
+  ++counts[0];
+  if ( diode ) ++counts[1];
+  if ( annular ) ++counts[2];
+  if ( diode || annular ) ++counts[3];
+}
+
+inline void Run::AddAcceptance(std::size_t cell, unsigned detected) {
+  if ( cell >= fAcceptance.size() ) fAcceptance.resize(cell+1, {});
+  auto& counts = fAcceptance[cell];
+  ++counts[0];
+  for ( G4int map=0; map<AcceptanceMap::kNofMaps; ++map ) {
+    if ( detected & (1u << map) ) ++counts[1+map];
+  }
+}
+
+inline void Run::AddDirection(G4double px, G4double py, G4double pz, G4double phi) {
+  // bin of a value in [0, 1)
+  auto bin = [](G4double u, G4int nofBins) { return std::min(G4int(u*nofBins), nofBins-1); };
+  auto u = phi/twopi;
+  ++fDirections[kPx][bin(0.5*(px + 1.), kNofDirectionBins)];
+  ++fDirections[kPy][bin(0.5*(py + 1.), kNofDirectionBins)];
+  ++fDirections[kPz][bin(0.5*(pz + 1.), kNofDirectionBins)];
+  ++fDirections[kPhi][bin(u, kNofDirectionBins)];
+  ++fDirectionMap[bin(0.5*(pz + 1.), kNofCosThetaBins)*kNofPhiBins + bin(u, kNofPhiBins)];
+}
+
+inline void Run::AddEntry(G4int detector, const G4ThreeVector& halfSize,
+                          const G4ThreeVector& position, const G4ThreeVector& direction,
+                          const G4ThreeVector& normal, G4double energy) {
+  fEntryMaps[detector].Add(halfSize, position, direction, normal, energy);
+}
+
+inline void Run::AddToSpectrum(G4int detector, G4double edep) {
+  auto bin = G4int(edep/kThresholdBinWidth);
+  ++fSpectra[detector][bin < kNofThresholdBins ? bin : kNofThresholdBins-1];
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -13,6 +13,35 @@
 /// The histograms and ntuple are saved in the output file in a format
 /// according to a specified file extension.
 ///
+/// In addition, one histogram per volume of the energy budget (Ebudget_*)
+/// is created; the mean budgets are accumulated in the B4c::Run object
+/// created in GenerateRun().
+///
+/// On worker threads, the begin and end of run are forwarded to the
+/// EventAction.
+///
+/// The run state is saved periodically by the B4c::Checkpoint object; on
+/// the master, the data restored from an interrupted job are added to the
+/// results before they are printed and saved.
+///
+/// The per-event quantities can also be written to columnar files by the
+/// B4c::ColumnarWriter, opened and closed here on the worker threads.
+///
+/// On the master, the B4c::RunMonitor writes snapshots of the run progress
+/// while the run goes on, the B4c::ResponseMatrix collects the spectra
+/// of each run when a response matrix is built, and the
+/// B4c::LayoutOptimiser the efficiencies of the candidate layouts. The
+/// B4c::GeometryValidator compares the nested and flat geometry builds,
+/// and the B4c::RandomEngine reports the random engine at the first run.
+///
+/// The B4c::AcceptanceMap of each thread places the sources on the grid
+/// of the acceptance mapping mode; the master writes the map of the run.
+///
+/// With /B4/memory/report, each thread records the memory of its
+/// structures in the B4c::MemoryReport after its initialisation and at the
+/// end of run, and the master prints the report. The ntuple baskets are
+/// sized down, and the pages of the hit pool are released at the end of run.
+///
 /// In EndOfRunAction(), the accumulated statistic and computed
 /// dispersion is printed.
 ///
@@ -23,22 +52,55 @@
 #ifndef B4RunAction_h
 #define B4RunAction_h 1
 
+#include "MemoryReport.hh"
+
 #include "G4UserRunAction.hh"
+#include "G4Timer.hh"
 #include "globals.hh"
 
 class G4Run;
 
+namespace B4c
+{
+class AcceptanceMap;
+class Checkpoint;
+class ColumnarWriter;
+class EventAction;
+class GeometryValidator;
+class LayoutOptimiser;
+class RandomEngine;
+class ResponseMatrix;
+class RunMonitor;
+}
+
 namespace B4
 {
 
 class RunAction : public G4UserRunAction
 {
   public:
-    RunAction();
+    RunAction(B4c::EventAction* eventAction = nullptr);
     ~RunAction() override;
 
+    G4Run* GenerateRun() override;
     void BeginOfRunAction(const G4Run*) override;
     void   EndOfRunAction(const G4Run*) override;
+
+    B4c::AcceptanceMap* GetAcceptanceMap() const { return fAcceptanceMap; }
+
+  private:
+    B4c::MemoryReport::Usage MeasureMemory(const G4Run* run) const;
+
+    B4c::EventAction* fEventAction = nullptr; // nullptr on master
+    B4c::Checkpoint* fCheckpoint = nullptr;
+    B4c::ColumnarWriter* fColumnarWriter = nullptr;
+    B4c::RunMonitor* fMonitor = nullptr;      // master only
+    B4c::ResponseMatrix* fResponseMatrix = nullptr;  // master only
+    B4c::LayoutOptimiser* fLayoutOptimiser = nullptr;  // master only
+    B4c::GeometryValidator* fGeometryValidator = nullptr;  // master only
+    B4c::RandomEngine* fRandomEngine = nullptr;  // master only
+    B4c::AcceptanceMap* fAcceptanceMap = nullptr;
+    G4Timer fTimer;                           // elapsed time of the run
 };
 
 }
@@ -0,0 +1,80 @@
+/// Run monitor class
+///
+/// On the master, it runs a thread which, every /B4/monitor/period seconds,
+/// reads the counters of all the threads in RunProgress and rewrites a small
+/// JSON snapshot file with the events done per thread, the event and step
+/// rates, the resident memory and the current diode, annular and collective
+/// efficiencies with their binomial errors. The counters are read with
+/// relaxed atomic loads, so the workers are never stalled. The file is
+/// written to a temporary file which is then renamed.
+///
+/// Optionally, the latest snapshot is also sent to each client connecting
+/// to a local Unix socket (/B4/monitor/socket), e.g.
+///   socat - UNIX-CONNECT:B4_monitor.sock
+
+/// \file RunMonitor.hh
+/// \brief Definition of the B4c::RunMonitor class
+
+#ifndef B4cRunMonitor_h
+#define B4cRunMonitor_h 1
+
+#include "globals.hh"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class RunMonitor
+{
+  public:
+    RunMonitor();
+    ~RunMonitor();
+
+    // called from the master RunAction
+    void Start(G4int runID);
+    void Stop();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void Loop();
+    G4String MakeSnapshot(G4bool finished);
+    void WriteSnapshot(const G4String& snapshot) const;
+
+    void OpenSocket();
+    void ServeClients();
+    void CloseSocket();
+
+    static G4long GetResidentMemory();
+
+    // configuration
+    G4bool   fEnabled = false;
+    G4double fPeriod = 5.;                 // seconds
+    G4String fFileName = "B4_monitor.json";
+    G4String fSocketPath;                  // empty = no socket
+    G4GenericMessenger* fMessenger = nullptr;
+
+    // monitoring thread
+    std::thread fThread;
+    std::atomic<G4bool> fStop{false};
+    G4int fRunID = -1;
+    Clock::time_point fStartTime;
+    Clock::time_point fLastTime;
+    G4long fLastEvents = 0;
+    G4long fLastSteps = 0;
+
+    std::mutex fSnapshotMutex;
+    G4String fSnapshot;                    // latest snapshot, for the socket
+    G4int fSocket = -1;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,104 @@
+/// Run progress class
+///
+/// It holds the per-thread event, detection and step counters of the current
+/// run, shared between the threads. Each thread owns one cache-line aligned slot
+/// which only it writes, so the counters are updated without contention;
+/// any thread may read the totals at any time while the run goes on.
+///
+/// A thread may request the other threads to stop their event loop; the
+/// reason is kept until the slots are reset by the master at the beginning
+/// of the next run.
+///
+/// The master also flags the runs of its internal scans (response matrix,
+/// acceptance map, layout optimiser): their per-run outputs (result files,
+/// histogram and ntuple file, columnar files, checkpoints) are not written,
+/// so that they do not mix with those of the user runs.
+
+/// \file RunProgress.hh
+/// \brief Definition of the B4c::RunProgress class
+
+#ifndef B4cRunProgress_h
+#define B4cRunProgress_h 1
+
+#include "globals.hh"
+
+#include <atomic>
+
+namespace B4c
+{
+class RunProgress
+{
+  public:
+    static constexpr G4int kMaxSlots = 257; // sequential/master + 256 workers
+
+    enum StopReason { kNotStopped, kPrecisionReached, kMaxEventsReached };
+
+    struct alignas(64) Slot {
+      std::atomic<G4long> events{0};
+      std::atomic<G4long> diode{0};      // events with Edep > 0 in the diode
+      std::atomic<G4long> annular{0};    // events with Edep > 0 in the annular
+      std::atomic<G4long> collective{0}; // events with Edep > 0 in either
+      std::atomic<G4long> steps{0};
+
+      // single writer: relaxed load and store are enough
+      inline void Increment(std::atomic<G4long>& counter, G4long n = 1);
+    };
+
+    struct Totals {
+      G4long events = 0;
+      G4long diode = 0;
+      G4long annular = 0;
+      G4long collective = 0;
+      G4long steps = 0;
+    };
+
+    static RunProgress* Instance();
+
+    void Reset();
+    Slot& GetSlot();              // slot of the calling thread
+    const Slot& GetSlot(G4int index) const { return fSlots[index]; }
+    Totals GetTotals() const;
+
+    // add the events of a previous job (resumed run) to the master slot
+    void Preload(const Totals& totals);
+
+    // record one event in the slot of the calling thread
+    void AddEvent(Slot& slot, G4bool diode, G4bool annular, G4long steps);
+
+    // returns true for the first request of the run
+    G4bool RequestStop(StopReason reason);
+    G4bool IsStopRequested() const
+      { return fStopReason.load(std::memory_order_relaxed) != kNotStopped; }
+    StopReason GetStopReason() const
+      { return StopReason(fStopReason.load(std::memory_order_relaxed)); }
+    static const char* GetStopReasonName(StopReason reason);
+
+    // master, around the BeamOn of an internal scan
+    void SetInternalScan(G4bool scan) { fInternalScan.store(scan, std::memory_order_relaxed); }
+    G4bool IsInternalScan() const { return fInternalScan.load(std::memory_order_relaxed); }
+
+    // master, around the BeamOn of a response matrix grid point: the primaries
+    // start at the gun position with the gun energy, whatever the source
+    void SetGunOnly(G4bool gunOnly) { fGunOnly.store(gunOnly, std::memory_order_relaxed); }
+    G4bool IsGunOnly() const { return fGunOnly.load(std::memory_order_relaxed); }
+
+  private:
+    RunProgress() = default;
+
+    Slot fSlots[kMaxSlots];
+    alignas(64) std::atomic<G4int> fStopReason{kNotStopped};
+    std::atomic<G4bool> fInternalScan{false};
+    std::atomic<G4bool> fGunOnly{false};
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline void RunProgress::Slot::Increment(std::atomic<G4long>& counter, G4long n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,63 @@
+/// Sequential stopping class
+///
+/// It ends a run as soon as the chosen detection efficiency (diode, annular
+/// or collective) is known to the requested precision, instead of running a
+/// fixed number of events. Every fCheckInterval local events, Check() reads
+/// the event and detection counters merged over all threads (RunProgress)
+/// and computes the relative binomial error of the efficiency,
+/// sqrt((1-p)/(n p)). When it drops below the target, or when the total
+/// number of events reaches the cap, a stop is requested in RunProgress and
+/// every thread aborts its event loop after the current event.
+///
+/// The stopping rule is configured with the /B4/stopping/ commands; it is
+/// disabled when the target precision is 0 (default). The number of events
+/// given to /run/beamOn is always an upper limit.
+
+/// \file SequentialStopping.hh
+/// \brief Definition of the B4c::SequentialStopping class
+
+#ifndef B4cSequentialStopping_h
+#define B4cSequentialStopping_h 1
+
+#include "RunProgress.hh"
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class SequentialStopping
+{
+  public:
+    SequentialStopping();
+    ~SequentialStopping();
+
+    G4bool IsEnabled() const { return fPrecision > 0. || fMaxEvents > 0; }
+
+    void BeginOfRun();
+
+    // called at the end of each event of the calling thread;
+    // returns true if the run must be aborted
+    G4bool Check(RunProgress* progress);
+
+    // relative binomial error of k detected out of n events
+    static G4double RelativeError(G4long k, G4long n);
+
+  private:
+    G4long GetDetected(const RunProgress::Totals& totals) const;
+
+    G4double fPrecision = 0.;             // target relative error
+    G4String fEfficiency = "collective";  // diode, annular or collective
+    G4int    fCheckInterval = 1000;       // local events between two checks
+    G4int    fMinEvents = 10000;          // no precision stop before
+    G4int    fMaxEvents = 0;              // cap on the total events, 0 = none
+
+    G4int fEventsSinceCheck = 0;
+    G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,89 @@
+/// Source class
+///
+/// It describes the emitter around the gun position:
+///  - shape: a point, a disk in the xy plane, or a cylinder (volume) along z,
+///    with an optional radial activity profile read from a file,
+///  - energy: the gun energy, or a tabulated spectrum read from a file, made
+///    of lines ("E weight") and/or bins ("Elow Ehigh weight"), in MeV.
+///
+/// The spectrum entries and the radial rings of the shape are sampled with
+/// alias tables, so that the cost per event does not depend on the number
+/// of lines or bins. /B4/source/selfTest compares sampled distributions with
+/// the expected ones (chi-square and Kolmogorov-Smirnov tests).
+///
+/// The source is configured with the /B4/source/ commands.
+
+/// \file Source.hh
+/// \brief Definition of the B4c::Source class
+
+#ifndef B4cSource_h
+#define B4cSource_h 1
+
+#include "AliasTable.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class Source
+{
+  public:
+    enum Shape { kPoint, kDisk, kVolume };
+
+    Source();
+    ~Source();
+
+    G4bool HasSpectrum() const { return ! fEnergyTable.IsEmpty(); }
+    G4bool IsExtended() const { return fShape != kPoint && fRadius > 0.; }
+
+    // position relative to the gun position, and energy
+    G4ThreeVector SamplePosition() const;
+    G4double SampleEnergy() const;
+
+    // energy entry: a line if high == low
+    struct Entry {
+      G4double low;
+      G4double high;
+    };
+
+    // read a spectrum file; false if it is missing or malformed
+    static G4bool ReadSpectrum(const G4String& fileName, std::vector<Entry>& entries,
+                               std::vector<G4double>& weights);
+
+  private:
+    void DefineCommands();
+    void SetShape(const G4String& shape);
+    void SetRadius(G4double radius);
+    void SetSpectrum(const G4String& fileName);
+    void SetRadialProfile(const G4String& fileName);
+    void SelfTest(G4int nofSamples);
+
+    void BuildRings();
+    G4double GetProfile(G4double radius) const;
+    G4double GetRadialCDF(G4double radius) const;
+
+    static constexpr G4int kNofRings = 100;
+
+    Shape    fShape = kPoint;
+    G4double fRadius = 0.;
+    G4double fThickness = 0.;
+
+    std::vector<Entry> fEntries;
+    AliasTable fEnergyTable;
+
+    std::vector<G4double> fProfileRadii;   // radial activity profile
+    std::vector<G4double> fProfileWeights;
+    AliasTable fRingTable;
+
+    G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
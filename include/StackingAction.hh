@@ -0,0 +1,78 @@
+/// Stacking action class
+///
+/// In ClassifyNewTrack(), the secondaries with a kinetic energy below a
+/// threshold defined per particle and per region are killed at creation.
+/// Their kinetic energy is deposited locally, in the volume where they were
+/// created: it is added to the energy budget of the event and, if the volume
+/// is sensitive, to the hits of its CalorimeterSD, so that the scored
+/// deposits are unchanged. The annihilation energy of a killed positron,
+/// 2 m_e c^2, is not deposited: the photons of a tracked positron would
+/// mostly leave the thin detectors, and crediting it locally would bias the
+/// deposits and the budget upwards.
+///
+/// The thresholds are set with the command
+///   /B4/stack/threshold <particle> <region|all> <value> <unit>
+/// The regions are defined in DetectorConstruction.
+///
+/// The number of stacked and killed secondaries and the maximum stack size
+/// are accumulated in the Run.
+
+/// \file StackingAction.hh
+/// \brief Definition of the B4c::StackingAction class
+
+#ifndef B4cStackingAction_h
+#define B4cStackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+class G4ParticleDefinition;
+class G4Region;
+
+namespace B4c
+{
+class EventAction;
+class Run;
+
+class StackingAction : public G4UserStackingAction
+{
+public:
+  StackingAction(EventAction* eventAction);
+  ~StackingAction() override;
+
+  G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+  void PrepareNewEvent() override;
+
+  // set methods
+  void SetThreshold(const G4String& value);
+  void ClearThresholds();
+
+private:
+  struct Threshold {
+    G4String particleName;
+    G4String regionName;
+    const G4ParticleDefinition* particle = nullptr;
+    const G4Region* region = nullptr;     // nullptr for all regions
+    G4double energy = 0.;
+  };
+
+  // methods
+  void DefineCommands();
+  void ResolveThresholds();
+
+  // data members
+  EventAction* fEventAction = nullptr;
+  Run* fRun = nullptr;
+  G4int fRunID = -1;
+  std::vector<Threshold> fThresholds;
+  G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,37 @@
+/// Statistical tests
+///
+/// Probabilities of the chi-square and Kolmogorov-Smirnov tests, used to
+/// check sampled distributions against the expected ones.
+
+/// \file Statistics.hh
+/// \brief Definition of the B4c statistical tests
+
+#ifndef B4cStatistics_h
+#define B4cStatistics_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+namespace B4c
+{
+namespace Statistics
+{
+
+// probability of a chi-square at least as large, for ndf degrees of freedom
+G4double ChiSquareProbability(G4double chi2, G4int ndf);
+
+// chi-square of observed counts against expected probabilities; the bins
+// expecting less than 5 counts are combined into one
+G4double ChiSquare(const std::vector<G4long>& observed,
+                   const std::vector<G4double>& probabilities, G4int& ndf);
+
+// probability of a Kolmogorov-Smirnov distance at least as large, for n samples
+G4double KolmogorovProbability(G4double distance, G4long n);
+
+}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,41 @@
+/// Stepping action class
+///
+/// In UserSteppingAction() the step is counted and the energy deposit of each
+/// step is added to the per-volume energy budget of the event held by the
+/// EventAction. In the acceptance mapping mode, the diode deposits are also
+/// added per module, from the copy number of the module placement.
+///
+/// A primary stepping into the world volume is killed when its straight-line
+/// continuation cannot reach any volume of the array (see EscapeFilter), and
+/// counted as geometrically escaped in the Run.
+
+/// \file SteppingAction.hh
+/// \brief Definition of the B4c::SteppingAction class
+
+#ifndef B4cSteppingAction_h
+#define B4cSteppingAction_h 1
+
+#include "G4UserSteppingAction.hh"
+#include "globals.hh"
+
+namespace B4c
+{
+class EventAction;
+
+class SteppingAction : public G4UserSteppingAction
+{
+public:
+  SteppingAction(EventAction* eventAction);
+  ~SteppingAction() override;
+
+  void UserSteppingAction(const G4Step* step) override;
+
+private:
+  EventAction* fEventAction = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,40 @@
+/// Tracking action class
+///
+/// In PreUserTrackingAction(), the track is first attributed to its primary
+/// in the EventAction, for the events with several primaries.
+///
+/// In PreUserTrackingAction(), a primary starting in the world volume is
+/// killed before its first step when its straight-line continuation cannot
+/// reach any volume of the array (see EscapeFilter). It is counted as
+/// geometrically escaped in the Run.
+
+/// \file TrackingAction.hh
+/// \brief Definition of the B4c::TrackingAction class
+
+#ifndef B4cTrackingAction_h
+#define B4cTrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+namespace B4c
+{
+class EventAction;
+
+class TrackingAction : public G4UserTrackingAction
+{
+public:
+  TrackingAction(EventAction* eventAction);
+  ~TrackingAction() override;
+
+  void PreUserTrackingAction(const G4Track* track) override;
+
+private:
+  EventAction* fEventAction = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
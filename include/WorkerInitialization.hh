@@ -0,0 +1,73 @@
+/// Worker initialization class
+///
+/// It pins each worker thread to cores, by a policy set with
+/// /B4/affinity/policy before the first run:
+///
+/// - none: the threads are not pinned (default);
+/// - compact: worker i on the i-th allowed CPU, in the order of the NUMA
+///   nodes, sockets and cores, so that the workers fill a socket before the
+///   next one, and share the cores (hyperthreads) first;
+/// - scatter: the workers alternate between the NUMA nodes, and take a
+///   separate core before a second hyperthread of a core;
+/// - numa: the workers alternate between the NUMA nodes, and each is
+///   allowed on all the CPUs of its node, where the OS may move it.
+///
+/// The thread is pinned in WorkerInitialize(), before the worker builds its
+/// physics tables and user actions: the memory it touches first (Run
+/// counters, histograms, hit pool, ...) is then allocated on its local node.
+/// The topology is read from /sys (Linux only), among the CPUs allowed to
+/// the process. It replaces /run/pinAffinity.
+///
+/// It lives on the master; the commands are not broadcast.
+
+/// \file WorkerInitialization.hh
+/// \brief Definition of the B4c::WorkerInitialization class
+
+#ifndef B4cWorkerInitialization_h
+#define B4cWorkerInitialization_h 1
+
+#include "G4UserWorkerInitialization.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B4c
+{
+class WorkerInitialization : public G4UserWorkerInitialization
+{
+  public:
+    enum Policy { kNone, kCompact, kScatter, kNuma };
+
+    WorkerInitialization();
+    ~WorkerInitialization() override;
+
+    void WorkerInitialize() const override;
+
+  private:
+    struct Cpu {
+      G4int id = 0;
+      G4int node = 0;
+      G4int package = 0;
+      G4int core = 0;
+      G4int sibling = 0;    // rank among the hyperthreads of its core
+    };
+
+    void SetPolicy(const G4String& value);
+    // CPUs allowed to the process, with their place in the topology
+    static std::vector<Cpu> ReadTopology();
+    // CPUs of a worker
+    std::vector<G4int> GetCpus(G4int worker) const;
+
+    Policy fPolicy = kNone;
+    std::vector<Cpu> fCpus;                     // in the compact order
+    std::vector<std::vector<Cpu>> fNodeCpus;    // per node, in the scatter order
+    G4GenericMessenger* fMessenger = nullptr;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,35 @@
+#!/bin/bash
+#
+# Throughput of each random engine:
+#   ./rng.sh [events] [threads] [engines...]
+# e.g. ./rng.sh 200000 8 mixmax ranluxpp ranlux mtwist
+# The results are written to rng_results.dat, one line per engine, with
+# the events/s of the measured run of bench.mac and the speed-up over the
+# first engine. The numbers/s and seeding cost of each engine alone are
+# given by /B4/random/benchmark.
+
+EVENTS=${1:-200000}
+THREADS=${2:-4}
+shift $(( $# < 2 ? $# : 2 ))
+ENGINES=${@:-mixmax ranluxpp ranlux ranlux64 mtwist ranecu james ranshi dualrand}
+
+echo "# events $EVENTS threads $THREADS" > rng_results.dat
+echo "# engine events/s speedup" >> rng_results.dat
+
+cat > rng_tmp.mac <<EOF2
+/run/numberOfThreads $THREADS
+/control/alias EventNo $EVENTS
+/control/execute bench.mac
+EOF2
+
+BASE=""
+for e in $ENGINES; do
+  # throughput of the second (measured) run, same seed for all engines
+  RATE=$(./exampleB4c -m rng_tmp.mac -e $e -s 12345 2>/dev/null | grep "Throughput" | tail -1 | awk '{print $3}')
+  [ -z "$BASE" ] && BASE=$RATE
+  echo "$e $RATE $(awk -v r="$RATE" -v b="$BASE" 'BEGIN { if (b > 0) printf "%.2f", r/b; else print 0 }')" >> rng_results.dat
+  echo "$e: $RATE events/s"
+done
+
+rm -f rng_tmp.mac
+column -t rng_results.dat
@@ -4,9 +4,16 @@ make -j4                          # makes the build using 4 threads
 
 rm B4.root
 
-rm data.dat                       # removes the "data.dat" file if it exists
+rm isotropy_summary.dat           # removes the "isotropy_summary.dat" file if it exists
 rm diode_efficiency_data.dat      # removes the "diode_efficiency_data.dat" file if it exists
 rm annular_efficiency_data.dat    # removes the "annular_efficiency_data.dat" file if it exists
 rm collective_efficiency_data.dat # removes the "collective_efficiency_data.dat" file if it exists
+rm efficiency_summary.dat         # removes the "efficiency_summary.dat" file if it exists
+rm threshold_curve.dat            # removes the "threshold_curve.dat" file if it exists
+rm rqmc_summary.dat               # removes the "rqmc_summary.dat" file if it exists
+rm scan_results.dat               # removes the "scan_results.dat" file if it exists
+rm scan_spectra.dat               # removes the "scan_spectra.dat" file if it exists
+rm pileup_results.dat             # removes the "pileup_results.dat" file if it exists
+rm pileup_spectra.dat             # removes the "pileup_spectra.dat" file if it exists
 
 ./exampleB4c -m run1.mac          # runs the exampleB4c executable using run1.mac
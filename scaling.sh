@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Throughput scaling with and without pinning of the worker threads:
+#   ./scaling.sh [events] [thread counts...]
+# e.g. ./scaling.sh 200000 1 2 4 8 16 32 64
+# The results are written to scaling_results.dat, one line per thread
+# count, with the events/s of each pinning policy and their speed-up over
+# the first thread count without pinning.
+
+EVENTS=${1:-200000}
+shift
+THREADS=${@:-1 2 4 8}
+POLICIES="none compact scatter numa"
+
+echo "# events $EVENTS" > scaling_results.dat
+echo "# threads $(for p in $POLICIES; do echo -n "$p(events/s) $p(speedup) "; done)" >> scaling_results.dat
+
+BASE=""
+for t in $THREADS; do
+  LINE="$t"
+  for p in $POLICIES; do
+    cat > scaling_tmp.mac <<EOF
+/run/numberOfThreads $t
+/B4/affinity/policy $p
+/control/alias EventNo $EVENTS
+/control/execute bench.mac
+EOF
+    # throughput of the second (measured) run
+    RATE=$(./exampleB4c -m scaling_tmp.mac 2>/dev/null | grep "Throughput" | tail -1 | awk '{print $3}')
+    [ -z "$BASE" ] && BASE=$RATE
+    LINE="$LINE $RATE $(awk -v r="$RATE" -v b="$BASE" 'BEGIN { if (b > 0) printf "%.2f", r/b; else print 0 }')"
+    echo "threads $t, $p: $RATE events/s"
+  done
+  echo "$LINE" >> scaling_results.dat
+done
+
+rm -f scaling_tmp.mac
+column -t scaling_results.dat
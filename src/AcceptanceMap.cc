@@ -0,0 +1,253 @@
+/// \file AcceptanceMap.cc
+/// \brief Implementation of the B4c::AcceptanceMap class
+
+#include "AcceptanceMap.hh"
+#include "GeometryHash.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "ResponseMatrix.hh"
+#include "Run.hh"
+#include "RunProgress.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4UImanager.hh"
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace B4c
+{
+
+namespace
+{
+constexpr char kMagic[8] = { 'B', '4', 'A', 'M', 'A', 'P', '\0', '\0' };
+const char* kNames[AcceptanceMap::kNofMaps]
+  = { "diode", "upper", "lower", "right", "left", "annular" };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AcceptanceMap::AcceptanceMap()
+{
+  for ( auto& axis : fAxes ) axis.assign(1, 0.);
+
+  fMessenger = new G4GenericMessenger(this, "/B4/acceptance/", "Acceptance map");
+
+  fMessenger->DeclareMethod("x", &AcceptanceMap::SetX)
+    .SetGuidance("Source positions along x: xMin xMax n, in mm.")
+    .SetParameterName("grid", false);
+
+  fMessenger->DeclareMethod("y", &AcceptanceMap::SetY)
+    .SetGuidance("Source positions along y: yMin yMax n, in mm.")
+    .SetParameterName("grid", false);
+
+  fMessenger->DeclareMethod("z", &AcceptanceMap::SetZ)
+    .SetGuidance("Source positions along z: zMin zMax n, in mm.")
+    .SetGuidance("The source of run2.mac is at z = -zpos.")
+    .SetParameterName("grid", false);
+
+  fMessenger->DeclareProperty("events", fNofEvents)
+    .SetGuidance("Number of events per grid cell.")
+    .SetParameterName("events", false)
+    .SetRange("events>0");
+
+  fMessenger->DeclareProperty("fileName", fFileName)
+    .SetGuidance("Map file name.")
+    .SetParameterName("fileName", false);
+
+  fMessenger->DeclareProperty("enable", fEnabled)
+    .SetGuidance("Place the source of each event on the grid, and write the map")
+    .SetGuidance("at the end of run.")
+    .SetParameterName("enable", true)
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareMethod("run", &AcceptanceMap::Start)
+    .SetGuidance("Run the events of all the grid cells and write the map.")
+    .SetToBeBroadcasted(false);
+}
+
+AcceptanceMap::~AcceptanceMap()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* AcceptanceMap::GetName(G4int map)
+{
+  return kNames[map];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AcceptanceMap::SetAxis(G4int axis, const G4String& value)
+{
+  if ( ! ResponseMatrix::ParseGrid(value, mm, fAxes[axis]) ) {
+    fAxes[axis].assign(1, 0.);
+    G4ExceptionDescription msg;
+    msg << "Cannot parse the grid \"" << value << "\"" << G4endl
+        << "Expected: min max n (mm)";
+    G4Exception("AcceptanceMap::SetAxis()", "MyCode0013", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t AcceptanceMap::GetNofCells() const
+{
+  return fAxes[0].size()*fAxes[1].size()*fAxes[2].size();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreeVector AcceptanceMap::GetPosition(G4long eventIndex) const
+{
+  auto cell = std::size_t(eventIndex) % GetNofCells();
+  auto nx = fAxes[0].size(), ny = fAxes[1].size();
+  return G4ThreeVector(fAxes[0][cell % nx], fAxes[1][(cell/nx) % ny], fAxes[2][cell/(nx*ny)]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AcceptanceMap::EndOfEvent(G4int primary, G4long primaryIndex, G4double diodeEdep,
+                               G4double annularEdep, Run* run) const
+{
+  unsigned detected = 0;
+  if ( diodeEdep > 0. ) detected |= 1u << kDiode;
+  for ( G4int module=0; module<kNofModules; ++module ) {
+    if ( fModuleEdep[primary][module] > 0. ) detected |= 1u << (kUpper + module);
+  }
+  if ( annularEdep > 0. ) detected |= 1u << kAnnular;
+
+  run->AddAcceptance(std::size_t(primaryIndex) % GetNofCells(), detected);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AcceptanceMap::Start()
+{
+  auto nofEvents = G4long(GetNofCells())*fNofEvents;
+  if ( nofEvents > INT_MAX ) {
+    G4ExceptionDescription msg;
+    msg << GetNofCells() << " cells of " << fNofEvents << " events exceed the"
+        << " number of events of a run; reduce the grid or the events per cell.";
+    G4Exception("AcceptanceMap::Start()", "MyCode0013", JustWarning, msg);
+    return;
+  }
+
+  G4cout << "--> Acceptance map: " << fAxes[0].size() << " x " << fAxes[1].size()
+         << " x " << fAxes[2].size() << " cells of " << fNofEvents << " events" << G4endl;
+
+  // the workers receive the mode with the commands of the run
+  auto UImanager = G4UImanager::GetUIpointer();
+  UImanager->ApplyCommand("/B4/acceptance/enable true");
+  RunProgress::Instance()->SetInternalScan(true);
+  G4RunManager::GetRunManager()->BeamOn(B4::PrimaryGeneratorAction::GetNofEvents(nofEvents));
+  RunProgress::Instance()->SetInternalScan(false);
+  UImanager->ApplyCommand("/B4/acceptance/enable false");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AcceptanceMap::EndOfRun(const Run* run) const
+{
+  if ( ! fEnabled || run->GetNumberOfEvent() == 0 ) return;
+
+  const auto& counts = run->GetAcceptance();
+  if ( counts.size() != GetNofCells() ) {
+    G4ExceptionDescription msg;
+    msg << "The run has " << counts.size() << " cells, the grid " << GetNofCells()
+        << "; the map is not written.";
+    G4Exception("AcceptanceMap::EndOfRun()", "MyCode0013", JustWarning, msg);
+    return;
+  }
+
+  if ( ! Write(run) ) return;
+
+  // best cell of each detector
+  G4cout << G4endl << " ----> acceptance map written to " << fFileName << G4endl;
+  auto nx = fAxes[0].size(), ny = fAxes[1].size();
+  for ( G4int map=0; map<kNofMaps; ++map ) {
+    std::size_t best = 0;
+    G4double bestAcceptance = -1.;
+    for ( std::size_t cell=0; cell<counts.size(); ++cell ) {
+      if ( counts[cell][0] == 0 ) continue;
+      auto acceptance = G4double(counts[cell][1+map])/counts[cell][0];
+      if ( acceptance > bestAcceptance ) {
+        best = cell;
+        bestAcceptance = acceptance;
+      }
+    }
+    if ( bestAcceptance < 0. ) continue;
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  " %-8s: max = %.5f at (%.3f, %.3f, %.3f) mm", kNames[map], bestAcceptance,
+                  fAxes[0][best % nx]/mm, fAxes[1][(best/nx) % ny]/mm, fAxes[2][best/(nx*ny)]/mm);
+    G4cout << line << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool AcceptanceMap::Write(const Run* run) const
+{
+  const auto& counts = run->GetAcceptance();
+  auto nofCells = counts.size();
+
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.nofMaps = kNofMaps;
+  header.geometryHash = GeometryHash::Compute();
+  for ( G4int axis=0; axis<3; ++axis ) header.nofCells[axis] = std::uint32_t(fAxes[axis].size());
+  header.byteOrder = kByteOrder;
+
+  std::vector<std::uint32_t> nofEvents(nofCells);
+  for ( std::size_t cell=0; cell<nofCells; ++cell ) {
+    nofEvents[cell] = std::uint32_t(counts[cell][0]);
+  }
+
+  // write to a temporary file, then rename, so that a reader never sees
+  // a partial map
+  auto tmpName = fFileName + ".tmp";
+  std::ofstream file(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for ( const auto& axis : fAxes ) {
+    for ( auto value : axis ) {
+      G4double position = value/mm;
+      file.write(reinterpret_cast<const char*>(&position), sizeof(position));
+    }
+  }
+  file.write(reinterpret_cast<const char*>(nofEvents.data()),
+             nofCells*sizeof(std::uint32_t));
+
+  std::vector<float> acceptances(nofCells), errors(nofCells);
+  for ( G4int map=0; map<kNofMaps; ++map ) {
+    for ( std::size_t cell=0; cell<nofCells; ++cell ) {
+      auto n = G4double(counts[cell][0]);
+      auto acceptance = ( n > 0. ) ? counts[cell][1+map]/n : 0.;
+      acceptances[cell] = float(acceptance);
+      errors[cell] = float(( n > 0. ) ? std::sqrt(acceptance*(1. - acceptance)/n) : 0.);
+    }
+    file.write(reinterpret_cast<const char*>(acceptances.data()), nofCells*sizeof(float));
+    file.write(reinterpret_cast<const char*>(errors.data()), nofCells*sizeof(float));
+  }
+  file.close();
+
+  if ( ! file || std::rename(tmpName.c_str(), fFileName.c_str()) != 0 ) {
+    std::remove(tmpName.c_str());
+    G4ExceptionDescription msg;
+    msg << "Cannot write the acceptance map " << fFileName;
+    G4Exception("AcceptanceMap::Write()", "MyCode0013", JustWarning, msg);
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -5,6 +5,9 @@
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
 #include "EventAction.hh"
+#include "SteppingAction.hh"
+#include "StackingAction.hh"
+#include "TrackingAction.hh"
 
 using namespace B4;
 
@@ -30,9 +33,17 @@ void ActionInitialization::BuildForMaster() const
 
 void ActionInitialization::Build() const
 {
-  SetUserAction(new PrimaryGeneratorAction);
-  SetUserAction(new RunAction);
-  SetUserAction(new EventAction);
+  auto eventAction = new EventAction;
+  auto primaryGenerator = new PrimaryGeneratorAction;
+  auto runAction = new RunAction(eventAction);
+  primaryGenerator->SetAcceptanceMap(runAction->GetAcceptanceMap());
+
+  SetUserAction(primaryGenerator);
+  SetUserAction(runAction);
+  SetUserAction(eventAction);
+  SetUserAction(new SteppingAction(eventAction));
+  SetUserAction(new StackingAction(eventAction));
+  SetUserAction(new TrackingAction(eventAction));
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
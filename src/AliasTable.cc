@@ -0,0 +1,75 @@
+/// \file AliasTable.cc
+/// \brief Implementation of the B4c::AliasTable class
+
+#include "AliasTable.hh"
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AliasTable::Clear()
+{
+  fProbabilities.clear();
+  fAliases.clear();
+  fNormalised.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool AliasTable::Build(const std::vector<G4double>& weights)
+{
+  Clear();
+
+  G4double sum = 0.;
+  for ( auto weight : weights ) {
+    if ( weight < 0. ) return false;
+    sum += weight;
+  }
+  if ( weights.empty() || sum <= 0. ) return false;
+
+  auto n = weights.size();
+  fNormalised.resize(n);
+  fProbabilities.resize(n);
+  fAliases.resize(n);
+
+  // scaled so that the mean is 1, then split in small and large columns
+  std::vector<G4double> scaled(n);
+  std::vector<std::size_t> small, large;
+  for ( std::size_t i=0; i<n; ++i ) {
+    fNormalised[i] = weights[i]/sum;
+    scaled[i] = fNormalised[i]*n;
+    ( scaled[i] < 1. ? small : large ).push_back(i);
+  }
+
+  // each small column is completed by a large one
+  while ( ! small.empty() && ! large.empty() ) {
+    auto s = small.back();
+    small.pop_back();
+    auto l = large.back();
+
+    fProbabilities[s] = scaled[s];
+    fAliases[s] = l;
+    scaled[l] -= 1. - scaled[s];
+    if ( scaled[l] < 1. ) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // the columns left are full, up to rounding
+  for ( auto i : large ) {
+    fProbabilities[i] = 1.;
+    fAliases[i] = i;
+  }
+  for ( auto i : small ) {
+    fProbabilities[i] = 1.;
+    fAliases[i] = i;
+  }
+
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
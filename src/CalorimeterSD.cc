@@ -2,10 +2,18 @@
 /// \brief Implementation of the B4c::CalorimeterSD class
 
 #include "CalorimeterSD.hh"
+#include "EventAction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "Run.hh"
+
+#include "G4EventManager.hh"
 #include "G4HCofThisEvent.hh"
+#include "G4LogicalVolume.hh"
+#include "G4RunManager.hh"
 #include "G4Step.hh"
 #include "G4ThreeVector.hh"
 #include "G4SDManager.hh"
+#include "G4VSolid.hh"
 #include "G4ios.hh"
 
 namespace B4c
@@ -15,7 +23,9 @@ namespace B4c
 
 CalorimeterSD::CalorimeterSD(const G4String& name,
                              const G4String& hitsCollectionName,
-                             G4int nofCells): G4VSensitiveDetector(name), fNofCells(nofCells)
+                             G4int nofCells,
+                             G4int detector): G4VSensitiveDetector(name), fNofCells(nofCells),
+                                              fDetector(detector)
 {
   collectionName.insert(hitsCollectionName);
 }
@@ -36,16 +46,27 @@ void CalorimeterSD::Initialize(G4HCofThisEvent* hce)
   hce->AddHitsCollection( hcID, fHitsCollection );
 
   // Create hits
-  // fNofCells for cells + one more for total sums
-  for (G4int i=0; i<fNofCells+1; i++ ) {
+  // fNofCells for cells + one more for total sums, for each primary
+  auto nofPrimaries = B4::PrimaryGeneratorAction::GetNofPrimaries();
+  for (G4int i=0; i<(fNofCells+1)*nofPrimaries; i++ ) {
     fHitsCollection->insert(new CalorHit());
   }
+
+  fEventAction = static_cast<const EventAction*>(
+    G4EventManager::GetEventManager()->GetUserEventAction());
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 G4bool CalorimeterSD::ProcessHits(G4Step* step, G4TouchableHistory*)
 {
+  // entry of a primary into the volume, neutral or not
+  auto preStepPoint = step->GetPreStepPoint();
+  if ( fDetector >= 0 && preStepPoint->GetStepStatus() == fGeomBoundary
+       && step->GetTrack()->GetParentID() == 0 ) {
+    AddEntry(preStepPoint);
+  }
+
   // energy deposit
   auto edep = step->GetTotalEnergyDeposit();
 
@@ -59,20 +80,11 @@ G4bool CalorimeterSD::ProcessHits(G4Step* step, G4TouchableHistory*)
 
   auto touchable = (step->GetPreStepPoint()->GetTouchable());
 
-  // Get calorimeter cell id
-  auto layerNumber = touchable->GetReplicaNumber(1);
-
   // Get hit accounting data for this cell
-  auto hit = (*fHitsCollection)[layerNumber];
-  if ( ! hit ) {
-    G4ExceptionDescription msg;
-    msg << "Cannot access hit " << layerNumber;
-    G4Exception("CalorimeterSD::ProcessHits()",
-      "MyCode0004", FatalException, msg);
-  }
+  auto hit = GetHit(touchable);
 
   // Get hit for total accounting
-  auto hitTotal = (*fHitsCollection)[fHitsCollection->entries()-1];
+  auto hitTotal = GetTotalHit();
 
   // Add values
   hit->Add(edep, stepLength);
@@ -83,6 +95,63 @@ G4bool CalorimeterSD::ProcessHits(G4Step* step, G4TouchableHistory*)
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void CalorimeterSD::AddEdep(const G4VTouchable* touchable, G4double edep)
+{
+  auto hit = GetHit(touchable);
+  auto hitTotal = GetTotalHit();
+
+  hit->Add(edep, 0.);
+  hitTotal->Add(edep, 0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CalorHit* CalorimeterSD::GetHit(const G4VTouchable* touchable) const
+{
+  // Get calorimeter cell id; the mother of a single cell depends on the
+  // geometry build
+  auto layerNumber = ( fNofCells > 1 ) ? touchable->GetReplicaNumber(1) : 0;
+
+  // Get hit accounting data for this cell and primary
+  auto primary = fEventAction ? fEventAction->GetCurrentPrimary() : 0;
+  auto hit = (*fHitsCollection)[primary*(fNofCells+1) + layerNumber];
+  if ( ! hit ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot access hit " << layerNumber;
+    G4Exception("CalorimeterSD::GetHit()",
+      "MyCode0004", FatalException, msg);
+  }
+
+  return hit;
+}
+
+CalorHit* CalorimeterSD::GetTotalHit() const
+{
+  auto primary = fEventAction ? fEventAction->GetCurrentPrimary() : 0;
+  return (*fHitsCollection)[primary*(fNofCells+1) + fNofCells];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::AddEntry(const G4StepPoint* point) const
+{
+  // local frame of the volume
+  const auto& transform = point->GetTouchable()->GetHistory()->GetTopTransform();
+  auto position = transform.TransformPoint(point->GetPosition());
+  auto direction = transform.TransformAxis(point->GetMomentumDirection());
+
+  auto solid = point->GetPhysicalVolume()->GetLogicalVolume()->GetSolid();
+  G4ThreeVector pMin, pMax;
+  solid->BoundingLimits(pMin, pMax);
+  auto normal = solid->SurfaceNormal(position);
+
+  auto run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  run->AddEntry(fDetector, 0.5*(pMax - pMin), position - 0.5*(pMax + pMin), direction, normal,
+                point->GetKineticEnergy());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void CalorimeterSD::EndOfEvent(G4HCofThisEvent*)
 {
   if ( verboseLevel>1 ) {
@@ -0,0 +1,513 @@
+/// \file Checkpoint.cc
+/// \brief Implementation of the B4c::Checkpoint class
+
+#include "Checkpoint.hh"
+#include "ColumnarWriter.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "Run.hh"
+#include "RunProgress.hh"
+
+#include "G4AnalysisManager.hh"
+#include "G4Event.hh"
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4UImanager.hh"
+#include "Randomize.hh"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace B4c
+{
+
+G4bool Checkpoint::fResume = false;
+G4int  Checkpoint::fGeneration = 0;
+G4int  Checkpoint::fEventOffset = 0;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Checkpoint::Checkpoint()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/checkpoint/", "Checkpoint and resume");
+
+  fMessenger->DeclareProperty("interval", fInterval)
+    .SetGuidance("Number of events of each thread between two checkpoints.")
+    .SetGuidance("0 disables checkpointing.")
+    .SetParameterName("interval", false)
+    .SetRange("interval>=0");
+
+  fMessenger->DeclareProperty("directory", fDirectory)
+    .SetGuidance("Directory of the checkpoint files.")
+    .SetParameterName("directory", false);
+
+  fMessenger->DeclareMethod("point", &Checkpoint::SetPoint)
+    .SetGuidance("Declare the next scan point: <tag> <number of events>.")
+    .SetGuidance("Sets the aliases RunPoint (0 if the point was completed before")
+    .SetGuidance("--resume, 1 otherwise) and EventsLeft (events still to run).")
+    .SetParameterName("point", false)
+    .SetToBeBroadcasted(false);
+}
+
+Checkpoint::~Checkpoint()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::SetPoint(const G4String& value)
+{
+  std::istringstream is(value);
+  G4String tag;
+  G4int nofEvents = 0;
+  is >> tag >> nofEvents;
+
+  if ( is.fail() ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot parse scan point \"" << value << "\"" << G4endl
+        << "Expected: <tag> <number of events>";
+    G4Exception("Checkpoint::SetPoint()", "MyCode0008", JustWarning, msg);
+    return;
+  }
+
+  fTag = tag;
+  fNofEvents = nofEvents;
+  fHasRestored = false;
+  fRestoreEngine = false;
+  fEventOffset = 0;
+
+  G4int runPoint = 1;
+  G4int eventsLeft = nofEvents;
+
+  if ( ! fResume ) {
+    // a new job starts from scratch
+    if ( ! fCleared ) RemoveFiles(true);
+  }
+  else if ( IsCompleted(tag) ) {
+    G4cout << "--> Checkpoint: scan point " << tag << " completed before, skipped" << G4endl;
+    runPoint = 0;
+    eventsLeft = 0;
+  }
+  else if ( LoadCheckpoint() ) {
+    // at least one event, so that the run (and its output) takes place;
+    // the Run counts the primaries
+    auto nofDone = fRestored.nofDone/B4::PrimaryGeneratorAction::GetNofPrimaries();
+    eventsLeft = std::max(nofEvents - nofDone, 1);
+    G4cout << "--> Checkpoint: scan point " << tag << " resumed after "
+           << nofDone << " events, " << eventsLeft << " events left" << G4endl;
+  }
+  fCleared = true;
+
+  auto UImanager = G4UImanager::GetUIpointer();
+  UImanager->SetAlias(("RunPoint " + std::to_string(runPoint)).c_str());
+  UImanager->SetAlias(("EventsLeft " + std::to_string(eventsLeft)).c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Checkpoint::LoadCheckpoint()
+{
+  State master;
+  if ( ! ReadState(GetMasterPath(), "master", master) ) return false;
+  if ( master.tag != fTag ) return false;
+
+  fRestored = std::move(master);
+
+  // add the shards written since the master file
+  G4int lastEventID = -1;
+  std::vector<unsigned long> sequentialEngine;
+  std::vector<G4int> nofParts(RunProgress::kMaxSlots, 0);
+  for ( G4int slot=0; slot<RunProgress::kMaxSlots; ++slot ) {
+    State shard;
+    if ( ! ReadState(GetShardPath(slot), "shard", shard) ) continue;
+    if ( shard.generation != fRestored.generation ) continue;
+
+    nofParts[slot] = shard.nofParts;
+
+    fRestored.run->Merge(shard.run.get());
+    fRestored.nofDone += shard.nofDone;
+    AddH1s(fRestored.h1s, shard.h1s);
+    lastEventID = std::max(lastEventID, shard.lastEventID);
+    if ( slot == 0 ) sequentialEngine = shard.engine;
+  }
+
+  // In MT mode the master draws two seeds per event from its engine: skip
+  // those of all the events started, so that no seed is used twice.
+  // In sequential mode the engine of the last shard continues the stream.
+  fEngine = fRestored.engine;
+  fNofDiscarded = 2*G4long(lastEventID + 1);
+  if ( G4RunManager::GetRunManager()->GetRunManagerType() == G4RunManager::sequentialRM &&
+       ! sequentialEngine.empty() ) {
+    fEngine = sequentialEngine;
+    fNofDiscarded = 0;
+  }
+
+  // the columnar parts of the events saved in the shards are kept
+  if ( fColumnarWriter ) {
+    fColumnarWriter->RemoveParts(fRestored.generation, nofParts);
+    if ( fColumnarWriter->IsNtupleEnabled() ) {
+      G4ExceptionDescription msg;
+      msg << "The ntuple of the resumed scan point only holds its events run after the"
+          << G4endl << "resume; the Run, the histograms and the columnar files hold all of them.";
+      G4Exception("Checkpoint::LoadCheckpoint()", "MyCode0008", JustWarning, msg);
+    }
+  }
+
+  fGeneration = fRestored.generation;
+  fEventOffset = fRestored.eventOffset + lastEventID + 1;
+  fHasRestored = true;
+  fRestoreEngine = true;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::BeginOfRun()
+{
+  fEventsSinceShard = 0;
+  fLastEventID = -1;
+
+  fSuspended = RunProgress::Instance()->IsInternalScan();
+  if ( fSuspended || ! G4Threading::IsMasterThread() ) return;
+
+  auto engine = G4Random::getTheEngine();
+  if ( fRestoreEngine ) {
+    engine->get(fEngine);
+    std::vector<G4double> buffer(4096);
+    for ( auto left = fNofDiscarded; left > 0; left -= G4long(buffer.size()) ) {
+      engine->flatArray(G4int(std::min(left, G4long(buffer.size()))), buffer.data());
+    }
+    fRestoreEngine = false;
+  }
+
+  if ( fHasRestored ) {
+    // the restored events count for the sequential stopping
+    RunProgress::Totals totals;
+    totals.events = fRestored.run->GetNumberOfEvent();
+    totals.diode = fRestored.run->GetNofDiode();
+    totals.annular = fRestored.run->GetNofAnnular();
+    totals.collective = fRestored.run->GetNofCollective();
+    RunProgress::Instance()->Preload(totals);
+  }
+
+  if ( fInterval <= 0 ) return;
+
+  ++fGeneration;
+  fEngine = engine->put();
+
+  std::error_code error;
+  std::filesystem::create_directories(fDirectory.c_str(), error);
+  WriteMaster();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::EndOfRun(Run* run)
+{
+  if ( fSuspended || ! fHasRestored ) return;
+
+  run->Merge(fRestored.run.get());
+  AddToH1s(fRestored.h1s);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::CompleteRun()
+{
+  if ( fSuspended ) return;
+
+  fHasRestored = false;
+  fRestored = State();
+
+  if ( fInterval <= 0 ) return;
+
+  std::ofstream completed(GetCompletedPath().c_str(), std::ios::app);
+  completed << ( fTag.empty() ? "none" : fTag ) << std::endl;
+  completed.close();
+
+  RemoveFiles(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::BeginOfEvent()
+{
+  // written before the event, when the previous ones are fully recorded;
+  // their columnar output is finished first, so that the shard counts it
+  if ( IsShardDue() ) {
+    if ( fColumnarWriter ) fColumnarWriter->Commit(fGeneration);
+    WriteShard();
+    fEventsSinceShard = 0;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::EndOfEvent(const G4Event* event)
+{
+  ++fEventsSinceShard;
+  fLastEventID = std::max(fLastEventID, event->GetEventID());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::WriteMaster() const
+{
+  State state;
+  state.generation = fGeneration;
+  state.tag = fTag.empty() ? "none" : fTag;
+  state.nofEvents = fNofEvents;
+  state.engine = fEngine;
+  state.eventOffset = fEventOffset;
+
+  Run empty;
+  const Run& run = fHasRestored ? *fRestored.run : empty;
+  state.nofDone = run.GetNumberOfEvent();
+  const H1List& h1s = fHasRestored ? fRestored.h1s : H1List();
+
+  WriteFile(GetMasterPath(), [&](std::ostream& os) {
+    WriteState(os, "master", state, run, h1s);
+  });
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::WriteShard() const
+{
+  auto run = static_cast<const Run*>(G4RunManager::GetRunManager()->GetCurrentRun());
+
+  State state;
+  state.generation = fGeneration;
+  state.tag = "-";
+  state.nofDone = run->GetNumberOfEvent();
+  state.lastEventID = fLastEventID;
+  state.engine = G4Random::getTheEngine()->put();
+  state.nofParts = fColumnarWriter ? fColumnarWriter->GetNofParts() : 0;
+
+  auto h1s = GetH1s();
+  WriteFile(GetShardPath(G4Threading::G4GetThreadId() + 1), [&](std::ostream& os) {
+    WriteState(os, "shard", state, *run, h1s);
+  });
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::RemoveFiles(G4bool all) const
+{
+  std::remove(GetMasterPath().c_str());
+  for ( G4int slot=0; slot<RunProgress::kMaxSlots; ++slot ) {
+    std::remove(GetShardPath(slot).c_str());
+  }
+  if ( all ) std::remove(GetCompletedPath().c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String Checkpoint::GetMasterPath() const
+{
+  return fDirectory + "/master.dat";
+}
+
+G4String Checkpoint::GetShardPath(G4int slot) const
+{
+  return fDirectory + "/shard_t" + std::to_string(slot) + ".dat";
+}
+
+G4String Checkpoint::GetCompletedPath() const
+{
+  return fDirectory + "/completed.dat";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Checkpoint::IsCompleted(const G4String& tag) const
+{
+  std::ifstream completed(GetCompletedPath().c_str());
+  std::string line;
+  while ( completed >> line ) {
+    if ( line == tag ) return true;
+  }
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Checkpoint::WriteFile(const G4String& path,
+                             const std::function<void(std::ostream&)>& write)
+{
+  // write a temporary file and rename it: the rename replaces the previous
+  // checkpoint atomically
+  auto tmpPath = path + ".tmp";
+  std::ofstream os(tmpPath.c_str());
+  os << std::setprecision(17);
+  write(os);
+  os.close();
+
+  if ( os.fail() || std::rename(tmpPath.c_str(), path.c_str()) != 0 ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write checkpoint file " << path;
+    G4Exception("Checkpoint::WriteFile()", "MyCode0008", JustWarning, msg);
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::WriteState(std::ostream& os, const G4String& type, const State& state,
+                            const Run& run, const H1List& h1s)
+{
+  os << "B4checkpoint " << type << "\n"
+     << "generation " << state.generation << "\n"
+     << "tag " << state.tag << "\n"
+     << "nofEvents " << state.nofEvents << "\n"
+     << "nofDone " << state.nofDone << "\n"
+     << "lastEventID " << state.lastEventID << "\n"
+     << "eventOffset " << state.eventOffset << "\n"
+     << "nofParts " << state.nofParts << "\n";
+
+  os << "engine " << state.engine.size();
+  for ( auto value : state.engine ) os << " " << value;
+  os << "\n";
+
+  os << "run ";
+  run.Write(os);
+  os << "\n";
+
+  os << "h1 " << h1s.size() << "\n";
+  for ( const auto& h1 : h1s ) {
+    os << h1.entries.size() << "\n";
+    for ( std::size_t i=0; i<h1.entries.size(); ++i ) {
+      os << h1.entries[i] << " " << h1.sumW[i] << " " << h1.sumW2[i] << " "
+         << h1.sumXW[i] << " " << h1.sumX2W[i] << "\n";
+    }
+  }
+  os << "end\n";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Checkpoint::ReadState(const G4String& path, const G4String& type, State& state)
+{
+  std::ifstream is(path.c_str());
+  if ( ! is ) return false;
+
+  std::string key, fileType;
+  is >> key >> fileType;
+  if ( key != "B4checkpoint" || fileType != type ) return false;
+
+  std::size_t size = 0;
+  is >> key >> state.generation
+     >> key >> state.tag
+     >> key >> state.nofEvents
+     >> key >> state.nofDone
+     >> key >> state.lastEventID
+     >> key >> state.eventOffset
+     >> key >> state.nofParts
+     >> key >> size;
+  state.engine.resize(size);
+  for ( auto& value : state.engine ) is >> value;
+
+  state.run.reset(new Run);
+  is >> key;
+  state.run->Read(is);
+
+  is >> key >> size;
+  state.h1s.resize(size);
+  for ( auto& h1 : state.h1s ) {
+    is >> size;
+    h1.entries.resize(size);
+    h1.sumW.resize(size);
+    h1.sumW2.resize(size);
+    h1.sumXW.resize(size);
+    h1.sumX2W.resize(size);
+    for ( std::size_t i=0; i<size; ++i ) {
+      is >> h1.entries[i] >> h1.sumW[i] >> h1.sumW2[i] >> h1.sumXW[i] >> h1.sumX2W[i];
+    }
+  }
+
+  is >> key;
+  if ( is.fail() || key != "end" ) {
+    G4ExceptionDescription msg;
+    msg << "Checkpoint file " << path << " is corrupted, ignored.";
+    G4Exception("Checkpoint::ReadState()", "MyCode0008", JustWarning, msg);
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Checkpoint::H1List Checkpoint::GetH1s()
+{
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  H1List h1s(analysisManager->GetNofH1s());
+  for ( std::size_t id=0; id<h1s.size(); ++id ) {
+    auto histo = analysisManager->GetH1(G4int(id), false, false);
+    if ( ! histo ) continue;
+
+    auto& h1 = h1s[id];
+    h1.entries = histo->bins_entries();
+    h1.sumW = histo->bins_sum_w();
+    h1.sumW2 = histo->bins_sum_w2();
+    for ( std::size_t i=0; i<h1.entries.size(); ++i ) {
+      h1.sumXW.push_back(histo->bins_sum_xw()[i][0]);
+      h1.sumX2W.push_back(histo->bins_sum_x2w()[i][0]);
+    }
+  }
+  return h1s;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::AddToH1s(const H1List& h1s)
+{
+  auto analysisManager = G4AnalysisManager::Instance();
+  auto current = GetH1s();
+
+  AddH1s(current, h1s);
+  for ( std::size_t id=0; id<current.size(); ++id ) {
+    auto histo = analysisManager->GetH1(G4int(id), false, false);
+    if ( ! histo ) continue;
+
+    const auto& h1 = current[id];
+    for ( std::size_t i=0; i<h1.entries.size(); ++i ) {
+      histo->set_bin_content(i, h1.entries[i], h1.sumW[i], h1.sumW2[i],
+                             h1.sumXW[i], h1.sumX2W[i]);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Checkpoint::AddH1s(H1List& sum, const H1List& h1s)
+{
+  if ( sum.empty() ) {
+    sum = h1s;
+    return;
+  }
+
+  for ( std::size_t id=0; id<std::min(sum.size(), h1s.size()); ++id ) {
+    auto& h1 = sum[id];
+    const auto& other = h1s[id];
+    if ( h1.entries.size() != other.entries.size() ) continue;
+
+    for ( std::size_t i=0; i<h1.entries.size(); ++i ) {
+      h1.entries[i] += other.entries[i];
+      h1.sumW[i]    += other.sumW[i];
+      h1.sumW2[i]   += other.sumW2[i];
+      h1.sumXW[i]   += other.sumXW[i];
+      h1.sumX2W[i]  += other.sumX2W[i];
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,267 @@
+/// \file ColumnarWriter.cc
+/// \brief Implementation of the B4c::ColumnarWriter class
+
+#include "ColumnarWriter.hh"
+#include "ColumnarFormat.hh"
+#include "RunProgress.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ColumnarWriter::ColumnarWriter()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/output/", "Per-event output");
+
+  fMessenger->DeclareProperty("columnar", fEnabled)
+    .SetGuidance("Write the per-event quantities to columnar files <prefix>_t<N>.b4col.")
+    .SetParameterName("columnar", true)
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareProperty("columnarPrefix", fPrefix)
+    .SetGuidance("Prefix of the columnar file names.")
+    .SetParameterName("prefix", false);
+
+  fMessenger->DeclareProperty("ntuple", fNtupleEnabled)
+    .SetGuidance("Fill the B4 ntuple of the analysis manager (ROOT output).")
+    .SetParameterName("ntuple", true)
+    .SetDefaultValue("true");
+}
+
+ColumnarWriter::~ColumnarWriter()
+{
+  Close();
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* ColumnarWriter::GetColumnName(G4int column)
+{
+  static const char* names[kNofColumns] =
+    { "Ediode", "Eannular", "Ldiode", "Lannular", "Eprimary" };
+  return names[column];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String ColumnarWriter::GetFileName(G4int slot) const
+{
+  return fPrefix + "_t" + std::to_string(slot) + ".b4col";
+}
+
+G4String ColumnarWriter::GetPartName(G4int slot, G4int generation, G4int part) const
+{
+  return fPrefix + "_t" + std::to_string(slot) + "_g" + std::to_string(generation)
+       + "_p" + std::to_string(part) + ".b4col";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<ColumnarWriter::Part> ColumnarWriter::ListParts() const
+{
+  std::vector<Part> parts;
+  std::filesystem::path prefix(fPrefix.c_str());
+  auto directory = prefix.parent_path();
+  if ( directory.empty() ) directory = ".";
+  auto stem = prefix.filename().string() + "_t";
+
+  std::error_code error;
+  for ( const auto& entry : std::filesystem::directory_iterator(directory, error) ) {
+    auto name = entry.path().filename().string();
+    if ( name.compare(0, stem.size(), stem) != 0 ) continue;
+
+    Part part;
+    char end[8] = {};
+    if ( std::sscanf(name.c_str() + stem.size(), "%d_g%d_p%d.%6s", &part.slot,
+                     &part.generation, &part.part, end) != 4
+         || std::strcmp(end, "b4col") != 0 ) continue;
+    part.name = entry.path().string();
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::RemoveFiles(G4bool keepParts) const
+{
+  if ( ! fEnabled ) return;
+
+  for ( G4int slot=0; slot<RunProgress::kMaxSlots; ++slot ) {
+    std::remove(GetFileName(slot).c_str());
+  }
+  if ( keepParts ) return;
+  for ( const auto& part : ListParts() ) std::remove(part.name.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::RemoveParts(G4int generation, const std::vector<G4int>& nofParts) const
+{
+  if ( ! fEnabled ) return;
+
+  // a part finished after the last checkpoint holds events which are run again
+  for ( const auto& part : ListParts() ) {
+    if ( part.generation != generation ) continue;
+    auto nofSaved = ( part.slot < G4int(nofParts.size()) ) ? nofParts[part.slot] : 0;
+    if ( part.part >= nofSaved ) std::remove(part.name.c_str());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Open(G4int runID)
+{
+  Close();
+  if ( ! fEnabled ) return;
+
+  fRunID = runID;
+  fFileName = GetFileName(G4Threading::G4GetThreadId() + 1);
+  fNofParts = 0;
+  OpenSpills();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::OpenSpills()
+{
+  fNofRows = 0;
+
+  for ( G4int i=0; i<kNofColumns; ++i ) {
+    fBuffers[i].clear();
+    fBuffers[i].reserve(kBufferSize);
+    fSpills[i].open((fFileName + "." + GetColumnName(i) + ".tmp").c_str(),
+                    std::ios::binary | std::ios::trunc);
+    if ( ! fSpills[i] ) {
+      G4ExceptionDescription msg;
+      msg << "Cannot open the spill files of " << fFileName << ", columnar output disabled.";
+      G4Exception("ColumnarWriter::Open()", "MyCode0010", JustWarning, msg);
+      for ( auto& spill : fSpills ) if ( spill.is_open() ) spill.close();
+      return;
+    }
+  }
+  fOpen = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Flush()
+{
+  for ( G4int i=0; i<kNofColumns; ++i ) {
+    auto& buffer = fBuffers[i];
+    Columnar::SwapBytes(buffer.data(), buffer.size(), sizeof(G4double));
+    fSpills[i].write(reinterpret_cast<const char*>(buffer.data()),
+                     std::streamsize(buffer.size()*sizeof(G4double)));
+    buffer.clear();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Close()
+{
+  if ( ! fOpen ) return;
+  Finish(fFileName);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Commit(G4int generation)
+{
+  if ( ! fOpen ) return;
+
+  Finish(GetPartName(G4Threading::G4GetThreadId() + 1, generation, fNofParts));
+  ++fNofParts;
+  OpenSpills();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnarWriter::Finish(const G4String& fileName)
+{
+  fOpen = false;
+
+  Flush();
+  for ( auto& spill : fSpills ) spill.close();
+
+  // headers
+  Columnar::FileHeader header{};
+  std::memcpy(header.magic, Columnar::kMagic, sizeof(header.magic));
+  header.version = Columnar::kVersion;
+  header.nofColumns = kNofColumns;
+  header.nofRows = fNofRows;
+  header.runID = fRunID;
+  header.threadID = G4Threading::G4GetThreadId();
+
+  std::array<Columnar::ColumnHeader, kNofColumns> columns{};
+  std::uint64_t offset = sizeof(header) + sizeof(columns);
+  for ( G4int i=0; i<kNofColumns; ++i ) {
+    auto& column = columns[i];
+    std::snprintf(column.name, sizeof(column.name), "%s", GetColumnName(i));
+    column.type = Columnar::kFloat64;
+    column.elementSize = sizeof(G4double);
+    column.offset = Columnar::AlignUp(offset);
+    column.size = fNofRows*sizeof(G4double);
+    offset = column.offset + column.size;
+  }
+
+  // keep the offsets in the host order for the padding, then convert the
+  // headers to the file order
+  std::array<std::uint64_t, kNofColumns> offsets;
+  for ( G4int i=0; i<kNofColumns; ++i ) offsets[i] = columns[i].offset;
+
+  Columnar::SwapBytes(&header.version, 1, 4);
+  Columnar::SwapBytes(&header.nofColumns, 1, 4);
+  Columnar::SwapBytes(&header.nofRows, 1, 8);
+  Columnar::SwapBytes(&header.runID, 1, 4);
+  Columnar::SwapBytes(&header.threadID, 1, 4);
+  for ( auto& column : columns ) {
+    Columnar::SwapBytes(&column.type, 1, 4);
+    Columnar::SwapBytes(&column.elementSize, 1, 4);
+    Columnar::SwapBytes(&column.offset, 1, 8);
+    Columnar::SwapBytes(&column.size, 1, 8);
+  }
+
+  // file, with the columns copied from the spill files
+  auto tmpName = fileName + ".tmp";
+  std::ofstream file(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(columns.data()), sizeof(columns));
+
+  std::vector<char> buffer(1 << 20);
+  for ( G4int i=0; i<kNofColumns; ++i ) {
+    // padding to the aligned offset
+    std::uint64_t position = file.tellp();
+    static const char zeros[Columnar::kAlignment] = {};
+    file.write(zeros, std::streamsize(offsets[i] - position));
+
+    auto spillName = fFileName + "." + GetColumnName(i) + ".tmp";
+    std::ifstream spill(spillName.c_str(), std::ios::binary);
+    while ( spill.read(buffer.data(), std::streamsize(buffer.size())) || spill.gcount() > 0 ) {
+      file.write(buffer.data(), spill.gcount());
+    }
+    spill.close();
+    std::remove(spillName.c_str());
+  }
+  file.close();
+
+  if ( file.fail() || std::rename(tmpName.c_str(), fileName.c_str()) != 0 ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write columnar file " << fileName;
+    G4Exception("ColumnarWriter::Close()", "MyCode0010", JustWarning, msg);
+    std::remove(tmpName.c_str());
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
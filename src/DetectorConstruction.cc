@@ -3,16 +3,29 @@
 
 #include "DetectorConstruction.hh"
 #include "CalorimeterSD.hh"
+#include "FieldMap.hh"
+#include "GeometryCache.hh"
+#include "GeometryHash.hh"
+#include "Run.hh"
 #include "G4Material.hh"
 #include "G4NistManager.hh"
 
 #include "G4Box.hh"
 #include "G4Tubs.hh"
+#include "G4SubtractionSolid.hh"
 #include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4PVPlacement.hh"
 #include "G4PVReplica.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
 #include "G4GlobalMagFieldMessenger.hh"
+#include "G4FieldManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4GenericMessenger.hh"
 #include "G4AutoDelete.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
 
 #include "G4SDManager.hh"
 
@@ -22,27 +35,210 @@
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
 
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
 namespace B4c
 {
 G4ThreadLocal
 G4GlobalMagFieldMessenger* DetectorConstruction::fMagFieldMessenger = nullptr;
+G4ThreadLocal
+FieldMap* DetectorConstruction::fFieldMap = nullptr;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 DetectorConstruction::DetectorConstruction()
+  : fAngle(90.*deg),
+    fAperture(25.5*mm),
+    fDetectZdist(0.*mm),
+    fAnDetectZdist(25.5*mm),
+    fAnInnerRadius(8.*mm)
 {
+  DefineCommands();
+  fGeometryCache = new GeometryCache();
 }
 
 DetectorConstruction::~DetectorConstruction()
 {
+  delete fGeometryCache;
+  delete fFieldMessenger;
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineCommands()
+{
+  // the geometry is built on the master
+  fMessenger = new G4GenericMessenger(this, "/B4/geometry/", "Array layout");
+
+  fMessenger->DeclareMethodWithUnit("angle", "deg", &DetectorConstruction::SetAngle)
+    .SetGuidance("Rotation angle of the side modules.")
+    .SetParameterName("angle", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethodWithUnit("aperture", "mm", &DetectorConstruction::SetAperture)
+    .SetGuidance("Aperture between the side modules.")
+    .SetParameterName("aperture", false)
+    .SetRange("aperture>=0.")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethodWithUnit("detectZdist", "mm", &DetectorConstruction::SetDetectZdist)
+    .SetGuidance("Z distance of the side modules.")
+    .SetParameterName("detectZdist", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethodWithUnit("anDetectZdist", "mm", &DetectorConstruction::SetAnDetectZdist)
+    .SetGuidance("Z distance of the annular detector.")
+    .SetParameterName("anDetectZdist", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethodWithUnit("anInnerRadius", "mm", &DetectorConstruction::SetAnInnerRadius)
+    .SetGuidance("Inner radius of the annular detector (below 23.9 mm).")
+    .SetParameterName("anInnerRadius", false)
+    .SetRange("anInnerRadius>0. && anInnerRadius<23.9")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("flat", &DetectorConstruction::SetFlat)
+    .SetGuidance("Build the same materials with hollow solids and minimal nesting.")
+    .SetParameterName("flat", true)
+    .SetDefaultValue("true")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("cache", &DetectorConstruction::SetCache)
+    .SetGuidance("Start from the cached GDML file of the layout when there is one,")
+    .SetGuidance("and cache the layouts built (geometry_<hash>.gdml by default).")
+    .SetParameterName("cache", true)
+    .SetDefaultValue("true")
+    .SetToBeBroadcasted(false);
+
+  // the field is created by each thread in ConstructSDandField
+  fFieldMessenger = new G4GenericMessenger(this, "/B4/field/", "Tabulated magnetic field");
+
+  fFieldMessenger->DeclareProperty("map", fFieldMapFile)
+    .SetGuidance("Field map file, replacing the uniform field; before /run/initialize.")
+    .SetParameterName("file", false)
+    .SetToBeBroadcasted(false);
+
+  fFieldMessenger->DeclareMethod("benchmark", &DetectorConstruction::BenchmarkFieldMap)
+    .SetGuidance("Field evaluations per second, bricked against a flat array,")
+    .SetGuidance("with the map file, or a test map if none is set.")
+    .SetParameterName("nofPoints", true)
+    .SetDefaultValue("1000000")
+    .SetRange("nofPoints>0")
+    .SetToBeBroadcasted(false);
+
+  fFieldMessenger->DeclareMethod("writeTest", &DetectorConstruction::WriteTestFieldMap)
+    .SetGuidance("Write the test map, as an example of the file format.")
+    .SetParameterName("file", false)
+    .SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::BenchmarkFieldMap(G4int nofPoints)
+{
+  FieldMap::Benchmark(fFieldMapFile, nofPoints);
+}
+
+void DetectorConstruction::WriteTestFieldMap(const G4String& fileName)
+{
+  if ( FieldMap::WriteTestMap(fileName) ) {
+    G4cout << "--> Test field map written in " << fileName << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetAngle(G4double value)
+{
+  fAngle = value;
+  GeometryModified();
+}
+
+void DetectorConstruction::SetAperture(G4double value)
+{
+  fAperture = value;
+  GeometryModified();
+}
+
+void DetectorConstruction::SetDetectZdist(G4double value)
+{
+  fDetectZdist = value;
+  GeometryModified();
+}
+
+void DetectorConstruction::SetAnDetectZdist(G4double value)
+{
+  fAnDetectZdist = value;
+  GeometryModified();
+}
+
+void DetectorConstruction::SetAnInnerRadius(G4double value)
+{
+  fAnInnerRadius = value;
+  GeometryModified();
+}
+
+void DetectorConstruction::SetFlat(G4bool value)
+{
+  fFlat = value;
+  GeometryModified();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetCache(G4bool value)
+{
+  fGeometryCache->SetEnabled(value);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::GeometryModified()
+{
+  // nothing to rebuild before the first /run/initialize
+  if ( ! fConstructed ) return;
+
+  // the stores are cleaned, and the workers rebuild their navigation and
+  // sensitive detectors at the next run
+  G4RunManager::GetRunManager()->ReinitializeGeometry(true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t DetectorConstruction::GetParameterHash() const
+{
+  std::ostringstream os;
+  os << std::setprecision(17) << kBuilderVersion << ' ' << fAngle << ' ' << fAperture << ' '
+     << fDetectZdist << ' ' << fAnDetectZdist << ' ' << fAnInnerRadius << ' ' << fFlat;
+  return GeometryHash::Compute(os.str());
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
+  fConstructed = true;
+  fNofLayers = 1;
   DefineMaterials();      // Define materials
-  return DefineVolumes(); // Define volumes
+
+  // a cached layout has no overlaps: only those are cached
+  auto parameterHash = GetParameterHash();
+  auto worldPV = fGeometryCache->Read(parameterHash);
+  if ( worldPV ) {
+    fOverlaps = false;
+  }
+  else {
+    auto start = std::chrono::steady_clock::now();
+    worldPV = DefineVolumes(); // Define volumes
+    std::chrono::duration<G4double> elapsed = std::chrono::steady_clock::now() - start;
+    fGeometryCache->Built(worldPV, parameterHash, elapsed.count()*s, fOverlaps);
+  }
+
+  DefineRegions();
+  return worldPV;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -55,6 +251,9 @@ void DetectorConstruction::DefineMaterials()
   nistManager->FindOrBuildMaterial("G4_ALUMINUM_OXIDE");
   nistManager->FindOrBuildMaterial("G4_Al");
 
+  // defined once, when the geometry is rebuilt
+  if ( G4Material::GetMaterial("Galactic", false) ) return;
+
   G4double a;       // mass of a mole
   G4double z;       // z = mean number of protons
   G4double density; // density
@@ -76,8 +275,6 @@ void DetectorConstruction::DefineMaterials()
 
 G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
 {
-  // Geometry parameters
-  fNofLayers = 1;
   //-----------------------------------------------------------------------------------------
   // THE WORLD (Position is (0,0,0) and cannot be changed)
   //-----------------------------------------------------------------------------------------
@@ -175,14 +372,14 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
                                            (detectorThickness)/2);  //Z Size - detector           
                  
   G4double detectZoffset  = detectorThickness/2;   // Z offset - detector
-  G4double detectZdist    = 0 *mm;                 // Z distance - detector  
+  G4double detectZdist    = fDetectZdist;          // Z distance - detector  
   G4double detectorOffset = 2*detectSize[0];       // Offsetting the detector to make detector sized hole 
 
-  G4double angle      = 90. *deg;                                     // Angle of rotation
+  G4double angle      = fAngle;                                       // Angle of rotation
   G4double rotXoffset = -std::sin(angle)*detectSize[0];              // X-offset due to rotation
   G4double rotYoffset = detectSize[1]-std::cos(angle)*detectSize[1]; // Y-offset due to rotation
 
-  G4double aperture = 2*detectSize[0];                         // The aperture of the hole in the middle of the array
+  G4double aperture = fAperture;                               // The aperture of the hole in the middle of the array
   G4double apOffset = (aperture-detectorOffset)/2;    // Offsetting the detector by half the aperture distance
 
   G4double primaryOffset = detectorOffset+apOffset-rotYoffset+std::sin(angle)*detectZoffset; // The main placement vector with the offset
@@ -230,7 +427,7 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   G4double anBackingThickness   = anDetectorThickness/2;
   G4double anEnclosingThickness = anDetectorThickness/2;
   
-  G4double anInnerRadius = 8. *mm;
+  G4double anInnerRadius = fAnInnerRadius;
 
   //
   // PHOTOSENSITIVE REGION
@@ -261,7 +458,7 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   G4double anDetectRadius  = 30.5 *mm;
 
   G4double anDetectZoffset = anDetectorThickness/2;     // Z offset 
-  G4double anDetectZdist   = 2*detectSize[0];                     // Z distance
+  G4double anDetectZdist   = fAnDetectZdist;                      // Z distance
   G4double anZoffset       = anDetectZdist+anDetectZoffset; // The Z-direction placement vector 
 
   // PLACEMENT
@@ -311,58 +508,118 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   auto detectorS  = new G4Box("Detector", detectSize[0], detectSize[1], detectSize[2]);
   auto detectLV   = new G4LogicalVolume(detectorS, defaultMaterial, "Detector");
 
-  new G4PVPlacement(detectRot1, detect1Place, detectLV, "Detector", worldLV, false, 0, fCheckOverlaps); // upper detector placement
-  new G4PVPlacement(detectRot2, detect2Place, detectLV, "Detector", worldLV, false, 0, fCheckOverlaps); // lower detector placement 
-  new G4PVPlacement(detectRot3, detect3Place, detectLV, "Detector", worldLV, false, 0, fCheckOverlaps); // right detector placement
-  new G4PVPlacement(detectRot4, detect4Place, detectLV, "Detector", worldLV, false, 0, fCheckOverlaps); // left detector placement
-  
-  //
-  // The Ceramic extrusion
-  // 
-  auto extrusionS   = new G4Box("extrusion", extrusionSize[0], extrusionSize[1], extrusionSize[2]);
-  auto extrusionLV  = new G4LogicalVolume(extrusionS, ceramMaterial, "extrusionLV");
+  // the copy number identifies the module (AcceptanceMap)
+  G4VPhysicalVolume* modulePV[4];
+  modulePV[0] = new G4PVPlacement(detectRot1, detect1Place, detectLV, "Detector", worldLV, false, 0, false); // upper detector placement
+  modulePV[1] = new G4PVPlacement(detectRot2, detect2Place, detectLV, "Detector", worldLV, false, 1, false); // lower detector placement 
+  modulePV[2] = new G4PVPlacement(detectRot3, detect3Place, detectLV, "Detector", worldLV, false, 2, false); // right detector placement
+  modulePV[3] = new G4PVPlacement(detectRot4, detect4Place, detectLV, "Detector", worldLV, false, 3, false); // left detector placement
+
+  // the overlaps of the layout are recorded
+  fOverlaps = false;
+  if ( fCheckOverlaps ) {
+    for ( auto pv : modulePV ) fOverlaps |= pv->CheckOverlaps();
+  }
   
-  auto extrusionHoleS = new G4Box("extrusionHole", extrusionHoleSize[0], extrusionHoleSize[1], extrusionHoleSize[2]);
-  auto extrusionHoleLV = new G4LogicalVolume(extrusionHoleS, defaultMaterial, "extrusionHoleLV");
+  G4LogicalVolume* extrusionLV = nullptr;
+  G4LogicalVolume* extrusionHoleLV = nullptr;
+  G4LogicalVolume* AlringLV = nullptr;
+  G4LogicalVolume* AlringHoleLV = nullptr;
+  G4LogicalVolume* backLV = nullptr;
+  G4LogicalVolume* AlShieldLV = nullptr;
+  G4LogicalVolume* SiBuffLV = nullptr;
 
-  new G4PVPlacement(0, extrusionPlace, extrusionLV, "extrusion", detectLV, false, 0, fCheckOverlaps);
-  new G4PVPlacement(0, relPosition, extrusionHoleLV, "extrusionHole", extrusionLV, false, 0, fCheckOverlaps);
+  auto diodeS  = new G4Box("Diode", diodeSize[0], diodeSize[1], diodeSize[2]);
+  auto diodeLV = new G4LogicalVolume(diodeS, siliMaterial, "diodeLV");   
 
-  //
-  // The Aluminium ring
-  // 
-  auto AlringS    = new G4Box("Alring", AlringSize[0], AlringSize[1], AlringSize[2]);
-  auto AlringLV   = new G4LogicalVolume(AlringS, alumMaterial, "AlringLV");
+  if ( ! fFlat ) {
+    //
+    // The Ceramic extrusion
+    // 
+    auto extrusionS   = new G4Box("extrusion", extrusionSize[0], extrusionSize[1], extrusionSize[2]);
+    extrusionLV  = new G4LogicalVolume(extrusionS, ceramMaterial, "extrusionLV");
   
-  auto AlringHoleS = new G4Box("AlringHole", AlringHoleSize[0], AlringHoleSize[1], AlringHoleSize[2]);
-  auto AlringHoleLV = new G4LogicalVolume(AlringHoleS, defaultMaterial, "AlringHoleLV");
+    auto extrusionHoleS = new G4Box("extrusionHole", extrusionHoleSize[0], extrusionHoleSize[1], extrusionHoleSize[2]);
+    extrusionHoleLV = new G4LogicalVolume(extrusionHoleS, defaultMaterial, "extrusionHoleLV");
 
-  new G4PVPlacement(0, AlringPlace, AlringLV, "Alring", extrusionHoleLV, false, 0, fCheckOverlaps);
-  new G4PVPlacement(0, relPosition, AlringHoleLV, "AlringHole", AlringLV, false, 0, fCheckOverlaps); 
+    new G4PVPlacement(0, extrusionPlace, extrusionLV, "extrusion", detectLV, false, 0, fCheckOverlaps);
+    new G4PVPlacement(0, relPosition, extrusionHoleLV, "extrusionHole", extrusionLV, false, 0, fCheckOverlaps);
 
-  //
-  // Backing
-  //
-  auto backS  = new G4Box("Backing", backSize[0], backSize[1], backSize[2]); 
-  auto backLV = new G4LogicalVolume(backS, ceramMaterial, "backLV");     
+    //
+    // The Aluminium ring
+    // 
+    auto AlringS    = new G4Box("Alring", AlringSize[0], AlringSize[1], AlringSize[2]);
+    AlringLV   = new G4LogicalVolume(AlringS, alumMaterial, "AlringLV");
+  
+    auto AlringHoleS = new G4Box("AlringHole", AlringHoleSize[0], AlringHoleSize[1], AlringHoleSize[2]);
+    AlringHoleLV = new G4LogicalVolume(AlringHoleS, defaultMaterial, "AlringHoleLV");
 
-  new G4PVPlacement(0, backPlace, backLV, "Backing", detectLV, false, 0, fCheckOverlaps);    
+    new G4PVPlacement(0, AlringPlace, AlringLV, "Alring", extrusionHoleLV, false, 0, fCheckOverlaps);
+    new G4PVPlacement(0, relPosition, AlringHoleLV, "AlringHole", AlringLV, false, 0, fCheckOverlaps); 
 
-  //
-  // The entire "chip" - Al ring, Si buffer, Al light shield
-  // 
-  auto AlShieldS  = new G4Box("AlShield", AlShieldSize[0], AlShieldSize[1], AlShieldSize[2]);
-  auto AlShieldLV = new G4LogicalVolume(AlShieldS, defaultMaterial, "AlShieldLV");   
+    //
+    // Backing
+    //
+    auto backS  = new G4Box("Backing", backSize[0], backSize[1], backSize[2]); 
+    backLV = new G4LogicalVolume(backS, ceramMaterial, "backLV");     
 
-  auto SiBuffS    = new G4Box("SiBuff", SiBuffSize[0], SiBuffSize[1], SiBuffSize[2]);
-  auto SiBuffLV   = new G4LogicalVolume(SiBuffS, siliMaterial, "SiBuffLV");
+    new G4PVPlacement(0, backPlace, backLV, "Backing", detectLV, false, 0, fCheckOverlaps);    
 
-  auto diodeS  = new G4Box("Diode", diodeSize[0], diodeSize[1], diodeSize[2]);
-  auto diodeLV = new G4LogicalVolume(diodeS, siliMaterial, "diodeLV");   
+    //
+    // The entire "chip" - Al ring, Si buffer, Al light shield
+    // 
+    auto AlShieldS  = new G4Box("AlShield", AlShieldSize[0], AlShieldSize[1], AlShieldSize[2]);
+    AlShieldLV = new G4LogicalVolume(AlShieldS, defaultMaterial, "AlShieldLV");   
 
-  new G4PVPlacement(0, diodePlace, AlShieldLV, "AlShield", backLV, false, 0, fCheckOverlaps); 
-  new G4PVPlacement(0, relPosition, SiBuffLV, "SiBuff", AlShieldLV, false, 0, fCheckOverlaps); 
-  new G4PVPlacement(0, relPosition, diodeLV, "Diode", SiBuffLV, false, 0, fCheckOverlaps); 
+    auto SiBuffS    = new G4Box("SiBuff", SiBuffSize[0], SiBuffSize[1], SiBuffSize[2]);
+    SiBuffLV   = new G4LogicalVolume(SiBuffS, siliMaterial, "SiBuffLV");
+
+    new G4PVPlacement(0, diodePlace, AlShieldLV, "AlShield", backLV, false, 0, fCheckOverlaps); 
+    new G4PVPlacement(0, relPosition, SiBuffLV, "SiBuff", AlShieldLV, false, 0, fCheckOverlaps); 
+    new G4PVPlacement(0, relPosition, diodeLV, "Diode", SiBuffLV, false, 0, fCheckOverlaps); 
+  }
+  else {
+    //
+    // Flat build: the holes are cut in hollow solids, and all the layers are
+    // placed in the Detector, whose vacuum fills the holes and the light shield.
+    // The subtracted boxes exceed the faces, so that no surface is coincident.
+    //
+    G4double cut = 1. *um;
+
+    // The Ceramic extrusion
+    auto extrusionS = new G4SubtractionSolid("extrusion",
+      new G4Box("extrusionOuter", extrusionSize[0], extrusionSize[1], extrusionSize[2]),
+      new G4Box("extrusionHole", extrusionHoleSize[0], extrusionHoleSize[1], extrusionHoleSize[2]+cut));
+    extrusionLV = new G4LogicalVolume(extrusionS, ceramMaterial, "extrusionLV");
+
+    new G4PVPlacement(0, extrusionPlace, extrusionLV, "extrusion", detectLV, false, 0, fCheckOverlaps);
+
+    // The Aluminium ring
+    auto AlringS = new G4SubtractionSolid("Alring",
+      new G4Box("AlringOuter", AlringSize[0], AlringSize[1], AlringSize[2]),
+      new G4Box("AlringHole", AlringHoleSize[0], AlringHoleSize[1], AlringHoleSize[2]+cut));
+    AlringLV = new G4LogicalVolume(AlringS, alumMaterial, "AlringLV");
+
+    new G4PVPlacement(0, extrusionPlace+AlringPlace, AlringLV, "Alring", detectLV, false, 0, fCheckOverlaps);
+
+    // Backing, with the pocket of the light shield
+    auto backS = new G4SubtractionSolid("Backing",
+      new G4Box("BackingOuter", backSize[0], backSize[1], backSize[2]),
+      new G4Box("BackingPocket", AlShieldSize[0], AlShieldSize[1], AlShieldSize[2]+cut),
+      0, diodePlace-G4ThreeVector(0., 0., cut));
+    backLV = new G4LogicalVolume(backS, ceramMaterial, "backLV");
+
+    new G4PVPlacement(0, backPlace, backLV, "Backing", detectLV, false, 0, fCheckOverlaps);
+
+    // The Si buffer around the diode
+    auto SiBuffS = new G4SubtractionSolid("SiBuff",
+      new G4Box("SiBuffOuter", SiBuffSize[0], SiBuffSize[1], SiBuffSize[2]),
+      new G4Box("SiBuffHole", diodeSize[0], diodeSize[1], diodeSize[2]+cut));
+    SiBuffLV = new G4LogicalVolume(SiBuffS, siliMaterial, "SiBuffLV");
+
+    new G4PVPlacement(0, backPlace+diodePlace, SiBuffLV, "SiBuff", detectLV, false, 0, fCheckOverlaps);
+    new G4PVPlacement(0, backPlace+diodePlace, diodeLV, "Diode", detectLV, false, 0, fCheckOverlaps);
+  }
   //-----------------------------------------------------------------------------------------
 
   //-----------------------------------------------------------------------------------------
@@ -372,14 +629,24 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   //
   // Detector
   //
-  auto anDetectorS  = new G4Tubs("anDetector", 
-                                  anInnerRadius, 
-                                  anDetectRadius, 
-                                  (anDetectorThickness/2), 
-                                  0 *deg, 360 *deg);
-  auto anDetectorLV = new G4LogicalVolume(anDetectorS, defaultMaterial, "anDetectorLV");
+  G4LogicalVolume* anDetectorLV = nullptr;
+  G4LogicalVolume* anMotherLV = worldLV;       // mother of the layers
+  G4ThreeVector anLayerOffset = anDetectorPlace;
 
-  new G4PVPlacement(0, anDetectorPlace, anDetectorLV, "anDetector", worldLV, false, 0, fCheckOverlaps);
+  if ( ! fFlat ) {
+    auto anDetectorS  = new G4Tubs("anDetector", 
+                                    anInnerRadius, 
+                                    anDetectRadius, 
+                                    (anDetectorThickness/2), 
+                                    0 *deg, 360 *deg);
+    anDetectorLV = new G4LogicalVolume(anDetectorS, defaultMaterial, "anDetectorLV");
+
+    auto anDetectorPV = new G4PVPlacement(0, anDetectorPlace, anDetectorLV, "anDetector", worldLV, false, 0, false);
+    if ( fCheckOverlaps ) fOverlaps |= anDetectorPV->CheckOverlaps();
+
+    anMotherLV = anDetectorLV;
+    anLayerOffset = G4ThreeVector();
+  }
 
   //
   // Photosensitive region
@@ -391,7 +658,7 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
                                      0 *deg, 360 *deg);
   auto anPhotoRegionLV = new G4LogicalVolume(anPhotoRegionS, siliMaterial, "anPhotoRegionLV");
 
-  new G4PVPlacement(0, anPhotoPlace, anPhotoRegionLV, "anDetector", anDetectorLV, false, 0, fCheckOverlaps);
+  auto anPhotoRegionPV = new G4PVPlacement(0, anLayerOffset+anPhotoPlace, anPhotoRegionLV, "anDetector", anMotherLV, false, 0, false);
 
   //
   // Enclosing region
@@ -403,7 +670,7 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
                                         0 *deg, 360 *deg);
   auto anEnclosingRegionLV = new G4LogicalVolume(anEnclosingRegionS, ceramMaterial, "anEnclosingRegionLV");
 
-  new G4PVPlacement(0, anEnclosingPlace, anEnclosingRegionLV, "anDetector", anDetectorLV, false, 0, fCheckOverlaps);
+  auto anEnclosingRegionPV = new G4PVPlacement(0, anLayerOffset+anEnclosingPlace, anEnclosingRegionLV, "anDetector", anMotherLV, false, 0, false);
 
   //
   // Backing
@@ -415,7 +682,15 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
                                  0 *deg, 360 *deg);
   auto anBackingLV = new G4LogicalVolume(anBackingS, ceramMaterial, "anBackingLV");
 
-  new G4PVPlacement(0, anBackPlace, anBackingLV, "anBacking", anDetectorLV, false, 0, fCheckOverlaps);
+  auto anBackingPV = new G4PVPlacement(0, anLayerOffset+anBackPlace, anBackingLV, "anBacking", anMotherLV, false, 0, false);
+
+  // in the flat build, the layers are checked against the modules
+  if ( fCheckOverlaps ) {
+    for ( auto pv : { anPhotoRegionPV, anEnclosingRegionPV, anBackingPV } ) {
+      G4bool overlaps = pv->CheckOverlaps();
+      if ( fFlat ) fOverlaps |= overlaps;
+    }
+  }
 
   //-----------------------------------------------------------------------------------------
 
@@ -456,12 +731,12 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   SiBuffLV    ->SetVisAttributes(whiteBoxVisAtt);   //Si buffer : Silicon colour
 
   AlringLV    ->SetVisAttributes(aluminiumRingVisAtt);  //Al ring : Red
-  AlringHoleLV->SetVisAttributes(aluminiumRingVisAtt);  //Al ring hole : Red
-  AlShieldLV  ->SetVisAttributes(aluminiumVisAtt);      //Al shield : Aluminium colour 
+  if ( AlringHoleLV ) AlringHoleLV->SetVisAttributes(aluminiumRingVisAtt);  //Al ring hole : Red
+  if ( AlShieldLV ) AlShieldLV->SetVisAttributes(aluminiumVisAtt);          //Al shield : Aluminium colour 
 
   backLV          ->SetVisAttributes(ceramicBoxVisAtt); //backing plate : Ceramic colour
   extrusionLV     ->SetVisAttributes(extrusionVisAtt); //extrusion : Green
-  extrusionHoleLV ->SetVisAttributes(extrusionVisAtt); //extrusion hole : Green
+  if ( extrusionHoleLV ) extrusionHoleLV->SetVisAttributes(extrusionVisAtt); //extrusion hole : Green
 
   //CANBERRA ANNULAR DETECTOR
   auto AnceramicBoxVisAtt = new G4VisAttributes(G4Colour(0.88,0.87,0.82));  //rgb = (119,195,236)
@@ -470,7 +745,7 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   AnceramicBoxVisAtt ->SetVisibility(true);
   AnsiliconBoxVisAtt ->SetVisibility(true);
 
-  anDetectorLV        ->SetVisAttributes(G4VisAttributes::GetInvisible()); //detector : Invisible
+  if ( anDetectorLV ) anDetectorLV->SetVisAttributes(G4VisAttributes::GetInvisible()); //detector : Invisible
   anPhotoRegionLV     ->SetVisAttributes(AnsiliconBoxVisAtt);       //photosensitive : Silicon color
   anBackingLV         ->SetVisAttributes(AnceramicBoxVisAtt);       //backing plate : Ceramic color
   anEnclosingRegionLV ->SetVisAttributes(AnceramicBoxVisAtt);       //enclosure : Ceramic color
@@ -480,6 +755,37 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void DetectorConstruction::DefineRegions()
+{
+  //
+  // Regions (used for the secondary stacking thresholds)
+  //
+  // (kept by the region store when the geometry is rebuilt; the volumes are
+  // found by name, as they may have been read from the cache)
+  auto store = G4LogicalVolumeStore::GetInstance();
+
+  auto hamamatsuRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("Hamamatsu");
+  auto detectLV = store->GetVolume("Detector");
+  detectLV->SetRegion(hamamatsuRegion);
+  hamamatsuRegion->AddRootLogicalVolume(detectLV);
+
+  // the annular envelope, or its layers in the flat build
+  auto canberraRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("Canberra");
+  if ( auto anDetectorLV = store->GetVolume("anDetectorLV", false) ) {
+    anDetectorLV->SetRegion(canberraRegion);
+    canberraRegion->AddRootLogicalVolume(anDetectorLV);
+  }
+  else {
+    for ( auto name : { "anPhotoRegionLV", "anEnclosingRegionLV", "anBackingLV" } ) {
+      auto lv = store->GetVolume(name);
+      lv->SetRegion(canberraRegion);
+      canberraRegion->AddRootLogicalVolume(lv);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void DetectorConstruction::ConstructSDandField()
 {
   // G4SDManager::GetSDMpointer()->SetVerboseLevel(1);
@@ -487,21 +793,71 @@ void DetectorConstruction::ConstructSDandField()
   //
   // Sensitive detectors
   //
-  auto diodeSD = new CalorimeterSD("diodeSD", "DiodeHitsCollection", fNofLayers);
-  G4SDManager::GetSDMpointer()->AddNewDetector(diodeSD);
+  // the detectors of a previous build are reused when the geometry is rebuilt
+  auto sdManager = G4SDManager::GetSDMpointer();
+  auto diodeSD = sdManager->FindSensitiveDetector("diodeSD", false);
+  if ( ! diodeSD ) {
+    diodeSD = new CalorimeterSD("diodeSD", "DiodeHitsCollection", fNofLayers,
+                                Run::kDiodeDetector);
+    sdManager->AddNewDetector(diodeSD);
+  }
   SetSensitiveDetector("diodeLV",diodeSD);
 
-  auto annularSD = new CalorimeterSD("annularSD", "AnnularHitsCollection", fNofLayers);
-  G4SDManager::GetSDMpointer()->AddNewDetector(annularSD);
+  auto annularSD = sdManager->FindSensitiveDetector("annularSD", false);
+  if ( ! annularSD ) {
+    annularSD = new CalorimeterSD("annularSD", "AnnularHitsCollection", fNofLayers,
+                                  Run::kAnnularDetector);
+    sdManager->AddNewDetector(annularSD);
+  }
   SetSensitiveDetector("anPhotoRegionLV",annularSD);
   //
-  // Magnetic field - Create global magnetic field messenger.
+  // Magnetic field - the global magnetic field messenger, then the tabulated
+  // field if a map is set. The messenger is created first: it sets its
+  // (zero) field in the field manager, which would remove the map.
   //
-  G4ThreeVector fieldValue;   // Uniform magnetic field created if the field value is not zero.
-  fMagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
-  fMagFieldMessenger->SetVerboseLevel(1);
+  if ( ! fMagFieldMessenger ) {
+    G4ThreeVector fieldValue;   // Uniform magnetic field created if the field value is not zero.
+    fMagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
+    fMagFieldMessenger->SetVerboseLevel(1);
+
+    G4AutoDelete::Register(fMagFieldMessenger); // Register the field messenger for deleting
+  }
 
-  G4AutoDelete::Register(fMagFieldMessenger); // Register the field messenger for deleting
+  if ( ! fFieldMapFile.empty() && ! fFieldMap ) {
+    fFieldMap = new FieldMap(fFieldMapFile);
+    auto fieldManager
+      = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+    if ( fFieldMap->IsValid() ) {
+      fieldManager->SetDetectorField(fFieldMap);
+      fieldManager->CreateChordFinder(fFieldMap);
+    }
+    G4AutoDelete::Register(fFieldMap);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::CheckFieldMap()
+{
+  // no map, or an invalid one, reported by FieldMap
+  if ( ! fFieldMap || ! fFieldMap->IsValid() ) return;
+
+  auto field = G4TransportationManager::GetTransportationManager()
+                 ->GetFieldManager()->GetDetectorField();
+  if ( field != fFieldMap ) {
+    G4ExceptionDescription msg;
+    msg << "The field map is not the field of the run: "
+        << ( field ? "it was replaced (/globalField/setValue)." : "there is no field." );
+    G4Exception("DetectorConstruction::CheckFieldMap()", "MyCode0018", JustWarning, msg);
+  }
+  else if ( G4Threading::G4GetThreadId() <= 0 ) {
+    const G4double origin[4] = { 0., 0., 0., 0. };
+    G4double value[6] = { 0., 0., 0., 0., 0., 0. };
+    field->GetFieldValue(origin, value);
+    G4cout << "--> Field map active; field at the origin ("
+           << value[0]/tesla << ", " << value[1]/tesla << ", " << value[2]/tesla
+           << ") tesla" << G4endl;
+  }
 }
 
 }
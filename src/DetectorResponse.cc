@@ -0,0 +1,156 @@
+/// \file DetectorResponse.cc
+/// \brief Implementation of the B4c::DetectorResponse class
+
+#include "DetectorResponse.hh"
+
+#include "G4AnalysisManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4PhysicalConstants.hh"
+
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+DetectorResponse::DetectorResponse()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/response/", "Detector response");
+
+  fMessenger->DeclareProperty("enable", fEnabled)
+    .SetGuidance("Fill the digitised spectra Ediode_digi and Eannular_digi.")
+    .SetParameterName("enable", true)
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareProperty("batchSize", fBatchSize)
+    .SetGuidance("Number of events processed together.")
+    .SetParameterName("batchSize", false)
+    .SetRange("batchSize>0");
+
+  for ( G4int i=0; i<kNofDetectors; ++i ) {
+    auto& channel = fChannels[i];
+    G4String directory = G4String("/B4/response/") + GetName(i) + "/";
+    channel.messenger = new G4GenericMessenger(this, directory,
+      G4String("Response of the ") + GetName(i) + " detector");
+
+    channel.messenger->DeclareProperty("fano", channel.fano)
+      .SetGuidance("Fano factor.")
+      .SetParameterName("fano", false)
+      .SetRange("fano>=0.");
+
+    channel.messenger->DeclarePropertyWithUnit("pairEnergy", "eV", channel.pairEnergy)
+      .SetGuidance("Mean energy to create an electron-hole pair.")
+      .SetParameterName("pairEnergy", false)
+      .SetRange("pairEnergy>0.");
+
+    channel.messenger->DeclarePropertyWithUnit("noise", "keV", channel.noise)
+      .SetGuidance("RMS of the electronic noise.")
+      .SetParameterName("noise", false)
+      .SetRange("noise>=0.");
+
+    channel.messenger->DeclarePropertyWithUnit("deadLayer", "keV", channel.deadLayer)
+      .SetGuidance("Energy lost in the dead layer, subtracted from the deposit.")
+      .SetParameterName("deadLayer", false)
+      .SetRange("deadLayer>=0.");
+
+    channel.messenger->DeclarePropertyWithUnit("threshold", "keV", channel.threshold)
+      .SetGuidance("Threshold on the digitised energy.")
+      .SetParameterName("threshold", false)
+      .SetRange("threshold>=0.");
+  }
+}
+
+DetectorResponse::~DetectorResponse()
+{
+  for ( auto& channel : fChannels ) delete channel.messenger;
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* DetectorResponse::GetName(G4int detector)
+{
+  static const char* names[kNofDetectors] = { "diode", "annular" };
+  return names[detector];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorResponse::BeginOfRun()
+{
+  auto analysisManager = G4AnalysisManager::Instance();
+  fChannels[kDiode].h1ID = analysisManager->GetH1Id("Ediode_digi");
+  fChannels[kAnnular].h1ID = analysisManager->GetH1Id("Eannular_digi");
+
+  for ( auto& channel : fChannels ) {
+    channel.edep.clear();
+    if ( fEnabled ) channel.edep.reserve(fBatchSize);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorResponse::GenerateGaussians(std::size_t n)
+{
+  // Box-Muller: each pair of flat numbers gives one normal number per
+  // detector; the loops have no branch so that they can be vectorised
+  fFlats.resize(2*n);
+  G4Random::getTheEngine()->flatArray(G4int(2*n), fFlats.data());
+
+  auto& gauss0 = fChannels[kDiode].gauss;
+  auto& gauss1 = fChannels[kAnnular].gauss;
+  gauss0.resize(n);
+  gauss1.resize(n);
+
+  const G4double* u1 = fFlats.data();
+  const G4double* u2 = fFlats.data() + n;
+  for ( std::size_t i=0; i<n; ++i ) {
+    gauss0[i] = std::sqrt(-2.*std::log(std::max(u1[i], DBL_MIN)));
+  }
+  for ( std::size_t i=0; i<n; ++i ) {
+    G4double phase = twopi*u2[i];
+    gauss1[i] = gauss0[i]*std::sin(phase);
+    gauss0[i] = gauss0[i]*std::cos(phase);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorResponse::Flush()
+{
+  auto n = fChannels[kDiode].edep.size();
+  if ( n == 0 ) return;
+
+  GenerateGaussians(n);
+
+  auto analysisManager = G4AnalysisManager::Instance();
+  for ( auto& channel : fChannels ) {
+    auto edep = channel.edep.data();
+    auto gauss = channel.gauss.data();
+
+    // digitised energy, in place of the normal numbers
+    G4double fanoVariance = channel.fano*channel.pairEnergy;
+    G4double noiseVariance = channel.noise*channel.noise;
+    for ( std::size_t i=0; i<n; ++i ) {
+      G4double energy = std::max(edep[i] - channel.deadLayer, 0.);
+      gauss[i] = energy + std::sqrt(fanoVariance*energy + noiseVariance)*gauss[i];
+    }
+
+    // events without a deposit in the active volume are not digitised
+    for ( std::size_t i=0; i<n; ++i ) {
+      if ( edep[i] > channel.deadLayer && gauss[i] > channel.threshold ) {
+        analysisManager->FillH1(channel.h1ID, gauss[i]);
+      }
+    }
+    channel.edep.clear();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,73 @@
+/// \file EnergyBudget.cc
+/// \brief Implementation of the B4c::EnergyBudget class
+
+#include "EnergyBudget.hh"
+
+#include "G4LogicalVolumeStore.hh"
+
+#include <algorithm>
+
+namespace B4c
+{
+
+namespace
+{
+  // Short names used for histograms and printing
+  const char* const kNames[EnergyBudget::kNofVolumes] = {
+    "Diode", "Annular", "Alring", "SiBuff", "AlShield",
+    "Backing", "Extrusion", "AnEnclosing", "AnBacking", "Other"
+  };
+
+  // Logical volume names as defined in DetectorConstruction
+  const char* const kVolumeNames[EnergyBudget::kNofVolumes] = {
+    "diodeLV", "anPhotoRegionLV", "AlringLV", "SiBuffLV", "AlShieldLV",
+    "backLV", "extrusionLV", "anEnclosingRegionLV", "anBackingLV", ""
+  };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EnergyBudget::Initialize()
+{
+  auto store = G4LogicalVolumeStore::GetInstance();
+
+  G4int maxID = -1;
+  for ( auto volume : *store ) {
+    maxID = std::max(maxID, volume->GetInstanceID());
+  }
+
+  fIndex.assign(maxID+1, kOther);
+  for ( auto volume : *store ) {
+    for ( G4int i=0; i<kOther; ++i ) {
+      if ( volume->GetName() == kVolumeNames[i] ) {
+        fIndex[volume->GetInstanceID()] = i;
+        break;
+      }
+    }
+  }
+
+  Clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EnergyBudget::Clear()
+{
+  fEdep.fill(0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* EnergyBudget::GetName(G4int index)
+{
+  return kNames[index];
+}
+
+const char* EnergyBudget::GetVolumeName(G4int index)
+{
+  return kVolumeNames[index];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,150 @@
+/// \file EntryMaps.cc
+/// \brief Implementation of the B4c::EntryMaps class
+
+#include "EntryMaps.hh"
+
+#include "G4UnitsTable.hh"
+
+#include <istream>
+#include <ostream>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+EntryMaps::EntryMaps()
+{
+  fPosition.assign(kNofPositionBins*kNofPositionBins, 0);
+  fAngleEnergy.assign(kNofAngleBins*kNofEnergyBins, 0);
+  fAngleRadius.assign(kNofAngleBins*kNofRadiusBins, 0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EntryMaps::Merge(const EntryMaps& other)
+{
+  // the threads share the geometry of the run
+  if ( other.fNofEntries > 0 ) fHalfSize = other.fHalfSize;
+
+  fNofEntries += other.fNofEntries;
+  fAngleSum   += other.fAngleSum;
+  fEnergySum  += other.fEnergySum;
+  for ( G4int face=0; face<kNofFaces; ++face ) fFaces[face] += other.fFaces[face];
+
+  for ( std::size_t i=0; i<fPosition.size(); ++i ) fPosition[i] += other.fPosition[i];
+  for ( std::size_t i=0; i<fAngleEnergy.size(); ++i ) fAngleEnergy[i] += other.fAngleEnergy[i];
+  for ( std::size_t i=0; i<fAngleRadius.size(); ++i ) fAngleRadius[i] += other.fAngleRadius[i];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EntryMaps::Write(std::ostream& os) const
+{
+  os << " " << fHalfSize.x() << " " << fHalfSize.y() << " " << fHalfSize.z()
+     << " " << fNofEntries << " " << fAngleSum << " " << fEnergySum;
+  for ( auto count : fFaces ) os << " " << count;
+
+  // maps: number of filled bins, then (bin, count) pairs
+  for ( const auto map : { &fPosition, &fAngleEnergy, &fAngleRadius } ) {
+    auto nofFilled = std::count_if(map->begin(), map->end(),
+                                   [](std::uint32_t count) { return count != 0; });
+    os << " " << nofFilled;
+    for ( std::size_t i=0; i<map->size(); ++i ) {
+      if ( (*map)[i] != 0 ) os << " " << i << " " << (*map)[i];
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EntryMaps::Read(std::istream& is)
+{
+  G4double x = 0., y = 0., z = 0.;
+  is >> x >> y >> z >> fNofEntries >> fAngleSum >> fEnergySum;
+  fHalfSize.set(x, y, z);
+  for ( auto& count : fFaces ) is >> count;
+
+  for ( auto map : { &fPosition, &fAngleEnergy, &fAngleRadius } ) {
+    std::fill(map->begin(), map->end(), 0);
+    G4int nofFilled = 0;
+    is >> nofFilled;
+    for ( G4int j=0; j<nofFilled; ++j ) {
+      std::size_t bin = 0;
+      std::uint32_t count = 0;
+      is >> bin >> count;
+      if ( bin < map->size() ) (*map)[bin] = count;
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t EntryMaps::GetMemorySize() const
+{
+  return sizeof(*this)
+       + ( fPosition.capacity() + fAngleEnergy.capacity() + fAngleRadius.capacity() )
+         *sizeof(std::uint32_t);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EntryMaps::Print(const G4String& name) const
+{
+  if ( fNofEntries == 0 ) return;
+
+  auto fraction = [this](Face face) { return 100.*fFaces[face]/fNofEntries; };
+  G4cout
+    << " " << name << " : " << fNofEntries << " primary entries, mean incidence "
+    << fAngleSum/fNofEntries/deg << " deg, mean energy "
+    << G4BestUnit(fEnergySum/fNofEntries, "Energy")
+    << "; -z face " << fraction(kMinusZ) << " %, +z face " << fraction(kPlusZ)
+    << " %, sides " << fraction(kSide) << " %" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EntryMaps::WriteMaps(std::ostream& os, G4int runID, const G4String& name) const
+{
+  if ( fNofEntries == 0 ) return;
+
+  auto xWidth = 2.*fHalfSize.x()/kNofPositionBins;
+  auto yWidth = 2.*fHalfSize.y()/kNofPositionBins;
+  auto rWidth = std::sqrt(fHalfSize.x()*fHalfSize.x() + fHalfSize.y()*fHalfSize.y())
+              / kNofRadiusBins;
+  auto angle = [](G4int i) { return (i + 0.5)*kAngleBinWidth/deg; };
+
+  os << "# run " << runID << " " << name << " entries " << fNofEntries << "\n"
+     << "# position x(mm) y(mm) entries\n";
+  for ( G4int iy=0; iy<kNofPositionBins; ++iy ) {
+    for ( G4int ix=0; ix<kNofPositionBins; ++ix ) {
+      auto count = fPosition[iy*kNofPositionBins + ix];
+      if ( count == 0 ) continue;
+      os << "position " << (-fHalfSize.x() + (ix + 0.5)*xWidth)/mm << " "
+         << (-fHalfSize.y() + (iy + 0.5)*yWidth)/mm << " " << count << "\n";
+    }
+  }
+
+  os << "# angle_energy angle(deg) energy(MeV) entries\n";
+  for ( G4int ia=0; ia<kNofAngleBins; ++ia ) {
+    for ( G4int ie=0; ie<kNofEnergyBins; ++ie ) {
+      auto count = fAngleEnergy[ia*kNofEnergyBins + ie];
+      if ( count == 0 ) continue;
+      os << "angle_energy " << angle(ia) << " " << (ie + 0.5)*kEnergyBinWidth/MeV << " "
+         << count << "\n";
+    }
+  }
+
+  os << "# angle_radius angle(deg) radius(mm) entries\n";
+  for ( G4int ia=0; ia<kNofAngleBins; ++ia ) {
+    for ( G4int ir=0; ir<kNofRadiusBins; ++ir ) {
+      auto count = fAngleRadius[ia*kNofRadiusBins + ir];
+      if ( count == 0 ) continue;
+      os << "angle_radius " << angle(ia) << " " << (ir + 0.5)*rWidth/mm << " " << count << "\n";
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,130 @@
+/// \file EscapeFilter.cc
+/// \brief Implementation of the B4c::EscapeFilter class
+
+#include "EscapeFilter.hh"
+
+#include "G4FieldManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+EscapeFilter::EscapeFilter()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/escape/", "Geometric escape filter");
+
+  fMessenger->DeclareProperty("enable", fEnabled)
+    .SetGuidance("Kill the primaries which cannot reach any volume of the array.")
+    .SetParameterName("enable", true)
+    .SetDefaultValue("true");
+}
+
+EscapeFilter::~EscapeFilter()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EscapeFilter::Initialize()
+{
+  fBoxes.clear();
+  fActive = false;
+
+  auto transportationManager = G4TransportationManager::GetTransportationManager();
+  fWorld = transportationManager->GetNavigatorForTracking()->GetWorldVolume();
+
+  if ( ! fEnabled || ! fWorld ) return;
+
+  // A curved trajectory may reach a volume missed by its straight continuation
+  if ( transportationManager->GetFieldManager()->GetDetectorField() ) return;
+
+  // Bounding box of each daughter of the world, in the world frame,
+  // enlarged by a small margin
+  const G4double margin = 1.*um;
+  auto worldLV = fWorld->GetLogicalVolume();
+
+  for ( std::size_t i=0; i<worldLV->GetNoDaughters(); ++i ) {
+    auto daughter = worldLV->GetDaughter(i);
+
+    G4ThreeVector pMin, pMax;
+    daughter->GetLogicalVolume()->GetSolid()->BoundingLimits(pMin, pMax);
+
+    auto rotation = daughter->GetObjectRotationValue();
+    auto translation = daughter->GetTranslation();
+
+    Box box;
+    box.min = G4ThreeVector( DBL_MAX,  DBL_MAX,  DBL_MAX);
+    box.max = G4ThreeVector(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+    for ( G4int corner=0; corner<8; ++corner ) {
+      G4ThreeVector local((corner & 1) ? pMax.x() : pMin.x(),
+                          (corner & 2) ? pMax.y() : pMin.y(),
+                          (corner & 4) ? pMax.z() : pMin.z());
+      auto global = rotation*local + translation;
+      for ( G4int axis=0; axis<3; ++axis ) {
+        box.min[axis] = std::min(box.min[axis], global[axis] - margin);
+        box.max[axis] = std::max(box.max[axis], global[axis] + margin);
+      }
+    }
+    fBoxes.push_back(box);
+  }
+
+  fActive = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool EscapeFilter::IsEscaping(const G4ThreeVector& position,
+                                const G4ThreeVector& direction) const
+{
+  for ( const auto& box : fBoxes ) {
+    if ( Intersects(box, position, direction) ) return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool EscapeFilter::Intersects(const Box& box, const G4ThreeVector& position,
+                                const G4ThreeVector& direction) const
+{
+  // Slab test: intersect the ray parameter ranges over the three axes
+  G4double tMin = 0.;
+  G4double tMax = DBL_MAX;
+
+  for ( G4int axis=0; axis<3; ++axis ) {
+    auto p = position[axis];
+    auto d = direction[axis];
+
+    if ( std::abs(d) < 1.e-12 ) {
+      if ( p < box.min[axis] || p > box.max[axis] ) return false;
+      continue;
+    }
+
+    auto t1 = (box.min[axis] - p)/d;
+    auto t2 = (box.max[axis] - p)/d;
+    if ( t1 > t2 ) std::swap(t1, t2);
+
+    tMin = std::max(tMin, t1);
+    tMax = std::min(tMax, t2);
+    if ( tMin > tMax ) return false;
+  }
+
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
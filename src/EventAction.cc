@@ -2,17 +2,26 @@
 /// \brief Implementation of the B4c::EventAction class
 
 #include "EventAction.hh"
+#include "AcceptanceMap.hh"
+#include "Checkpoint.hh"
+#include "ColumnarWriter.hh"
 #include "CalorimeterSD.hh"
 #include "CalorHit.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "Run.hh"
 
 #include "G4AnalysisManager.hh"
 #include "G4RunManager.hh"
 #include "G4Event.hh"
 #include "G4SDManager.hh"
 #include "G4HCofThisEvent.hh"
+#include "G4Track.hh"
 #include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
 
 #include "Randomize.hh"
+
+#include <algorithm>
 #include <iomanip>
 
 namespace B4c
@@ -44,8 +53,69 @@ EventAction::GetHitsCollection(G4int hcID, const G4Event* event) const
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void EventAction::BeginOfRun()
+{
+  // Precompute the volume slots of the energy budgets and the bounding boxes
+  // of the escape filter for the current geometry
+  fNofPrimaries = B4::PrimaryGeneratorAction::GetNofPrimaries();
+  fEnergyBudgets.resize(fNofPrimaries);
+  for ( auto& budget : fEnergyBudgets ) budget.Initialize();
+  fEscapeFilter.Initialize();
+
+  fStopping.BeginOfRun();
+  fResponse.BeginOfRun();
+
+  auto primaryGenerator = static_cast<const B4::PrimaryGeneratorAction*>(
+    G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+  fQuasiRandom = primaryGenerator ? &primaryGenerator->GetQuasiRandom() : nullptr;
+  fProgressSlot = &RunProgress::Instance()->GetSlot();
+
+  // Get the first energy budget histogram ID
+  fBudgetH1ID = G4AnalysisManager::Instance()->GetH1Id(
+    G4String("Ebudget_") + EnergyBudget::GetName(0));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::EndOfRun()
+{
+  // digitise the events left in the last batch
+  fResponse.Flush();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void EventAction::BeginOfEventAction(const G4Event* /*event*/)
-{}
+{
+  for ( auto& budget : fEnergyBudgets ) budget.Clear();
+  fNofSteps.assign(fNofPrimaries, 0);
+  fCurrentPrimary = 0;
+  if ( fAcceptanceMap && fAcceptanceMap->IsEnabled() ) fAcceptanceMap->BeginOfEvent(fNofPrimaries);
+
+  if ( fCheckpoint ) {
+    // the histograms of a shard include all the events counted in it
+    if ( fCheckpoint->IsShardDue() ) fResponse.Flush();
+    fCheckpoint->BeginOfEvent();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventAction::SetCurrentPrimary(const G4Track* track)
+{
+  if ( fNofPrimaries == 1 ) return;
+
+  // a track is tracked after its parent, so the parent entry is the one of
+  // this event; the primary k has the track ID k+1
+  auto trackID = track->GetTrackID();
+  auto parentID = track->GetParentID();
+  fCurrentPrimary = ( parentID == 0 ) ? trackID - 1 : fPrimaryOfTrack[parentID];
+
+  if ( trackID >= G4int(fPrimaryOfTrack.size()) ) {
+    fPrimaryOfTrack.resize(std::max(2*fPrimaryOfTrack.size(), std::size_t(trackID+1)));
+  }
+  fPrimaryOfTrack[trackID] = fCurrentPrimary;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -61,31 +131,86 @@ void EventAction::EndOfEventAction(const G4Event* event)
   auto diodeHC   = GetHitsCollection(fDioHCID, event);
   auto annularHC = GetHitsCollection(fAnnHCID, event);
 
-  // Get hit with total values
-  auto diodeHit   = (*diodeHC)[diodeHC->entries()-1];
-  auto annularHit = (*annularHC)[annularHC->entries()-1];
-
-  // Fill histograms, ntuple
-  //
-
   // get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
+  auto run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+  auto progress = RunProgress::Instance();
+
+  // each primary as its own event
+  auto nofDiodeHits = diodeHC->entries()/fNofPrimaries;
+  auto nofAnnularHits = annularHC->entries()/fNofPrimaries;
+  for ( G4int primary=0; primary<fNofPrimaries; ++primary ) {
+    // Get hit with total values
+    auto diodeHit   = (*diodeHC)[(primary+1)*nofDiodeHits-1];
+    auto annularHit = (*annularHC)[(primary+1)*nofAnnularHits-1];
+    const auto& energyBudget = fEnergyBudgets[primary];
+
+    // Fill histograms, ntuple
+    //
+
+    // fill histograms
+    analysisManager->FillH1(0, diodeHit->GetEdep());
+    analysisManager->FillH1(1, annularHit->GetEdep());
+
+    analysisManager->FillH1(2, diodeHit->GetTrackLength());
+    analysisManager->FillH1(3, annularHit->GetTrackLength());
+
+    // fill ntuple, not open in an internal scan
+    if ( ( ! fColumnarWriter || fColumnarWriter->IsNtupleEnabled() )
+         && ! progress->IsInternalScan() ) {
+      analysisManager->FillNtupleDColumn(0, diodeHit->GetEdep());
+      analysisManager->FillNtupleDColumn(1, annularHit->GetEdep());
+
+      analysisManager->FillNtupleDColumn(2, diodeHit->GetTrackLength());
+      analysisManager->FillNtupleDColumn(3, annularHit->GetTrackLength());
+
+      analysisManager->AddNtupleRow();
+    }
+
+    // energy budget per volume
+    for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+      analysisManager->FillH1(fBudgetH1ID+i, energyBudget.GetEdep(i));
+    }
+
+    // partial depositor: a hit in the diode without the full primary energy
+    auto primaryEnergy = event->GetPrimaryVertex(primary)->GetPrimary()->GetKineticEnergy();
+    auto diodeEdep = diodeHit->GetEdep();
+    G4bool partialDepositor = ( diodeEdep > 0. && diodeEdep < primaryEnergy - 1.*eV );
+
+    // columnar output
+    if ( fColumnarWriter && fColumnarWriter->IsEnabled() ) {
+      fColumnarWriter->Fill({ diodeEdep, annularHit->GetEdep(),
+                              diodeHit->GetTrackLength(), annularHit->GetTrackLength(),
+                              primaryEnergy });
+    }
+
+    run->AddBudget(energyBudget, partialDepositor);
+
+    // detection counters
+    G4bool diodeDetected = ( diodeEdep > 0. );
+    G4bool annularDetected = ( annularHit->GetEdep() > 0. );
+    run->AddDetection(diodeEdep, annularHit->GetEdep());
+    auto primaryIndex = B4::PrimaryGeneratorAction::GetPrimaryIndex(event, primary);
+    if ( fAcceptanceMap && fAcceptanceMap->IsEnabled() ) {
+      fAcceptanceMap->EndOfEvent(primary, primaryIndex, diodeEdep, annularHit->GetEdep(), run);
+    }
+    else if ( fQuasiRandom && fQuasiRandom->IsEnabled() ) {
+      auto replica = fQuasiRandom->GetReplica(primaryIndex);
+      run->AddReplica(replica, diodeDetected, annularDetected);
+    }
+
+    // digitised spectra
+    fResponse.Add(diodeEdep, annularHit->GetEdep());
+
+    progress->AddEvent(*fProgressSlot, diodeDetected, annularDetected, fNofSteps[primary]);
+  }
 
-  // fill histograms
-  analysisManager->FillH1(0, diodeHit->GetEdep());
-  analysisManager->FillH1(1, annularHit->GetEdep());
-
-  analysisManager->FillH1(2, diodeHit->GetTrackLength());
-  analysisManager->FillH1(3, annularHit->GetTrackLength());
-
-  // fill ntuple
-  analysisManager->FillNtupleDColumn(0, diodeHit->GetEdep());
-  analysisManager->FillNtupleDColumn(1, annularHit->GetEdep());
-
-  analysisManager->FillNtupleDColumn(2, diodeHit->GetTrackLength());
-  analysisManager->FillNtupleDColumn(3, annularHit->GetTrackLength());
+  if ( fCheckpoint ) fCheckpoint->EndOfEvent(event);
 
-  analysisManager->AddNtupleRow();
+  // sequential stopping on the merged counters
+  if ( fStopping.Check(progress) ) {
+    G4RunManager::GetRunManager()->AbortRun(true);
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
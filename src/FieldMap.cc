@@ -0,0 +1,404 @@
+/// \file FieldMap.cc
+/// \brief Implementation of the B4c::FieldMap class
+
+#include "FieldMap.hh"
+
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "geomdefs.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace B4c
+{
+
+namespace
+{
+constexpr char kMagic[8] = { 'B', '4', 'F', 'M', 'A', 'P', '\0', '\0' };
+
+// the straightforward implementation, for the benchmark: a flat array of
+// points, with the index computed and the 24 values loaded at each query
+class NaiveFieldMap
+{
+  public:
+    NaiveFieldMap(const std::array<G4int, 3>& nofPoints, const G4ThreeVector& origin,
+                  const G4ThreeVector& spacing, const std::vector<float>& field)
+      : fNofPoints(nofPoints), fOrigin(origin), fSpacing(spacing),
+        fField(field.begin(), field.end()) {}
+
+    void GetFieldValue(const G4double point[4], G4double* field) const
+    {
+      field[0] = field[1] = field[2] = 0.;
+      G4int cell[3];
+      G4double f[3];
+      for ( G4int axis=0; axis<3; ++axis ) {
+        auto u = (point[axis] - fOrigin[axis])/fSpacing[axis];
+        if ( ! (u >= 0.) || u > fNofPoints[axis]-1 ) return;
+        cell[axis] = std::min(G4int(u), fNofPoints[axis]-2);
+        f[axis] = u - cell[axis];
+      }
+      for ( G4int c=0; c<3; ++c ) {
+        G4double value = 0.;
+        for ( G4int corner=0; corner<8; ++corner ) {
+          G4int dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+          auto index = ((std::size_t(cell[2]+dz)*fNofPoints[1] + cell[1]+dy)*fNofPoints[0]
+                        + cell[0]+dx)*3 + c;
+          value += fField[index]*(dx ? f[0] : 1.-f[0])*(dy ? f[1] : 1.-f[1])
+                                 *(dz ? f[2] : 1.-f[2]);
+        }
+        field[c] = value*tesla;
+      }
+    }
+
+  private:
+    std::array<G4int, 3> fNofPoints;
+    G4ThreeVector fOrigin;
+    G4ThreeVector fSpacing;
+    std::vector<G4double> fField;
+};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+FieldMap::FieldMap(const G4String& fileName)
+  : fGrid(GetGrid(fileName))
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::shared_ptr<const FieldMap::Grid> FieldMap::GetGrid(const G4String& fileName)
+{
+  // read by the first thread, kept for the job
+  static std::mutex mutex;
+  static std::map<G4String, std::shared_ptr<const Grid>> grids;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& grid = grids[fileName];
+  if ( ! grid ) {
+    std::vector<float> field;
+    grid = Read(fileName, field);
+    if ( grid ) {
+      G4cout << "--> Field map " << fileName << ": " << grid->nofPoints[0] << " x "
+             << grid->nofPoints[1] << " x " << grid->nofPoints[2] << " points" << G4endl;
+    }
+  }
+  return grid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::shared_ptr<FieldMap::Grid> FieldMap::Read(const G4String& fileName,
+                                               std::vector<float>& field)
+{
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  FileHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  std::array<G4int, 3> nofPoints{};
+  G4bool valid = file && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+                 && header.version == kVersion && header.byteOrder == kByteOrder;
+  std::size_t size = 3;
+  for ( G4int axis=0; valid && axis<3; ++axis ) {
+    nofPoints[axis] = G4int(header.nofPoints[axis]);
+    valid = ( nofPoints[axis] >= 2 && header.spacing[axis] > 0. );
+    size *= header.nofPoints[axis];
+  }
+  if ( valid ) {
+    field.resize(size);
+    file.read(reinterpret_cast<char*>(field.data()), size*sizeof(float));
+    valid = bool(file);
+  }
+
+  if ( ! valid ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot read the field map " << fileName << "; there is no field.";
+    G4Exception("FieldMap::Read()", "MyCode0018", JustWarning, msg);
+    return nullptr;
+  }
+
+  G4ThreeVector origin(header.origin[0]*mm, header.origin[1]*mm, header.origin[2]*mm);
+  G4ThreeVector spacing(header.spacing[0]*mm, header.spacing[1]*mm, header.spacing[2]*mm);
+  return Build(nofPoints, origin, spacing, field);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::shared_ptr<FieldMap::Grid> FieldMap::Build(const std::array<G4int, 3>& nofPoints,
+                                                const G4ThreeVector& origin,
+                                                const G4ThreeVector& spacing,
+                                                const std::vector<float>& field)
+{
+  auto grid = std::make_shared<Grid>();
+  grid->nofPoints = nofPoints;
+  grid->origin = origin;
+  grid->spacing = spacing;
+  for ( G4int axis=0; axis<3; ++axis ) {
+    grid->invSpacing[axis] = 1./spacing[axis];
+    grid->nofBricks[axis] = (nofPoints[axis] - 1 + kBrickCells - 1)/kBrickCells;
+  }
+
+  const auto& nb = grid->nofBricks;
+  const std::size_t pointsPerBrick = kBrickPoints*kBrickPoints*kBrickPoints;
+  grid->bricks.resize(std::size_t(nb[0])*nb[1]*nb[2]*pointsPerBrick);
+
+  // the points beyond the last one of an axis repeat it; they are never
+  // interpolated
+  auto point = grid->bricks.begin();
+  for ( G4int bz=0; bz<nb[2]; ++bz ) {
+    for ( G4int by=0; by<nb[1]; ++by ) {
+      for ( G4int bx=0; bx<nb[0]; ++bx ) {
+        for ( G4int lz=0; lz<kBrickPoints; ++lz ) {
+          auto k = std::min(bz*kBrickCells + lz, nofPoints[2]-1);
+          for ( G4int ly=0; ly<kBrickPoints; ++ly ) {
+            auto j = std::min(by*kBrickCells + ly, nofPoints[1]-1);
+            for ( G4int lx=0; lx<kBrickPoints; ++lx, ++point ) {
+              auto i = std::min(bx*kBrickCells + lx, nofPoints[0]-1);
+              auto index = ((std::size_t(k)*nofPoints[1] + j)*nofPoints[0] + i)*3;
+              point->b[0] = field[index];
+              point->b[1] = field[index+1];
+              point->b[2] = field[index+2];
+              point->b[3] = 0.f;
+            }
+          }
+        }
+      }
+    }
+  }
+  return grid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::shared_ptr<FieldMap::Grid> FieldMap::MakeTestGrid(std::vector<float>& field)
+{
+  // a dipole-like field over the world: 1 T along y near the axis, with
+  // small transverse and longitudinal components
+  const std::array<G4int, 3> nofPoints = { 64, 64, 64 };
+  const G4ThreeVector origin(-75.*mm, -75.*mm, -75.*mm);
+  const G4ThreeVector spacing(150.*mm/63, 150.*mm/63, 150.*mm/63);
+
+  field.resize(3*std::size_t(nofPoints[0])*nofPoints[1]*nofPoints[2]);
+  auto value = field.begin();
+  for ( G4int k=0; k<nofPoints[2]; ++k ) {
+    auto z = origin.z() + k*spacing.z();
+    for ( G4int j=0; j<nofPoints[1]; ++j ) {
+      auto y = origin.y() + j*spacing.y();
+      for ( G4int i=0; i<nofPoints[0]; ++i ) {
+        auto x = origin.x() + i*spacing.x();
+        auto r2 = (x*x + z*z)/(30.*mm*30.*mm);
+        *value++ = float(0.1*std::sin(z/(20.*mm))*std::exp(-0.5*r2));
+        *value++ = float(std::exp(-0.5*r2)*(1. - 0.2*y*y/(75.*mm*75.*mm)));
+        *value++ = float(0.05*x/(75.*mm));
+      }
+    }
+  }
+  return Build(nofPoints, origin, spacing, field);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool FieldMap::WriteTestMap(const G4String& fileName)
+{
+  std::vector<float> field;
+  auto grid = MakeTestGrid(field);
+
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.byteOrder = kByteOrder;
+  for ( G4int axis=0; axis<3; ++axis ) {
+    header.nofPoints[axis] = std::uint32_t(grid->nofPoints[axis]);
+    header.origin[axis] = grid->origin[axis]/mm;
+    header.spacing[axis] = grid->spacing[axis]/mm;
+  }
+
+  std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(field.data()), field.size()*sizeof(float));
+  if ( ! file ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the field map " << fileName;
+    G4Exception("FieldMap::WriteTestMap()", "MyCode0018", JustWarning, msg);
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FieldMap::Interpolate(const Point* corner, G4double fx, G4double fy, G4double fz,
+                           G4double* field)
+{
+  // corners of the cell in the brick
+  constexpr G4int dx = 1, dy = kBrickPoints, dz = kBrickPoints*kBrickPoints;
+
+#if defined(__SSE__)
+  auto lerp = [](__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+  };
+  auto tx = _mm_set1_ps(float(fx));
+  auto ty = _mm_set1_ps(float(fy));
+  auto tz = _mm_set1_ps(float(fz));
+  auto c00 = lerp(_mm_load_ps(corner[0].b),       _mm_load_ps(corner[dx].b),       tx);
+  auto c10 = lerp(_mm_load_ps(corner[dy].b),      _mm_load_ps(corner[dy+dx].b),    tx);
+  auto c01 = lerp(_mm_load_ps(corner[dz].b),      _mm_load_ps(corner[dz+dx].b),    tx);
+  auto c11 = lerp(_mm_load_ps(corner[dz+dy].b),   _mm_load_ps(corner[dz+dy+dx].b), tx);
+  auto c = lerp(lerp(c00, c10, ty), lerp(c01, c11, ty), tz);
+
+  alignas(16) float b[4];
+  _mm_store_ps(b, c);
+#else
+  auto lerp = [](G4double a, G4double b, G4double t) { return a + t*(b - a); };
+  G4double b[3];
+  for ( G4int i=0; i<3; ++i ) {
+    auto c00 = lerp(corner[0].b[i],     corner[dx].b[i],       fx);
+    auto c10 = lerp(corner[dy].b[i],    corner[dy+dx].b[i],    fx);
+    auto c01 = lerp(corner[dz].b[i],    corner[dz+dx].b[i],    fx);
+    auto c11 = lerp(corner[dz+dy].b[i], corner[dz+dy+dx].b[i], fx);
+    b[i] = lerp(lerp(c00, c10, fy), lerp(c01, c11, fy), fz);
+  }
+#endif
+
+  field[0] = b[0]*tesla;
+  field[1] = b[1]*tesla;
+  field[2] = b[2]*tesla;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FieldMap::Evaluate(const G4double point[4], G4double* field, G4bool useCache) const
+{
+  field[0] = field[1] = field[2] = 0.;
+  if ( ! fGrid ) return;
+  const auto& grid = *fGrid;
+
+  std::array<G4int, 3> cell;
+  G4double f[3];
+  for ( G4int axis=0; axis<3; ++axis ) {
+    auto u = (point[axis] - grid.origin[axis])*grid.invSpacing[axis];
+    if ( ! (u >= 0.) || u > grid.nofPoints[axis]-1 ) return;
+    cell[axis] = std::min(G4int(u), grid.nofPoints[axis]-2);
+    f[axis] = u - cell[axis];
+  }
+
+  const Point* corner = nullptr;
+  if ( useCache && cell == fCache.cell ) {
+    corner = fCache.corner;
+  }
+  else {
+    const auto& nb = grid.nofBricks;
+    std::size_t brick = (std::size_t(cell[2]/kBrickCells)*nb[1] + cell[1]/kBrickCells)*nb[0]
+                      + cell[0]/kBrickCells;
+    G4int local = ((cell[2] % kBrickCells)*kBrickPoints + cell[1] % kBrickCells)*kBrickPoints
+                + cell[0] % kBrickCells;
+    corner = &grid.bricks[brick*kBrickPoints*kBrickPoints*kBrickPoints + local];
+    if ( useCache ) {
+      fCache.cell = cell;
+      fCache.corner = corner;
+    }
+  }
+
+  Interpolate(corner, f[0], f[1], f[2], field);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FieldMap::Benchmark(const G4String& fileName, G4int nofPoints)
+{
+  std::vector<float> values;
+  auto grid = fileName.empty() ? MakeTestGrid(values) : Read(fileName, values);
+  if ( ! grid ) return;
+
+  NaiveFieldMap naive(grid->nofPoints, grid->origin, grid->spacing, values);
+  FieldMap field(grid);
+
+  // the queries follow straight tracks through the grid, in steps of a
+  // fifth of a cell, as a stepper does
+  G4ThreeVector pMin = grid->origin, pMax;
+  G4double stepLength = kInfinity;
+  for ( G4int axis=0; axis<3; ++axis ) {
+    pMax[axis] = pMin[axis] + (grid->nofPoints[axis]-1)*grid->spacing[axis];
+    stepLength = std::min(stepLength, 0.2*grid->spacing[axis]);
+  }
+  auto inside = [&](const G4ThreeVector& p) {
+    return p.x() >= pMin.x() && p.x() <= pMax.x() && p.y() >= pMin.y() && p.y() <= pMax.y()
+        && p.z() >= pMin.z() && p.z() <= pMax.z();
+  };
+
+  std::mt19937_64 engine(12345);
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  std::vector<std::array<G4double, 4>> queries(nofPoints);
+  G4ThreeVector position, direction;
+  for ( G4int i=0; i<nofPoints; ++i ) {
+    if ( i % 200 == 0 || ! inside(position) ) {
+      for ( G4int axis=0; axis<3; ++axis ) {
+        position[axis] = pMin[axis] + uniform(engine)*(pMax[axis] - pMin[axis]);
+      }
+      auto cosTheta = 2.*uniform(engine) - 1.;
+      auto phi = twopi*uniform(engine);
+      auto sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+      direction.set(sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta);
+    }
+    queries[i] = { position.x(), position.y(), position.z(), 0. };
+    position += stepLength*direction;
+  }
+
+  // a warm-up pass, then a timed one; the sum keeps the evaluations
+  auto time = [&](auto&& evaluate) {
+    G4double sum = 0., b[3];
+    for ( const auto& query : queries ) { evaluate(query.data(), b); sum += b[1]; }
+    auto start = std::chrono::steady_clock::now();
+    for ( const auto& query : queries ) { evaluate(query.data(), b); sum += b[1]; }
+    std::chrono::duration<G4double> elapsed = std::chrono::steady_clock::now() - start;
+    return std::make_pair(nofPoints/elapsed.count(), sum);
+  };
+
+  auto naiveRate = time([&](const G4double* p, G4double* b) { naive.GetFieldValue(p, b); });
+  auto brickRate = time([&](const G4double* p, G4double* b) { field.Evaluate(p, b, false); });
+  auto cacheRate = time([&](const G4double* p, G4double* b) { field.Evaluate(p, b, true); });
+  volatile G4double sink = naiveRate.second + brickRate.second + cacheRate.second;
+  (void)sink;
+
+  // the floats of the map against the doubles of the naive implementation
+  G4double maxDifference = 0., maxField = 0.;
+  for ( const auto& query : queries ) {
+    G4double b0[3], b1[3];
+    naive.GetFieldValue(query.data(), b0);
+    field.Evaluate(query.data(), b1, true);
+    for ( G4int c=0; c<3; ++c ) {
+      maxDifference = std::max(maxDifference, std::abs(b1[c] - b0[c]));
+      maxField = std::max(maxField, std::abs(b0[c]));
+    }
+  }
+
+  G4cout << G4endl << " ----> field map benchmark: " << nofPoints << " queries along tracks, "
+         << grid->nofPoints[0] << " x " << grid->nofPoints[1] << " x " << grid->nofPoints[2]
+         << " points" << ( fileName.empty() ? " (test map)" : "" ) << G4endl;
+  char line[120];
+  std::snprintf(line, sizeof(line), "  %-18s %12.4g evaluations/s", "naive", naiveRate.first);
+  G4cout << line << G4endl;
+  std::snprintf(line, sizeof(line), "  %-18s %12.4g evaluations/s (x%.2f)", "bricked",
+                brickRate.first, brickRate.first/naiveRate.first);
+  G4cout << line << G4endl;
+  std::snprintf(line, sizeof(line), "  %-18s %12.4g evaluations/s (x%.2f)", "bricked, cached",
+                cacheRate.first, cacheRate.first/naiveRate.first);
+  G4cout << line << G4endl;
+  G4cout << "  max difference: " << maxDifference/tesla << " T (max field "
+         << maxField/tesla << " T)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,209 @@
+/// \file GeometryCache.cc
+/// \brief Implementation of the B4c::GeometryCache class
+
+#include "GeometryCache.hh"
+#include "GeometryHash.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+
+#ifdef B4_USE_GDML
+#include "G4GDMLParser.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4SolidStore.hh"
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace B4c
+{
+
+#ifdef B4_USE_GDML
+namespace
+{
+// GDML auxiliary information of the files
+const char* kParameterHash = "B4ParameterHash";
+const char* kGeometryHash = "B4GeometryHash";
+const char* kBuildTime = "B4BuildTime";
+}
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryCache::GeometryCache()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/gdml/", "GDML export and geometry cache");
+
+  fMessenger->DeclareProperty("prefix", fPrefix)
+    .SetGuidance("Prefix of the cache files, followed by the parameter hash and .gdml.")
+    .SetParameterName("prefix", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("export", &GeometryCache::Export)
+    .SetGuidance("Write the current geometry to a GDML file.")
+    .SetParameterName("fileName", false)
+    .SetToBeBroadcasted(false);
+}
+
+GeometryCache::~GeometryCache()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String GeometryCache::GetFileName(std::uint64_t parameterHash) const
+{
+  return fPrefix + GeometryHash::ToString(parameterHash) + ".gdml";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VPhysicalVolume* GeometryCache::Read(std::uint64_t parameterHash)
+{
+  fParameterHash = parameterHash;
+  fBuildTime = 0.;
+
+#ifdef B4_USE_GDML
+  if ( ! fEnabled ) return nullptr;
+
+  auto fileName = GetFileName(parameterHash);
+  if ( ! std::ifstream(fileName.c_str()).good() ) return nullptr;
+
+  auto start = std::chrono::steady_clock::now();
+  G4GDMLParser parser;
+  parser.SetOverlapCheck(false);
+  parser.Read(fileName, false);
+  auto world = parser.GetWorldVolume();
+  std::chrono::duration<G4double> elapsed = std::chrono::steady_clock::now() - start;
+  auto readTime = elapsed.count()*s;
+
+  G4String storedParameterHash, storedGeometryHash;
+  G4double buildTime = 0.;
+  for ( const auto& aux : *parser.GetAuxList() ) {
+    if      ( aux.type == kParameterHash ) storedParameterHash = aux.value;
+    else if ( aux.type == kGeometryHash ) storedGeometryHash = aux.value;
+    else if ( aux.type == kBuildTime ) buildTime = std::atof(aux.value.c_str())*ms;
+  }
+
+  if ( ! world || storedParameterHash != GeometryHash::ToString(parameterHash) ) {
+    // the builder starts from empty stores
+    G4PhysicalVolumeStore::Clean();
+    G4LogicalVolumeStore::Clean();
+    G4SolidStore::Clean();
+    G4ExceptionDescription msg;
+    msg << fileName << " is not the cached geometry of the layout; it is rebuilt.";
+    G4Exception("GeometryCache::Read()", "MyCode0016", JustWarning, msg);
+    return nullptr;
+  }
+  fBuildTime = buildTime;
+
+  auto geometryHash = GeometryHash::ToString(GeometryHash::Compute(world));
+  G4cout << G4endl << " ----> geometry read from " << fileName << " in " << readTime/ms
+         << " ms (hash " << geometryHash << ")";
+  if ( buildTime > 0. ) {
+    G4cout << "; the builder took " << buildTime/ms << " ms: "
+           << (buildTime - readTime)/ms << " ms saved";
+  }
+  G4cout << G4endl;
+
+  if ( geometryHash != storedGeometryHash ) {
+    G4ExceptionDescription msg;
+    msg << "The geometry read from " << fileName << " has the hash " << geometryHash
+        << ", the exported geometry " << storedGeometryHash << "." << G4endl
+        << "The files derived from the exported geometry will not be recognised.";
+    G4Exception("GeometryCache::Read()", "MyCode0016", JustWarning, msg);
+  }
+  return world;
+#else
+  return nullptr;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryCache::Built(const G4VPhysicalVolume* world, std::uint64_t parameterHash,
+                          G4double buildTime, G4bool overlaps)
+{
+  fParameterHash = parameterHash;
+  fBuildTime = buildTime;
+
+#ifdef B4_USE_GDML
+  // a layout with overlaps is rebuilt, so that they are reported again
+  if ( ! fEnabled || overlaps ) return;
+
+  auto fileName = GetFileName(parameterHash);
+  if ( Write(fileName, world) ) {
+    G4cout << G4endl << " ----> geometry built in " << buildTime/ms << " ms, cached in "
+           << fileName << G4endl;
+  }
+#else
+  (void)world;
+  (void)overlaps;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryCache::Export(const G4String& fileName)
+{
+  auto world = G4TransportationManager::GetTransportationManager()
+                 ->GetNavigatorForTracking()->GetWorldVolume();
+  if ( ! world ) {
+    G4ExceptionDescription msg;
+    msg << "There is no geometry to export; /run/initialize first.";
+    G4Exception("GeometryCache::Export()", "MyCode0016", JustWarning, msg);
+    return;
+  }
+
+  if ( Write(fileName, world) ) {
+    G4cout << G4endl << " ----> geometry exported to " << fileName << " (hash "
+           << GeometryHash::ToString(GeometryHash::Compute(world)) << ")" << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool GeometryCache::Write(const G4String& fileName, const G4VPhysicalVolume* world) const
+{
+#ifdef B4_USE_GDML
+  G4GDMLParser parser;
+  parser.AddAuxiliary({ kParameterHash, GeometryHash::ToString(fParameterHash), "", nullptr });
+  parser.AddAuxiliary({ kGeometryHash, GeometryHash::ToString(GeometryHash::Compute(world)),
+                        "", nullptr });
+  parser.AddAuxiliary({ kBuildTime, std::to_string(fBuildTime/ms), "ms", nullptr });
+
+  // write to a temporary file, then rename, so that a concurrent process
+  // never reads a partial file; the names are written with the addresses of
+  // the objects, which the reader strips
+  auto tmpName = fileName + ".tmp.gdml";
+  parser.SetOutputFileOverwrite(true);
+  parser.Write(tmpName, world, true);
+
+  if ( std::rename(tmpName.c_str(), fileName.c_str()) != 0 ) {
+    std::remove(tmpName.c_str());
+    G4ExceptionDescription msg;
+    msg << "Cannot write the geometry to " << fileName;
+    G4Exception("GeometryCache::Write()", "MyCode0016", JustWarning, msg);
+    return false;
+  }
+  return true;
+#else
+  (void)world;
+  G4ExceptionDescription msg;
+  msg << "Cannot write " << fileName << ": the application is built without GDML.";
+  G4Exception("GeometryCache::Write()", "MyCode0016", JustWarning, msg);
+  return false;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,97 @@
+/// \file GeometryHash.cc
+/// \brief Implementation of the B4c::GeometryHash class
+
+#include "GeometryHash.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+
+#include <iomanip>
+#include <sstream>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t GeometryHash::Compute()
+{
+  return Compute(G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t GeometryHash::Compute(const G4VPhysicalVolume* world)
+{
+  if ( ! world ) return 0;
+
+  std::uint64_t hash = 0xcbf29ce484222325ULL;   // FNV offset basis
+  Add(hash, world);
+  return hash;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t GeometryHash::Compute(const std::string& data)
+{
+  std::uint64_t hash = 0xcbf29ce484222325ULL;   // FNV offset basis
+  Add(hash, data);
+  return hash;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string GeometryHash::ToString(std::uint64_t hash)
+{
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryHash::Add(std::uint64_t& hash, const std::string& data)
+{
+  for ( unsigned char c : data ) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;                    // FNV prime
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryHash::Add(std::uint64_t& hash, const G4VPhysicalVolume* volume)
+{
+  auto logicalVolume = volume->GetLogicalVolume();
+  auto material = logicalVolume->GetMaterial();
+
+  // the values are printed with a fixed precision, so that the hash does
+  // not depend on the last bits of computed placements
+  std::ostringstream os;
+  os << std::setprecision(9)
+     << volume->GetName() << ' ' << volume->GetCopyNo() << ' ' << volume->GetTranslation();
+  auto rotation = volume->GetRotation();
+  if ( rotation && ! rotation->isIdentity() ) {
+    os << ' ' << rotation->xx() << ' ' << rotation->xy() << ' ' << rotation->xz()
+       << ' ' << rotation->yx() << ' ' << rotation->yy() << ' ' << rotation->yz()
+       << ' ' << rotation->zx() << ' ' << rotation->zy() << ' ' << rotation->zz();
+  }
+  os << ' ' << logicalVolume->GetName();
+  if ( material ) os << ' ' << material->GetName() << ' ' << material->GetDensity();
+  os << '\n';
+  logicalVolume->GetSolid()->StreamInfo(os);
+  Add(hash, os.str());
+
+  for ( std::size_t i=0; i<logicalVolume->GetNoDaughters(); ++i ) {
+    Add(hash, logicalVolume->GetDaughter(i));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,269 @@
+/// \file GeometryValidator.cc
+/// \brief Implementation of the B4c::GeometryValidator class
+
+#include "GeometryValidator.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4Navigator.hh"
+#include "G4RunManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4UImanager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4SystemOfUnits.hh"
+#include "geomdefs.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+namespace B4c
+{
+
+namespace
+{
+const char* BuildName(G4bool flat) { return flat ? "flat" : "nested"; }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryValidator::GeometryValidator()
+  : fTolerance(1.*nm)
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/validator/", "Geometry build validation");
+
+  fMessenger->DeclareProperty("rays", fNofRays)
+    .SetGuidance("Number of random rays.")
+    .SetParameterName("rays", false)
+    .SetRange("rays>0")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("seed", fSeed)
+    .SetGuidance("Seed of the rays.")
+    .SetParameterName("seed", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclarePropertyWithUnit("tolerance", "mm", fTolerance)
+    .SetGuidance("Tolerance on the segment lengths.")
+    .SetParameterName("tolerance", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("fileName", fFileName)
+    .SetGuidance("File to which the benchmark results are appended.")
+    .SetParameterName("fileName", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("run", &GeometryValidator::Validate)
+    .SetGuidance("Check that the nested and flat builds have the same materials")
+    .SetGuidance("along the rays.")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("benchmark", &GeometryValidator::Benchmark)
+    .SetGuidance("Time the navigation of the rays in the nested and flat builds.")
+    .SetToBeBroadcasted(false);
+}
+
+GeometryValidator::~GeometryValidator()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool GeometryValidator::Build(G4bool flat) const
+{
+  auto runManager = G4RunManager::GetRunManager();
+  auto detector = static_cast<const DetectorConstruction*>(runManager->GetUserDetectorConstruction());
+
+  if ( detector->IsFlat() != flat ) {
+    G4UImanager::GetUIpointer()->ApplyCommand(G4String("/B4/geometry/flat ") + ( flat ? "true" : "false" ));
+    // an empty run builds the geometry
+    runManager->BeamOn(0);
+  }
+
+  return G4TransportationManager::GetTransportationManager()
+           ->GetNavigatorForTracking()->GetWorldVolume() != nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryValidator::GenerateRays()
+{
+  // the rays start in the world and aim at its central half, where the
+  // array is
+  auto world = G4TransportationManager::GetTransportationManager()
+                 ->GetNavigatorForTracking()->GetWorldVolume();
+  G4ThreeVector pMin, pMax;
+  world->GetLogicalVolume()->GetSolid()->BoundingLimits(pMin, pMax);
+
+  std::mt19937_64 engine(fSeed);
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  auto sample = [&](G4double scale) {
+    G4ThreeVector point;
+    for ( G4int axis=0; axis<3; ++axis ) {
+      auto centre = 0.5*(pMin[axis] + pMax[axis]);
+      auto halfLength = 0.5*(pMax[axis] - pMin[axis]);
+      point[axis] = centre + scale*halfLength*(2.*uniform(engine) - 1.);
+    }
+    return point;
+  };
+
+  fOrigins.resize(fNofRays);
+  fDirections.resize(fNofRays);
+  for ( G4int i=0; i<fNofRays; ++i ) {
+    G4ThreeVector direction;
+    do {
+      fOrigins[i] = sample(0.999);
+      direction = sample(0.5) - fOrigins[i];
+    } while ( direction.mag2() == 0. );
+    fDirections[i] = direction.unit();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4long GeometryValidator::Trace(std::vector<Path>* paths) const
+{
+  G4Navigator navigator;
+  navigator.SetWorldVolume(G4TransportationManager::GetTransportationManager()
+                             ->GetNavigatorForTracking()->GetWorldVolume());
+
+  if ( paths ) paths->assign(fNofRays, Path());
+
+  G4long nofSteps = 0;
+  for ( G4int i=0; i<fNofRays; ++i ) {
+    auto point = fOrigins[i];
+    const auto& direction = fDirections[i];
+
+    auto volume = navigator.LocateGlobalPointAndSetup(point, &direction, false, false);
+    for ( G4int step=0; volume && step<kMaxSteps; ++step ) {
+      G4double safety = 0.;
+      auto length = navigator.ComputeStep(point, direction, kInfinity, safety);
+      if ( length >= kInfinity ) break;
+      ++nofSteps;
+
+      if ( paths ) {
+        // adjacent segments of the same material are merged
+        auto material = volume->GetLogicalVolume()->GetMaterial();
+        auto& path = (*paths)[i];
+        if ( ! path.empty() && path.back().material == material ) {
+          path.back().length += length;
+        }
+        else if ( length > fTolerance ) {
+          path.push_back({ material, length });
+        }
+      }
+
+      point += length*direction;
+      navigator.SetGeometricallyLimitedStep();
+      volume = navigator.LocateGlobalPointAndSetup(point, &direction, true);
+    }
+  }
+  return nofSteps;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryValidator::Validate()
+{
+  auto detector = static_cast<const DetectorConstruction*>(
+    G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  G4bool initialFlat = detector->IsFlat();
+
+  std::vector<Path> paths[2];
+  for ( G4bool flat : { false, true } ) {
+    if ( ! Build(flat) ) return;
+    if ( ! flat ) GenerateRays();
+    Trace(&paths[flat]);
+  }
+  Build(initialFlat);
+
+  G4int nofDifferent = 0;
+  G4double maxDifference = 0.;
+  G4long nofSegments = 0;
+  for ( G4int i=0; i<fNofRays; ++i ) {
+    const auto& nested = paths[0][i];
+    const auto& flat = paths[1][i];
+    nofSegments += nested.size();
+
+    G4bool same = ( nested.size() == flat.size() );
+    for ( std::size_t j=0; same && j<nested.size(); ++j ) {
+      auto difference = std::abs(nested[j].length - flat[j].length);
+      maxDifference = std::max(maxDifference, difference);
+      same = ( nested[j].material == flat[j].material && difference <= fTolerance );
+    }
+    if ( same ) continue;
+
+    if ( nofDifferent++ < 5 ) {
+      G4cout << " ray " << i << " from " << fOrigins[i]/mm << " mm along " << fDirections[i]
+             << ": " << nested.size() << " segments (nested), "
+             << flat.size() << " (flat)" << G4endl;
+    }
+  }
+
+  G4cout << G4endl << " ----> geometry validation: " << fNofRays << " rays, "
+         << nofSegments << " material segments" << G4endl;
+  if ( nofDifferent == 0 ) {
+    G4cout << " the nested and flat builds have the same materials along all the rays"
+           << " (max length difference " << maxDifference/nm << " nm)" << G4endl;
+  }
+  else {
+    G4ExceptionDescription msg;
+    msg << nofDifferent << " of " << fNofRays << " rays cross different materials"
+        << " in the nested and flat builds.";
+    G4Exception("GeometryValidator::Validate()", "MyCode0015", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryValidator::Benchmark()
+{
+  auto detector = static_cast<const DetectorConstruction*>(
+    G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  G4bool initialFlat = detector->IsFlat();
+
+  std::ofstream file(fFileName.c_str(), std::ios::app);
+  file << "# build rays steps time(s) ns/step steps/s" << G4endl;
+
+  G4cout << G4endl << " ----> navigation benchmark: " << fNofRays << " rays" << G4endl;
+  G4double nsPerStep[2] = { 0., 0. };
+  G4double totalSeconds[2] = { 0., 0. };
+  for ( G4bool flat : { false, true } ) {
+    if ( ! Build(flat) ) return;
+    if ( ! flat ) GenerateRays();
+
+    // a first pass warms up the caches
+    Trace(nullptr);
+    auto start = std::chrono::steady_clock::now();
+    auto nofSteps = Trace(nullptr);
+    std::chrono::duration<G4double> elapsed = std::chrono::steady_clock::now() - start;
+
+    auto seconds = elapsed.count();
+    totalSeconds[flat] = seconds;
+    nsPerStep[flat] = ( nofSteps > 0 ) ? 1e9*seconds/nofSteps : 0.;
+    auto stepsPerSecond = ( seconds > 0. ) ? nofSteps/seconds : 0.;
+
+    G4cout << " " << std::setw(6) << BuildName(flat) << ": " << nofSteps << " steps, "
+           << nsPerStep[flat] << " ns/step, " << stepsPerSecond << " steps/s" << G4endl;
+    file << BuildName(flat) << " " << fNofRays << " " << nofSteps << " " << seconds
+         << " " << nsPerStep[flat] << " " << stepsPerSecond << G4endl;
+  }
+  Build(initialFlat);
+
+  // the flat build has fewer steps, and should have cheaper ones
+  if ( nsPerStep[1] > 0. ) {
+    G4cout << " nested/flat: time per step " << nsPerStep[0]/nsPerStep[1]
+           << ", total time " << totalSeconds[0]/totalSeconds[1] << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,367 @@
+/// \file LayoutOptimiser.cc
+/// \brief Implementation of the B4c::LayoutOptimiser class
+
+#include "LayoutOptimiser.hh"
+#include "DetectorConstruction.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RunProgress.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4UImanager.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace B4c
+{
+
+namespace
+{
+const char* kNames[] = { "angle", "aperture", "detectZdist", "anDetectZdist", "anInnerRadius" };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LayoutOptimiser::LayoutOptimiser()
+{
+  fPositions.push_back(5.*mm);
+
+  fMessenger = new G4GenericMessenger(this, "/B4/optimiser/", "Array layout optimiser");
+
+  fMessenger->DeclareMethod("range", &LayoutOptimiser::SetRange)
+    .SetGuidance("Range of a layout parameter: name min max")
+    .SetGuidance("  angle (deg), aperture, detectZdist, anDetectZdist, anInnerRadius (mm)")
+    .SetGuidance("The parameters without range keep their current value.")
+    .SetParameterName("range", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("positions", &LayoutOptimiser::SetPositions)
+    .SetGuidance("Source distances z, in mm: the source is at (0, 0, -z).")
+    .SetParameterName("positions", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("candidates", fNofCandidates)
+    .SetGuidance("Number of candidate layouts, including the current one.")
+    .SetParameterName("candidates", false)
+    .SetRange("candidates>=2")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("events", fNofEvents)
+    .SetGuidance("Events per candidate and position in the first round;")
+    .SetGuidance("they double in each following round.")
+    .SetParameterName("events", false)
+    .SetRange("events>0")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("seed", fSeed)
+    .SetGuidance("Seed of the candidate sample.")
+    .SetParameterName("seed", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("fileName", fFileName)
+    .SetGuidance("File to which the rounds are appended.")
+    .SetParameterName("fileName", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("run", &LayoutOptimiser::Optimise)
+    .SetGuidance("Search the layout of maximum collective efficiency.")
+    .SetGuidance("The geometry and the gun position are changed.")
+    .SetToBeBroadcasted(false);
+}
+
+LayoutOptimiser::~LayoutOptimiser()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double LayoutOptimiser::GetUnit(G4int parameter)
+{
+  return ( parameter == kAngle ) ? deg : mm;
+}
+
+const char* LayoutOptimiser::GetUnitName(G4int parameter)
+{
+  return ( parameter == kAngle ) ? "deg" : "mm";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double LayoutOptimiser::Candidate::GetEfficiency() const
+{
+  // mean over the positions
+  G4double sum = 0.;
+  for ( std::size_t i=0; i<nofEvents.size(); ++i ) {
+    if ( nofEvents[i] > 0 ) sum += G4double(nofDetected[i])/nofEvents[i];
+  }
+  return nofEvents.empty() ? 0. : sum/nofEvents.size();
+}
+
+G4double LayoutOptimiser::Candidate::GetError() const
+{
+  G4double variance = 0.;
+  for ( std::size_t i=0; i<nofEvents.size(); ++i ) {
+    if ( nofEvents[i] == 0 ) continue;
+    auto efficiency = G4double(nofDetected[i])/nofEvents[i];
+    variance += efficiency*(1. - efficiency)/nofEvents[i];
+  }
+  return nofEvents.empty() ? 0. : std::sqrt(variance)/nofEvents.size();
+}
+
+G4long LayoutOptimiser::Candidate::GetNofEvents() const
+{
+  return std::accumulate(nofEvents.begin(), nofEvents.end(), G4long(0));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::SetRange(const G4String& value)
+{
+  std::istringstream is(value);
+  std::string name;
+  G4double min = 0., max = 0.;
+  is >> name >> min >> max;
+
+  auto parameter = G4int(std::find(std::begin(kNames), std::end(kNames), name) - std::begin(kNames));
+  if ( is.fail() || parameter == kNofParameters || max < min ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot parse the range \"" << value << "\"" << G4endl
+        << "Expected: name min max, name among angle, aperture, detectZdist,"
+        << " anDetectZdist, anInnerRadius";
+    G4Exception("LayoutOptimiser::SetRange()", "MyCode0014", JustWarning, msg);
+    return;
+  }
+
+  auto& range = fRanges[parameter];
+  range.active = ( max > min );
+  range.min = min*GetUnit(parameter);
+  range.max = max*GetUnit(parameter);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::SetPositions(const G4String& value)
+{
+  std::istringstream is(value);
+  std::vector<G4double> positions;
+  G4double z = 0.;
+  while ( is >> z ) positions.push_back(z*mm);
+
+  if ( positions.empty() || ! is.eof() ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot parse the positions \"" << value << "\"" << G4endl
+        << "Expected: z1 z2 ... (mm)";
+    G4Exception("LayoutOptimiser::SetPositions()", "MyCode0014", JustWarning, msg);
+    return;
+  }
+  fPositions = positions;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LayoutOptimiser::Values LayoutOptimiser::GetCurrentValues() const
+{
+  auto detector = static_cast<const DetectorConstruction*>(
+    G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+
+  Values values{};
+  values[kAngle] = detector->GetAngle();
+  values[kAperture] = detector->GetAperture();
+  values[kDetectZdist] = detector->GetDetectZdist();
+  values[kAnDetectZdist] = detector->GetAnDetectZdist();
+  values[kAnInnerRadius] = detector->GetAnInnerRadius();
+  return values;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<LayoutOptimiser::Candidate> LayoutOptimiser::Sample() const
+{
+  // the current layout, then a Latin hypercube sample: each range is cut in
+  // as many strata as candidates, and each stratum is used once
+  auto current = GetCurrentValues();
+  std::vector<Candidate> candidates(fNofCandidates);
+  for ( G4int i=0; i<fNofCandidates; ++i ) {
+    candidates[i].id = i;
+    candidates[i].values = current;
+  }
+
+  G4int nofSampled = fNofCandidates - 1;
+  std::mt19937_64 engine(fSeed);
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  std::vector<G4int> strata(nofSampled);
+  for ( G4int parameter=0; parameter<kNofParameters; ++parameter ) {
+    const auto& range = fRanges[parameter];
+    if ( ! range.active ) continue;
+
+    std::iota(strata.begin(), strata.end(), 0);
+    std::shuffle(strata.begin(), strata.end(), engine);
+    for ( G4int i=0; i<nofSampled; ++i ) {
+      auto u = (strata[i] + uniform(engine))/nofSampled;
+      candidates[i+1].values[parameter] = range.min + u*(range.max - range.min);
+    }
+  }
+  return candidates;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool LayoutOptimiser::Apply(const Values& values) const
+{
+  auto UImanager = G4UImanager::GetUIpointer();
+  for ( G4int parameter=0; parameter<kNofParameters; ++parameter ) {
+    std::ostringstream command;
+    command << std::setprecision(17) << "/B4/geometry/" << kNames[parameter] << " "
+            << values[parameter]/GetUnit(parameter) << " " << GetUnitName(parameter);
+    UImanager->ApplyCommand(command.str());
+  }
+
+  // an empty run builds the geometry, with the overlap check
+  auto runManager = G4RunManager::GetRunManager();
+  runManager->BeamOn(0);
+
+  auto detector = static_cast<const DetectorConstruction*>(
+    runManager->GetUserDetectorConstruction());
+  return ! detector->HasOverlaps();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::Evaluate(Candidate& candidate, G4int nofEvents)
+{
+  candidate.nofEvents.resize(fPositions.size(), 0);
+  candidate.nofDetected.resize(fPositions.size(), 0);
+
+  auto UImanager = G4UImanager::GetUIpointer();
+  fCurrent = &candidate;
+  for ( std::size_t i=0; i<fPositions.size(); ++i ) {
+    std::ostringstream position;
+    position << std::setprecision(17) << "/gun/position 0. 0. " << -fPositions[i]/mm << " mm";
+    UImanager->ApplyCommand(position.str());
+
+    fCurrentPosition = G4int(i);
+    RunProgress::Instance()->SetInternalScan(true);
+    G4RunManager::GetRunManager()->BeamOn(B4::PrimaryGeneratorAction::GetNofEvents(nofEvents));
+    RunProgress::Instance()->SetInternalScan(false);
+  }
+  fCurrent = nullptr;
+  fCurrentPosition = -1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::EndOfRun(const Run* run)
+{
+  if ( ! fCurrent ) return;
+
+  fCurrent->nofEvents[fCurrentPosition] += run->GetNumberOfEvent();
+  fCurrent->nofDetected[fCurrentPosition] += run->GetNofCollective();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::Print(std::ostream& os, G4int round, const Candidate& candidate,
+                            G4bool kept) const
+{
+  os << std::setw(5) << round << std::setw(5) << candidate.id;
+  for ( G4int parameter=0; parameter<kNofParameters; ++parameter ) {
+    os << std::setw(12) << std::setprecision(6) << candidate.values[parameter]/GetUnit(parameter);
+  }
+  os << std::setw(12) << candidate.GetNofEvents()
+     << std::setw(12) << std::setprecision(6) << candidate.GetEfficiency()
+     << std::setw(12) << std::setprecision(3) << candidate.GetError()
+     << std::setw(5) << ( kept ? 1 : 0 ) << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LayoutOptimiser::Optimise()
+{
+  if ( std::none_of(fRanges.begin(), fRanges.end(), [](const Range& r) { return r.active; }) ) {
+    G4ExceptionDescription msg;
+    msg << "Define the parameter ranges with /B4/optimiser/range.";
+    G4Exception("LayoutOptimiser::Optimise()", "MyCode0014", JustWarning, msg);
+    return;
+  }
+
+  auto candidates = Sample();
+  std::vector<Candidate*> remaining;
+  for ( auto& candidate : candidates ) remaining.push_back(&candidate);
+
+  std::ofstream file(fFileName.c_str(), std::ios::app);
+  file << "# round candidate";
+  for ( G4int parameter=0; parameter<kNofParameters; ++parameter ) {
+    file << " " << kNames[parameter] << "(" << GetUnitName(parameter) << ")";
+  }
+  file << " events efficiency error kept" << G4endl;
+
+  G4int nofEvents = fNofEvents;
+  for ( G4int round=0; ! remaining.empty(); ++round ) {
+    G4cout << "--> Layout optimiser: round " << round << ", " << remaining.size()
+           << " candidates, " << nofEvents << " events per position" << G4endl;
+
+    // the layouts with overlaps are dropped before their events
+    std::vector<Candidate*> evaluated;
+    for ( auto candidate : remaining ) {
+      if ( ! Apply(candidate->values) ) {
+        G4cout << "--> Layout optimiser: candidate " << candidate->id
+               << " has overlaps, dropped" << G4endl;
+        continue;
+      }
+      Evaluate(*candidate, nofEvents);
+      evaluated.push_back(candidate);
+    }
+    if ( evaluated.empty() ) {
+      G4ExceptionDescription msg;
+      msg << "All the remaining layouts have overlaps; check the parameter ranges.";
+      G4Exception("LayoutOptimiser::Optimise()", "MyCode0014", JustWarning, msg);
+      break;
+    }
+
+    // keep the better half by running efficiency
+    std::stable_sort(evaluated.begin(), evaluated.end(), [](const Candidate* a, const Candidate* b) {
+      return a->GetEfficiency() > b->GetEfficiency();
+    });
+    std::size_t nofKept = (evaluated.size() + 1)/2;
+    for ( std::size_t i=0; i<evaluated.size(); ++i ) {
+      Print(file, round, *evaluated[i], i < nofKept);
+    }
+
+    if ( nofKept == 1 ) {
+      // the best layout
+      const auto& best = *evaluated.front();
+      Apply(best.values);
+
+      G4cout << G4endl << " ----> best layout: candidate " << best.id
+             << ", collective efficiency " << best.GetEfficiency()
+             << " +- " << best.GetError() << " (" << best.GetNofEvents() << " events)" << G4endl;
+      for ( G4int parameter=0; parameter<kNofParameters; ++parameter ) {
+        G4cout << " /B4/geometry/" << kNames[parameter] << " "
+               << best.values[parameter]/GetUnit(parameter) << " " << GetUnitName(parameter)
+               << G4endl;
+      }
+      const auto& current = candidates.front();
+      if ( best.id != current.id ) {
+        G4cout << " (current layout: " << current.GetEfficiency()
+               << " +- " << current.GetError() << ")" << G4endl;
+      }
+      break;
+    }
+
+    remaining.assign(evaluated.begin(), evaluated.begin() + nofKept);
+    nofEvents = ( nofEvents < 0x3fffffff ) ? 2*nofEvents : nofEvents;
+  }
+  file.close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,236 @@
+/// \file MemoryReport.cc
+/// \brief Implementation of the B4c::MemoryReport class
+
+#include "MemoryReport.hh"
+#include "CalorHit.hh"
+#include "Run.hh"
+
+#include "G4AnalysisManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace B4c
+{
+
+namespace
+{
+const char* kNames[MemoryReport::kNofCategories]
+  = { "run counters", "hit pool", "histograms", "ntuple buffers", "random engine" };
+
+constexpr G4double kB = 1024.;
+constexpr G4double MB = 1024.*1024.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryReport* MemoryReport::Instance()
+{
+  // created with the master run action, kept until the end of the job
+  static auto instance = new MemoryReport;
+  return instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryReport::MemoryReport()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/memory/", "Memory report");
+
+  fMessenger->DeclareProperty("report", fEnabled)
+    .SetGuidance("Print the memory per thread and per category at the end of run.")
+    .SetParameterName("report", true)
+    .SetDefaultValue("true")
+    .SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* MemoryReport::GetName(G4int category)
+{
+  return kNames[category];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryReport::Process MemoryReport::ReadProcess()
+{
+  Process process;
+#ifdef __linux__
+  // the values are in kB
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while ( std::getline(status, line) ) {
+    std::istringstream is(line);
+    std::string key;
+    std::size_t value = 0;
+    is >> key >> value;
+    if      ( key == "VmRSS:" ) process.resident = value*1024;
+    else if ( key == "VmHWM:" ) process.peak = value*1024;
+  }
+#endif
+  return process;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryReport::Usage MemoryReport::Measure(const Run* run, std::size_t ntupleBytes)
+{
+  Usage usage{};
+
+  if ( run ) usage[kRunCounters] = run->GetMemorySize();
+
+  if ( CalorHitAllocator ) usage[kHitPool] = CalorHitAllocator->GetAllocatedSize();
+
+  // per bin: entries, sums of weights and squared weights, and the
+  // (one-dimensional) sums of x*w and x*x*w
+  auto analysisManager = G4AnalysisManager::Instance();
+  for ( G4int id=0; id<analysisManager->GetNofH1s(); ++id ) {
+    auto histo = analysisManager->GetH1(id, false, false);
+    if ( ! histo ) continue;
+    usage[kHistograms] += histo->bins_entries().capacity()*sizeof(unsigned int)
+                        + histo->bins_sum_w().capacity()*sizeof(G4double)
+                        + histo->bins_sum_w2().capacity()*sizeof(G4double);
+    for ( const auto& sums : { &histo->bins_sum_xw(), &histo->bins_sum_x2w() } ) {
+      usage[kHistograms] += sums->capacity()*sizeof(std::vector<G4double>);
+      for ( const auto& sum : *sums ) usage[kHistograms] += sum.capacity()*sizeof(G4double);
+    }
+  }
+
+  usage[kNtupleBuffers] = ntupleBytes;
+
+  auto engine = G4Random::getTheEngine();
+  if ( engine ) usage[kRandomEngine] = engine->put().size()*sizeof(unsigned long);
+
+  return usage;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MemoryReport::BeginOfRun()
+{
+  fFirstRun = ( fNofRuns++ == 0 );
+  if ( ! fEnabled ) return;
+
+  for ( auto& slot : fSlots ) slot = Slot();
+  fStart = ReadProcess();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MemoryReport::Record(Phase phase, const Usage& usage)
+{
+  // the master (or sequential) thread ID is -1, the workers from 0
+  auto index = G4Threading::G4GetThreadId() + 1;
+  if ( index < 0 || index >= kMaxSlots ) return;
+
+  fSlots[index].recorded = true;
+  fSlots[index].usage[phase] = usage;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MemoryReport::EndOfRun(G4int runID) const
+{
+  auto end = ReadProcess();
+
+  // per category and phase: sum and maximum over the workers
+  G4int nofWorkers = 0;
+  std::array<Usage, kNofPhases> sum{}, max{};
+  for ( G4int index=1; index<kMaxSlots; ++index ) {
+    const auto& slot = fSlots[index];
+    if ( ! slot.recorded ) continue;
+    ++nofWorkers;
+    for ( G4int phase=0; phase<kNofPhases; ++phase ) {
+      for ( G4int category=0; category<kNofCategories; ++category ) {
+        auto bytes = slot.usage[phase][category];
+        sum[phase][category] += bytes;
+        max[phase][category] = std::max(max[phase][category], bytes);
+      }
+    }
+  }
+  const auto& master = fSlots[0].usage[kEndOfRun];
+
+  G4cout << G4endl << " ----> memory of run " << runID << " (" << nofWorkers << " workers):"
+         << " resident " << end.resident/MB << " MB (peak " << end.peak/MB << " MB), "
+         << fStart.resident/MB << " MB at the beginning of run" << G4endl;
+
+  char line[160];
+  std::snprintf(line, sizeof(line), "  %-16s %23s %23s %10s %12s",
+                "(kB)", "initialisation", "end of run", "", "");
+  G4cout << line << G4endl;
+  std::snprintf(line, sizeof(line), "  %-16s %11s %11s %11s %11s %10s %12s",
+                "", "worker mean", "max", "worker mean", "max", "master", "all threads");
+  G4cout << line << G4endl;
+
+  auto mean = [&](std::size_t bytes) { return nofWorkers > 0 ? bytes/kB/nofWorkers : 0.; };
+  std::size_t total[2] = { 0, 0 };
+  for ( G4int category=0; category<=kNofCategories; ++category ) {
+    // the last line is the total
+    auto value = [&](const Usage& usage) {
+      if ( category < kNofCategories ) return usage[category];
+      std::size_t bytes = 0;
+      for ( auto b : usage ) bytes += b;
+      return bytes;
+    };
+    auto all = value(sum[kEndOfRun]) + value(master);
+    std::snprintf(line, sizeof(line), "  %-16s %11.1f %11.1f %11.1f %11.1f %10.1f %12.1f",
+                  category < kNofCategories ? kNames[category] : "project total",
+                  mean(value(sum[kInitialisation])), value(max[kInitialisation])/kB,
+                  mean(value(sum[kEndOfRun])), value(max[kEndOfRun])/kB,
+                  value(master)/kB, all/kB);
+    G4cout << line << G4endl;
+    if ( category == kNofCategories ) {
+      total[0] = all;
+      total[1] = value(sum[kEndOfRun]);
+    }
+  }
+
+  // the workers are created and initialised during the first run: its growth
+  // per worker is the cost of a thread, later runs only reuse them
+  G4double growth = G4double(end.resident) - G4double(fStart.resident);
+  G4bool perWorker = fFirstRun && nofWorkers > 0;
+  if ( end.resident > 0 ) {
+    G4cout << "  shared and Geant4 (resident - project total): "
+           << (G4double(end.resident) - total[0])/MB << " MB" << G4endl
+           << "  resident growth over the run: " << growth/MB << " MB";
+    if ( perWorker ) {
+      G4cout << ", " << growth/MB/nofWorkers << " MB per worker started, of which "
+             << total[1]/MB/nofWorkers << " MB of project structures";
+    }
+    G4cout << G4endl;
+  }
+
+  // the header only in a new file; the growth per worker is - after the first run
+  G4bool newFile = std::ifstream("memory_report.dat").peek() == std::ifstream::traits_type::eof();
+  std::ofstream file("memory_report.dat", std::ios::app);
+  if ( newFile ) {
+    file << "# run workers resident_start(MB) resident_end(MB) peak(MB)"
+            " first_run_growth_per_worker(MB)";
+    for ( auto name : kNames ) {
+      std::string column(name);
+      std::replace(column.begin(), column.end(), ' ', '_');
+      file << " " << column << "(kB)";
+    }
+    file << "\n";
+  }
+  file << runID << " " << nofWorkers << " " << fStart.resident/MB << " "
+       << end.resident/MB << " " << end.peak/MB << " ";
+  if ( perWorker ) file << growth/MB/nofWorkers;
+  else file << "-";
+  for ( G4int category=0; category<kNofCategories; ++category ) {
+    file << " " << (sum[kEndOfRun][category] + master[category])/kB;
+  }
+  file << "\n";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
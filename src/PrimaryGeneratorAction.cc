@@ -2,6 +2,9 @@
 /// \brief Implementation of the B4::PrimaryGeneratorAction class
 
 #include "PrimaryGeneratorAction.hh"
+#include "Checkpoint.hh"
+#include "Run.hh"
+#include "RunProgress.hh"
 
 #include "G4RunManager.hh"
 #include "G4LogicalVolumeStore.hh"
@@ -15,11 +18,12 @@
 #include "G4PhysicalConstants.hh"
 #include "Randomize.hh"
 
-#include <fstream>
 
 namespace B4
 {
 
+G4int PrimaryGeneratorAction::fNofPrimaries = 1;
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 PrimaryGeneratorAction::PrimaryGeneratorAction()
@@ -42,6 +46,19 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+G4long PrimaryGeneratorAction::GetEventIndex(const G4Event* event)
+{
+  // continues after the events of an interrupted job of the same scan point
+  return G4long(B4c::Checkpoint::GetEventOffset()) + event->GetEventID();
+}
+
+G4long PrimaryGeneratorAction::GetPrimaryIndex(const G4Event* event, G4int primary)
+{
+  return GetEventIndex(event)*fNofPrimaries + primary;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
   // This function is called at the begining of event
@@ -73,22 +90,54 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
   // Set gun position
   //fParticleGun->SetParticlePosition(G4ThreeVector(0.,0.,0.));
 
-  G4double cosTheta = 2*G4UniformRand() - 1., phi = twopi*G4UniformRand();
-  G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
-  G4double px = sinTheta*std::cos(phi),
-           py = sinTheta*std::sin(phi),
-           pz = cosTheta;
-
-  fParticleGun->SetParticleMomentumDirection(G4ThreeVector(px,py,pz));
-
-
-  // Output initial p vectors to file
-  std::ofstream ofile;
-  ofile.open("data.dat", std::ios_base::app);
-  ofile << px << "\t" << py << "\t" << pz << "\n";
-  ofile.close();
+  // the grid cells interleave with the events; the quasi-random sequence
+  // would be strided by the number of cells
+  G4bool mapping = fAcceptanceMap && fAcceptanceMap->IsEnabled();
+  // a response matrix grid point is a point source at the gun energy
+  G4bool gunOnly = B4c::RunProgress::Instance()->IsGunOnly();
+
+  auto gunPosition = fParticleGun->GetParticlePosition();
+  auto gunEnergy = fParticleGun->GetParticleEnergy();
+  auto run = static_cast<B4c::Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+
+  // one vertex per primary; the primary k gets the track ID k+1
+  for ( G4int primary=0; primary<fNofPrimaries; ++primary ) {
+    auto index = GetPrimaryIndex(anEvent, primary);
+
+    G4double u[B4c::QuasiRandom::kNofDimensions];
+    if ( fQuasiRandom.IsEnabled() && ! mapping ) {
+      fQuasiRandom.GetPoint(index, u);
+    }
+    else {
+      u[0] = G4UniformRand();
+      u[1] = G4UniformRand();
+    }
+
+    G4double cosTheta = 2*u[0] - 1., phi = twopi*u[1];
+    G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+    G4double px = sinTheta*std::cos(phi),
+             py = sinTheta*std::sin(phi),
+             pz = cosTheta;
+
+    fParticleGun->SetParticleMomentumDirection(G4ThreeVector(px,py,pz));
+
+    // counted for the isotropy tests of the run
+    run->AddDirection(px, py, pz, phi);
+
+    // Spread the emission point and sample the energy, around the gun settings
+    auto position = mapping ? fAcceptanceMap->GetPosition(index) : gunPosition;
+    if ( fSource.IsExtended() && ! gunOnly ) {
+      position += fSource.SamplePosition();
+    }
+    fParticleGun->SetParticlePosition(position);
+    fParticleGun->SetParticleEnergy(fSource.HasSpectrum() && ! gunOnly ? fSource.SampleEnergy()
+                                                                       : gunEnergy);
+
+    fParticleGun->GeneratePrimaryVertex(anEvent);
+  }
 
-  fParticleGun->GeneratePrimaryVertex(anEvent);
+  fParticleGun->SetParticlePosition(gunPosition);
+  fParticleGun->SetParticleEnergy(gunEnergy);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
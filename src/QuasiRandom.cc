@@ -0,0 +1,98 @@
+/// \file QuasiRandom.cc
+/// \brief Implementation of the B4c::QuasiRandom class
+
+#include "QuasiRandom.hh"
+
+#include "G4GenericMessenger.hh"
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+QuasiRandom::QuasiRandom()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/qmc/", "Quasi-random directions");
+
+  fMessenger->DeclareProperty("enable", fEnabled)
+    .SetGuidance("Sample the emission directions from a shifted Sobol sequence.")
+    .SetParameterName("enable", true)
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareProperty("replicas", fNofReplicas)
+    .SetGuidance("Number of independently shifted replicas, for the error estimate.")
+    .SetParameterName("replicas", false)
+    .SetRange("replicas>=2");
+
+  fMessenger->DeclareProperty("seed", fSeed)
+    .SetGuidance("Seed of the replica shifts.")
+    .SetParameterName("seed", false);
+}
+
+QuasiRandom::~QuasiRandom()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::array<std::array<std::uint32_t, QuasiRandom::kNofBits>, QuasiRandom::kNofDimensions>&
+QuasiRandom::GetDirections()
+{
+  // direction numbers: the first dimension is the van der Corput sequence,
+  // the second one uses the primitive polynomial x + 1
+  static const auto directions = []() {
+    std::array<std::array<std::uint32_t, kNofBits>, kNofDimensions> v;
+    for ( G4int k=0; k<kNofBits; ++k ) v[0][k] = std::uint32_t(1) << (kNofBits - 1 - k);
+    v[1][0] = std::uint32_t(1) << (kNofBits - 1);
+    for ( G4int k=1; k<kNofBits; ++k ) v[1][k] = v[1][k-1] ^ (v[1][k-1] >> 1);
+    return v;
+  }();
+  return directions;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void QuasiRandom::BuildShifts()
+{
+  // splitmix64, so that the shifts only depend on the seed
+  std::uint64_t state = std::uint64_t(fSeed);
+  auto next = [&state]() {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  };
+
+  fShifts.resize(fNofReplicas);
+  for ( auto& shift : fShifts ) {
+    for ( auto& word : shift ) word = std::uint32_t(next() >> 32);
+  }
+  fShiftSeed = fSeed;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void QuasiRandom::GetPoint(G4long eventIndex, G4double point[kNofDimensions])
+{
+  if ( fShiftSeed != fSeed || G4int(fShifts.size()) != fNofReplicas ) BuildShifts();
+
+  const auto& directions = GetDirections();
+  const auto& shift = fShifts[eventIndex % fNofReplicas];
+  auto index = std::uint64_t(eventIndex/fNofReplicas);
+
+  for ( G4int dimension=0; dimension<kNofDimensions; ++dimension ) {
+    std::uint32_t x = 0;
+    for ( G4int k=0; k<kNofBits && (index >> k) != 0; ++k ) {
+      if ( (index >> k) & 1 ) x ^= directions[dimension][k];
+    }
+    x ^= shift[dimension];
+
+    // centre of the cell, never 0 nor 1
+    point[dimension] = (x + 0.5)/4294967296.;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,187 @@
+/// \file RandomEngine.cc
+/// \brief Implementation of the B4c::RandomEngine class
+
+#include "RandomEngine.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace B4c
+{
+
+G4String RandomEngine::fName = "mixmax";
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RandomEngine::RandomEngine()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/random/", "Random engine");
+
+  fMessenger->DeclareMethod("engine", &RandomEngine::SetEngine)
+    .SetGuidance("Random engine of a sequential job, before the first run.")
+    .SetGuidance("With threads, the engine is set with the -e option of exampleB4c.")
+    .SetGuidance("The seed can be set afterwards with /random/setSeeds.")
+    .SetParameterName("engine", false)
+    .SetCandidates(kNames)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("benchmark", &RandomEngine::Benchmark)
+    .SetGuidance("Random numbers per second and seeding cost of each engine.")
+    .SetParameterName("nofNumbers", true)
+    .SetDefaultValue("10000000")
+    .SetRange("nofNumbers>0")
+    .SetToBeBroadcasted(false);
+}
+
+RandomEngine::~RandomEngine()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CLHEP::HepRandomEngine* RandomEngine::Create(const G4String& name)
+{
+  if ( name == "mixmax" )   return new CLHEP::MixMaxRng;
+  if ( name == "ranluxpp" ) return new CLHEP::RanluxppEngine;
+  if ( name == "ranlux" )   return new CLHEP::RanluxEngine;
+  if ( name == "ranlux64" ) return new CLHEP::Ranlux64Engine;
+  if ( name == "mtwist" )   return new CLHEP::MTwistEngine;
+  if ( name == "ranecu" )   return new CLHEP::RanecuEngine;
+  if ( name == "james" )    return new CLHEP::HepJamesRandom;
+  if ( name == "ranshi" )   return new CLHEP::RanshiEngine;
+  if ( name == "dualrand" ) return new CLHEP::DualRand;
+  return nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool RandomEngine::Select(const G4String& name, G4long seed)
+{
+  auto engine = Create(name);
+  if ( ! engine ) {
+    G4ExceptionDescription msg;
+    msg << "Unknown random engine " << name << "; expected one of: " << kNames;
+    G4Exception("RandomEngine::Select()", "MyCode0019", JustWarning, msg);
+    return false;
+  }
+
+  // the engine is kept until the end of the job
+  G4Random::setTheEngine(engine);
+  if ( seed > 0 ) G4Random::setTheSeed(seed);
+  fName = name;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RandomEngine::SetEngine(const G4String& name)
+{
+  // the MT and tasking run managers record the master engine when they are
+  // constructed, and the workers clone it: a later change would switch the
+  // master only
+  if ( G4Threading::IsMultithreadedApplication() ) {
+    G4ExceptionDescription msg;
+    msg << "With threads, the random engine is set with the -e option of exampleB4c,"
+        << " before the run manager is created; it remains " << fName << ".";
+    G4Exception("RandomEngine::SetEngine()", "MyCode0019", JustWarning, msg);
+    return;
+  }
+
+  // the engine of the first run is kept
+  if ( fStarted ) {
+    G4ExceptionDescription msg;
+    msg << "The random engine is set before the first run; it remains " << fName << ".";
+    G4Exception("RandomEngine::SetEngine()", "MyCode0019", JustWarning, msg);
+    return;
+  }
+
+  Select(name);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RandomEngine::BeginOfRun()
+{
+  if ( fStarted ) return;
+  fStarted = true;
+
+  G4cout << "--> Random engine: " << fName << " (" << G4Random::getTheEngine()->name()
+         << "), seed " << G4Random::getTheSeed() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RandomEngine::Benchmark(G4int nofNumbers) const
+{
+  using Clock = std::chrono::steady_clock;
+  auto seconds = [](Clock::time_point start) {
+    return std::chrono::duration<G4double>(Clock::now() - start).count();
+  };
+
+  // the MT run manager seeds each event with two numbers from the master
+  const G4int nofSeedings = std::max(nofNumbers/1000, 1000);
+  constexpr G4int kArraySize = 1000;
+
+  G4cout << G4endl << " ----> random engine benchmark: " << nofNumbers << " numbers, "
+         << nofSeedings << " seedings per engine" << G4endl;
+  char line[120];
+  std::snprintf(line, sizeof(line), "  %-10s %14s %14s %14s", "engine", "flat (/s)",
+                "flatArray (/s)", "seeding (us)");
+  G4cout << line << G4endl;
+
+  std::ofstream file("rng_benchmark.dat", std::ios::app);
+  file << "# engine numbers flat(/s) flatArray(/s) seeding(us)\n";
+
+  std::istringstream names(kNames);
+  G4String name;
+  std::vector<G4double> array(kArraySize);
+  while ( names >> name ) {
+    std::unique_ptr<CLHEP::HepRandomEngine> engine(Create(name));
+    engine->setSeed(12345, 0);
+
+    // warm-up, then the numbers one at a time; the sum keeps them
+    G4double sum = 0.;
+    for ( G4int i=0; i<kArraySize; ++i ) sum += engine->flat();
+    auto start = Clock::now();
+    for ( G4int i=0; i<nofNumbers; ++i ) sum += engine->flat();
+    auto flatRate = nofNumbers/seconds(start);
+
+    start = Clock::now();
+    for ( G4int i=0; i<nofNumbers; i+=kArraySize ) {
+      engine->flatArray(kArraySize, array.data());
+      sum += array[0];
+    }
+    auto arrayRate = ((nofNumbers + kArraySize - 1)/kArraySize)*G4double(kArraySize)
+                   / seconds(start);
+
+    start = Clock::now();
+    for ( G4int i=0; i<nofSeedings; ++i ) {
+      long seeds[3] = { long(1e8*engine->flat()), long(1e8*engine->flat()), 0 };
+      engine->setSeeds(seeds, -1);
+    }
+    auto seeding = seconds(start)/nofSeedings;
+
+    volatile G4double sink = sum;
+    (void)sink;
+
+    std::snprintf(line, sizeof(line), "  %-10s %14.4g %14.4g %14.3f", name.c_str(), flatRate,
+                  arrayRate, seeding/1e-6);
+    G4cout << line << G4endl;
+    file << name << " " << nofNumbers << " " << flatRate << " " << arrayRate << " "
+         << seeding/1e-6 << "\n";
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,465 @@
+/// \file ResponseMatrix.cc
+/// \brief Implementation of the B4c::ResponseMatrix class
+
+#include "ResponseMatrix.hh"
+#include "GeometryHash.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "RunProgress.hh"
+#include "Source.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
+#include "G4UImanager.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace B4c
+{
+
+namespace
+{
+constexpr char kMagic[8] = { 'B', '4', 'R', 'M', 'A', 'T', '\0', '\0' };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ResponseMatrix::ResponseMatrix()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/matrix/", "Response matrix cache");
+
+  fMessenger->DeclareMethod("positions", &ResponseMatrix::SetPositions)
+    .SetGuidance("Grid of source distances: zMin zMax n, in mm.")
+    .SetParameterName("grid", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("energies", &ResponseMatrix::SetEnergies)
+    .SetGuidance("Grid of energies: Emin Emax n, in MeV.")
+    .SetParameterName("grid", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("events", fNofEvents)
+    .SetGuidance("Number of events per grid point.")
+    .SetParameterName("events", false)
+    .SetRange("events>0")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("fileName", fFileName)
+    .SetGuidance("Cache file name.")
+    .SetParameterName("fileName", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("build", &ResponseMatrix::Build)
+    .SetGuidance("Run all the grid points and write the cache.")
+    .SetGuidance("The gun position and energy are changed.")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("fold", &ResponseMatrix::Fold)
+    .SetGuidance("Response to a source spectrum at a distance, from the cache:")
+    .SetGuidance("  spectrumFile z(mm)")
+    .SetGuidance("The spectrum file has the format of /B4/source/spectrum.")
+    .SetParameterName("query", false)
+    .SetToBeBroadcasted(false);
+}
+
+ResponseMatrix::~ResponseMatrix()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ResponseMatrix::ParseGrid(const G4String& value, G4double unit,
+                                 std::vector<G4double>& grid)
+{
+  std::istringstream is(value);
+  G4double min = 0., max = 0.;
+  G4int n = 0;
+  is >> min >> max >> n;
+  if ( is.fail() || n < 1 || max < min || ( n > 1 && max == min ) ) return false;
+
+  grid.resize(n);
+  for ( G4int i=0; i<n; ++i ) {
+    grid[i] = ( n > 1 ) ? (min + (max - min)*i/(n - 1))*unit : min*unit;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::SetPositions(const G4String& value)
+{
+  if ( ! ParseGrid(value, mm, fPositions) ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot parse the position grid \"" << value << "\"" << G4endl
+        << "Expected: zMin zMax n (mm)";
+    G4Exception("ResponseMatrix::SetPositions()", "MyCode0012", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::SetEnergies(const G4String& value)
+{
+  if ( ! ParseGrid(value, MeV, fEnergies) || fEnergies.front() <= 0. ) {
+    fEnergies.clear();
+    G4ExceptionDescription msg;
+    msg << "Cannot parse the energy grid \"" << value << "\"" << G4endl
+        << "Expected: Emin Emax n (MeV), Emin > 0";
+    G4Exception("ResponseMatrix::SetEnergies()", "MyCode0012", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::Build()
+{
+  if ( fPositions.empty() || fEnergies.empty() ) {
+    G4ExceptionDescription msg;
+    msg << "Define the grid with /B4/matrix/positions and /B4/matrix/energies.";
+    G4Exception("ResponseMatrix::Build()", "MyCode0012", JustWarning, msg);
+    return;
+  }
+
+  fLoaded = false;
+  fGridPositions = fPositions;
+  fGridEnergies = fEnergies;
+  fGrid.assign(fPositions.size()*fEnergies.size(), GridPoint());
+
+  auto UImanager = G4UImanager::GetUIpointer();
+  for ( std::size_t i=0; i<fPositions.size(); ++i ) {
+    for ( std::size_t j=0; j<fEnergies.size(); ++j ) {
+      std::ostringstream position, energy;
+      position << std::setprecision(17) << "/gun/position 0. 0. " << -fPositions[i]/mm << " mm";
+      energy << std::setprecision(17) << "/gun/energy " << fEnergies[j]/MeV << " MeV";
+      UImanager->ApplyCommand(position.str());
+      UImanager->ApplyCommand(energy.str());
+
+      G4cout << "--> Response matrix: z = " << fPositions[i]/mm << " mm, E = "
+             << fEnergies[j]/MeV << " MeV" << G4endl;
+      fCurrentPoint = G4int(i*fEnergies.size() + j);
+      RunProgress::Instance()->SetInternalScan(true);
+      RunProgress::Instance()->SetGunOnly(true);
+      G4RunManager::GetRunManager()->BeamOn(B4::PrimaryGeneratorAction::GetNofEvents(fNofEvents));
+      RunProgress::Instance()->SetGunOnly(false);
+      RunProgress::Instance()->SetInternalScan(false);
+    }
+  }
+  fCurrentPoint = -1;
+
+  if ( Write() ) {
+    fLoaded = true;
+    fLoadedHash = GeometryHash::Compute();
+    G4cout << "--> Response matrix written to " << fFileName << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::EndOfRun(const Run* run)
+{
+  if ( fCurrentPoint < 0 ) return;
+
+  auto& point = fGrid[fCurrentPoint];
+  point.nofEvents = run->GetNumberOfEvent();
+  for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+    const auto& spectrum = run->GetSpectrum(detector);
+    auto& sparse = point.spectra[detector];
+    sparse.clear();
+    point.nofDetected[detector] = 0;
+    for ( std::size_t bin=0; bin<spectrum.size(); ++bin ) {
+      if ( spectrum[bin] == 0 ) continue;
+      sparse.emplace_back(std::uint32_t(bin), std::uint32_t(spectrum[bin]));
+      point.nofDetected[detector] += spectrum[bin];
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ResponseMatrix::Write() const
+{
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.nofDetectors = Run::kNofDetectors;
+  header.geometryHash = GeometryHash::Compute();
+  header.nofPositions = std::uint32_t(fGridPositions.size());
+  header.nofEnergies = std::uint32_t(fGridEnergies.size());
+  header.nofBins = Run::kNofThresholdBins;
+  header.byteOrder = kByteOrder;
+  header.binWidth = Run::kThresholdBinWidth/MeV;
+
+  // grid in mm and MeV
+  std::vector<G4double> positions, energies;
+  for ( auto z : fGridPositions ) positions.push_back(z/mm);
+  for ( auto energy : fGridEnergies ) energies.push_back(energy/MeV);
+
+  std::vector<IndexEntry> index(fGrid.size());
+  std::uint64_t offset = sizeof(header) + (positions.size() + energies.size())*sizeof(G4double)
+                       + index.size()*sizeof(IndexEntry);
+  for ( std::size_t i=0; i<fGrid.size(); ++i ) {
+    index[i].offset = offset;
+    index[i].nofEvents = fGrid[i].nofEvents;
+    for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+      index[i].nofFilled[detector] = std::uint32_t(fGrid[i].spectra[detector].size());
+      offset += fGrid[i].spectra[detector].size()*2*sizeof(std::uint32_t);
+    }
+  }
+
+  auto tmpName = fFileName + ".tmp";
+  std::ofstream file(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(positions.data()),
+             std::streamsize(positions.size()*sizeof(G4double)));
+  file.write(reinterpret_cast<const char*>(energies.data()),
+             std::streamsize(energies.size()*sizeof(G4double)));
+  file.write(reinterpret_cast<const char*>(index.data()),
+             std::streamsize(index.size()*sizeof(IndexEntry)));
+  for ( const auto& point : fGrid ) {
+    for ( const auto& spectrum : point.spectra ) {
+      file.write(reinterpret_cast<const char*>(spectrum.data()),
+                 std::streamsize(spectrum.size()*2*sizeof(std::uint32_t)));
+    }
+  }
+  file.close();
+
+  if ( file.fail() || std::rename(tmpName.c_str(), fFileName.c_str()) != 0 ) {
+    std::remove(tmpName.c_str());
+    G4ExceptionDescription msg;
+    msg << "Cannot write the response matrix to " << fFileName;
+    G4Exception("ResponseMatrix::Write()", "MyCode0012", JustWarning, msg);
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ResponseMatrix::Load()
+{
+  fLoaded = false;
+
+  std::ifstream file(fFileName.c_str(), std::ios::binary);
+  FileHeader header{};
+  if ( ! file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+       header.version != kVersion || header.byteOrder != kByteOrder ||
+       header.nofDetectors != std::uint32_t(Run::kNofDetectors) ||
+       header.nofBins != std::uint32_t(Run::kNofThresholdBins) ||
+       header.binWidth != Run::kThresholdBinWidth/MeV ) {
+    G4ExceptionDescription msg;
+    msg << fFileName << " is not a response matrix of this version, build it"
+        << " with /B4/matrix/build.";
+    G4Exception("ResponseMatrix::Load()", "MyCode0012", JustWarning, msg);
+    return false;
+  }
+
+  // the cache is only valid for the geometry it was built with
+  auto hash = GeometryHash::Compute();
+  if ( header.geometryHash != hash ) {
+    G4ExceptionDescription msg;
+    msg << fFileName << " was built for another geometry (hash "
+        << GeometryHash::ToString(header.geometryHash) << ", current "
+        << GeometryHash::ToString(hash) << ")," << G4endl
+        << "rebuild it with /B4/matrix/build.";
+    G4Exception("ResponseMatrix::Load()", "MyCode0012", JustWarning, msg);
+    return false;
+  }
+
+  fGridPositions.resize(header.nofPositions);
+  fGridEnergies.resize(header.nofEnergies);
+  std::vector<IndexEntry> index(std::size_t(header.nofPositions)*header.nofEnergies);
+  file.read(reinterpret_cast<char*>(fGridPositions.data()),
+            std::streamsize(fGridPositions.size()*sizeof(G4double)));
+  file.read(reinterpret_cast<char*>(fGridEnergies.data()),
+            std::streamsize(fGridEnergies.size()*sizeof(G4double)));
+  file.read(reinterpret_cast<char*>(index.data()),
+            std::streamsize(index.size()*sizeof(IndexEntry)));
+  for ( auto& z : fGridPositions ) z *= mm;
+  for ( auto& energy : fGridEnergies ) energy *= MeV;
+
+  fGrid.assign(index.size(), GridPoint());
+  for ( std::size_t i=0; i<index.size() && file; ++i ) {
+    auto& point = fGrid[i];
+    point.nofEvents = G4long(index[i].nofEvents);
+    file.seekg(std::streamoff(index[i].offset));
+    for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+      auto& spectrum = point.spectra[detector];
+      spectrum.resize(index[i].nofFilled[detector]);
+      file.read(reinterpret_cast<char*>(spectrum.data()),
+                std::streamsize(spectrum.size()*2*sizeof(std::uint32_t)));
+      for ( const auto& bin : spectrum ) point.nofDetected[detector] += bin.second;
+    }
+  }
+
+  if ( ! file ) {
+    fGrid.clear();
+    G4ExceptionDescription msg;
+    msg << fFileName << " is truncated, rebuild it with /B4/matrix/build.";
+    G4Exception("ResponseMatrix::Load()", "MyCode0012", JustWarning, msg);
+    return false;
+  }
+
+  fLoaded = true;
+  fLoadedHash = hash;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ResponseMatrix::Locate(const std::vector<G4double>& grid, G4double value,
+                              std::size_t& lower, G4double& weight)
+{
+  const G4double tolerance = 1.e-9*std::max(std::fabs(grid.front()), std::fabs(grid.back()));
+  if ( value < grid.front() - tolerance || value > grid.back() + tolerance ) return false;
+
+  lower = 0;
+  weight = 0.;
+  if ( grid.size() == 1 ) return true;
+
+  while ( lower + 2 < grid.size() && value > grid[lower+1] ) ++lower;
+  weight = std::min(1., std::max(0., (value - grid[lower])/(grid[lower+1] - grid[lower])));
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ResponseMatrix::Fold(const G4String& value)
+{
+  G4Timer timer;
+  timer.Start();
+
+  std::istringstream is(value);
+  G4String spectrumFile;
+  G4double z = 0.;
+  is >> spectrumFile >> z;
+  z *= mm;
+
+  std::vector<Source::Entry> entries;
+  std::vector<G4double> weights;
+  if ( is.fail() || ! Source::ReadSpectrum(spectrumFile, entries, weights) ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot read the query \"" << value << "\"" << G4endl
+        << "Expected: spectrumFile z(mm)";
+    G4Exception("ResponseMatrix::Fold()", "MyCode0012", JustWarning, msg);
+    return;
+  }
+
+  // the cache of the last build or load is reused if still valid
+  if ( ! fLoaded || GeometryHash::Compute() != fLoadedHash ) {
+    if ( ! Load() ) return;
+  }
+
+  std::size_t iz;
+  G4double tz;
+  if ( ! Locate(fGridPositions, z, iz, tz) ) {
+    G4ExceptionDescription msg;
+    msg << "z = " << z/mm << " mm is outside the grid of the response matrix.";
+    G4Exception("ResponseMatrix::Fold()", "MyCode0012", JustWarning, msg);
+    return;
+  }
+
+  // the source spectrum as weighted energies: lines, and bins split in
+  // sub-bins of at most one spectrum bin
+  std::vector<std::pair<G4double, G4double>> energies;
+  G4double sumWeights = 0.;
+  for ( auto weight : weights ) sumWeights += weight;
+  for ( std::size_t i=0; i<entries.size(); ++i ) {
+    const auto& entry = entries[i];
+    auto weight = weights[i]/sumWeights;
+    if ( entry.high == entry.low ) {
+      energies.emplace_back(entry.low, weight);
+      continue;
+    }
+    auto n = std::max(1, G4int(std::ceil((entry.high - entry.low)/Run::kThresholdBinWidth)));
+    for ( G4int k=0; k<n; ++k ) {
+      energies.emplace_back(entry.low + (k + 0.5)*(entry.high - entry.low)/n, weight/n);
+    }
+  }
+
+  // folded spectra per emitted particle, and the weight of each grid point
+  std::array<std::vector<G4double>, Run::kNofDetectors> folded;
+  for ( auto& spectrum : folded ) spectrum.assign(Run::kNofThresholdBins, 0.);
+  std::vector<G4double> coefficients(fGrid.size(), 0.);
+
+  for ( const auto& [energy, weight] : energies ) {
+    std::size_t ie;
+    G4double te;
+    if ( ! Locate(fGridEnergies, energy, ie, te) ) {
+      G4ExceptionDescription msg;
+      msg << "E = " << energy/MeV << " MeV is outside the grid of the response matrix.";
+      G4Exception("ResponseMatrix::Fold()", "MyCode0012", JustWarning, msg);
+      return;
+    }
+
+    for ( G4int cz=0; cz<2; ++cz ) {
+      for ( G4int ce=0; ce<2; ++ce ) {
+        G4double w = weight*( cz ? tz : 1. - tz )*( ce ? te : 1. - te );
+        if ( w == 0. ) continue;
+
+        auto pointIndex = (iz + cz)*fGridEnergies.size() + ie + ce;
+        const auto& point = fGrid[pointIndex];
+        if ( point.nofEvents == 0 ) continue;
+        G4double coefficient = w/point.nofEvents;
+        coefficients[pointIndex] += coefficient;
+
+        // deposits scaled from the grid energy to the requested one
+        G4double scale = energy/fGridEnergies[ie + ce];
+        for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+          auto& spectrum = folded[detector];
+          for ( const auto& [bin, count] : point.spectra[detector] ) {
+            auto target = std::size_t((bin + 0.5)*scale);
+            if ( target >= spectrum.size() ) target = spectrum.size() - 1;
+            spectrum[target] += coefficient*count;
+          }
+        }
+      }
+    }
+  }
+
+  // efficiencies, with the binomial errors of the grid points
+  std::array<G4double, Run::kNofDetectors> efficiencies{}, variances{};
+  for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+    for ( auto value : folded[detector] ) efficiencies[detector] += value;
+    for ( std::size_t i=0; i<fGrid.size(); ++i ) {
+      if ( coefficients[i] == 0. ) continue;
+      G4double k = fGrid[i].nofDetected[detector];
+      variances[detector] += coefficients[i]*coefficients[i]*k*(1. - k/fGrid[i].nofEvents);
+    }
+  }
+
+  timer.Stop();
+
+  const char* names[] = { "diode", "annular" };
+  G4cout << G4endl << " ----> response matrix fold of " << spectrumFile << " at z = "
+         << z/mm << " mm (" << timer.GetRealElapsed()*1000. << " ms)" << G4endl << G4endl;
+
+  std::ofstream results("fold_results.dat", std::ios::app);
+  results << spectrumFile << " " << z/mm;
+  for ( G4int detector=0; detector<Run::kNofDetectors; ++detector ) {
+    G4double error = std::sqrt(variances[detector]);
+    G4cout << " " << std::setw(10) << std::left << names[detector] << std::right
+           << ": " << 100.*efficiencies[detector] << " +- " << 100.*error << " %" << G4endl;
+    results << " " << 100.*efficiencies[detector] << " " << 100.*error;
+  }
+  results << std::endl;
+
+  std::ofstream spectra("fold_spectra.dat", std::ios::app);
+  spectra << "# " << spectrumFile << " z " << z/mm << " mm\n"
+          << "# E_low(keV) diode annular (per emitted particle)\n";
+  for ( G4int i=0; i<Run::kNofThresholdBins; ++i ) {
+    if ( folded[0][i] == 0. && folded[1][i] == 0. ) continue;
+    spectra << i*Run::kThresholdBinWidth/keV << " " << folded[0][i] << " " << folded[1][i] << "\n";
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,455 @@
+/// \file Run.cc
+/// \brief Implementation of the B4c::Run class
+
+#include "Run.hh"
+#include "RunProgress.hh"
+#include "SequentialStopping.hh"
+#include "Statistics.hh"
+
+#include "G4Event.hh"
+#include "G4UnitsTable.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Run::Run()
+{
+  for ( auto& spectrum : fSpectra ) spectrum.assign(kNofThresholdBins, 0);
+  for ( auto& histogram : fDirections ) histogram.assign(kNofDirectionBins, 0);
+  fDirectionMap.assign(kNofCosThetaBins*kNofPhiBins, 0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::RecordEvent(const G4Event* event)
+{
+  // one event per primary
+  G4Run::RecordEvent(event);
+  numberOfEvent += event->GetNumberOfPrimaryVertex() - 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::Merge(const G4Run* run)
+{
+  auto localRun = static_cast<const Run*>(run);
+
+  for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+    fBudgetSum[i]        += localRun->fBudgetSum[i];
+    fBudgetSum2[i]       += localRun->fBudgetSum2[i];
+    fPartialBudgetSum[i] += localRun->fPartialBudgetSum[i];
+  }
+  fNofPartial += localRun->fNofPartial;
+
+  fNofStacked   += localRun->fNofStacked;
+  fNofKilled    += localRun->fNofKilled;
+  fKilledEnergy += localRun->fKilledEnergy;
+  fMaxStackSize  = std::max(fMaxStackSize, localRun->fMaxStackSize);
+  fNofEscaped   += localRun->fNofEscaped;
+
+  fNofDiode      += localRun->fNofDiode;
+  fNofAnnular    += localRun->fNofAnnular;
+  fNofCollective += localRun->fNofCollective;
+
+  for ( G4int detector=0; detector<kNofDetectors; ++detector ) {
+    for ( G4int i=0; i<kNofThresholdBins; ++i ) {
+      fSpectra[detector][i] += localRun->fSpectra[detector][i];
+    }
+  }
+
+  if ( localRun->fReplicas.size() > fReplicas.size() ) {
+    fReplicas.resize(localRun->fReplicas.size(), {});
+  }
+  for ( std::size_t replica=0; replica<localRun->fReplicas.size(); ++replica ) {
+    for ( G4int i=0; i<4; ++i ) fReplicas[replica][i] += localRun->fReplicas[replica][i];
+  }
+
+  if ( localRun->fAcceptance.size() > fAcceptance.size() ) {
+    fAcceptance.resize(localRun->fAcceptance.size(), {});
+  }
+  for ( std::size_t cell=0; cell<localRun->fAcceptance.size(); ++cell ) {
+    for ( std::size_t i=0; i<fAcceptance[cell].size(); ++i ) {
+      fAcceptance[cell][i] += localRun->fAcceptance[cell][i];
+    }
+  }
+
+  for ( G4int component=0; component<kNofComponents; ++component ) {
+    for ( G4int i=0; i<kNofDirectionBins; ++i ) {
+      fDirections[component][i] += localRun->fDirections[component][i];
+    }
+  }
+  for ( std::size_t i=0; i<fDirectionMap.size(); ++i ) {
+    fDirectionMap[i] += localRun->fDirectionMap[i];
+  }
+
+  for ( G4int detector=0; detector<kNofDetectors; ++detector ) {
+    fEntryMaps[detector].Merge(localRun->fEntryMaps[detector]);
+  }
+
+  G4Run::Merge(run);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::AddBudget(const EnergyBudget& budget, G4bool partialDepositor)
+{
+  for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+    auto edep = budget.GetEdep(i);
+    fBudgetSum[i]  += edep;
+    fBudgetSum2[i] += edep*edep;
+    if ( partialDepositor ) fPartialBudgetSum[i] += edep;
+  }
+  if ( partialDepositor ) ++fNofPartial;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::Write(std::ostream& os) const
+{
+  os << numberOfEvent;
+  for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+    os << " " << fBudgetSum[i] << " " << fBudgetSum2[i] << " " << fPartialBudgetSum[i];
+  }
+  os << " " << fNofPartial
+     << " " << fNofStacked << " " << fNofKilled << " " << fKilledEnergy
+     << " " << fMaxStackSize << " " << fNofEscaped
+     << " " << fNofDiode << " " << fNofAnnular << " " << fNofCollective;
+
+  // spectra: number of filled bins, then (bin, count) pairs
+  for ( const auto& spectrum : fSpectra ) {
+    auto nofFilled = std::count_if(spectrum.begin(), spectrum.end(),
+                                   [](std::uint32_t count) { return count != 0; });
+    os << " " << nofFilled;
+    for ( G4int i=0; i<kNofThresholdBins; ++i ) {
+      if ( spectrum[i] != 0 ) os << " " << i << " " << spectrum[i];
+    }
+  }
+
+  os << " " << fReplicas.size();
+  for ( const auto& counts : fReplicas ) {
+    for ( auto count : counts ) os << " " << count;
+  }
+
+  os << " " << fAcceptance.size();
+  for ( const auto& counts : fAcceptance ) {
+    for ( auto count : counts ) os << " " << count;
+  }
+
+  for ( const auto& histogram : fDirections ) {
+    for ( auto count : histogram ) os << " " << count;
+  }
+  for ( auto count : fDirectionMap ) os << " " << count;
+
+  for ( const auto& maps : fEntryMaps ) maps.Write(os);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t Run::GetMemorySize() const
+{
+  auto size = sizeof(*this);
+  for ( const auto& spectrum : fSpectra ) size += spectrum.capacity()*sizeof(std::uint32_t);
+  size += fReplicas.capacity()*sizeof(std::array<G4long, 4>);
+  size += fAcceptance.capacity()*sizeof(AcceptanceCounts);
+  for ( const auto& histogram : fDirections ) {
+    size += histogram.capacity()*sizeof(std::uint32_t);
+  }
+  size += fDirectionMap.capacity()*sizeof(std::uint32_t);
+  // the objects themselves are counted in sizeof(*this)
+  for ( const auto& maps : fEntryMaps ) size += maps.GetMemorySize() - sizeof(maps);
+  return size;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::Read(std::istream& is)
+{
+  is >> numberOfEvent;
+  for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+    is >> fBudgetSum[i] >> fBudgetSum2[i] >> fPartialBudgetSum[i];
+  }
+  is >> fNofPartial
+     >> fNofStacked >> fNofKilled >> fKilledEnergy
+     >> fMaxStackSize >> fNofEscaped
+     >> fNofDiode >> fNofAnnular >> fNofCollective;
+
+  for ( auto& spectrum : fSpectra ) {
+    spectrum.assign(kNofThresholdBins, 0);
+    G4int nofFilled = 0;
+    is >> nofFilled;
+    for ( G4int j=0; j<nofFilled; ++j ) {
+      G4int bin = 0;
+      std::uint32_t count = 0;
+      is >> bin >> count;
+      if ( bin >= 0 && bin < kNofThresholdBins ) spectrum[bin] = count;
+    }
+  }
+
+  std::size_t nofReplicas = 0;
+  is >> nofReplicas;
+  fReplicas.assign(nofReplicas, {});
+  for ( auto& counts : fReplicas ) {
+    for ( auto& count : counts ) is >> count;
+  }
+
+  std::size_t nofCells = 0;
+  is >> nofCells;
+  fAcceptance.assign(nofCells, {});
+  for ( auto& counts : fAcceptance ) {
+    for ( auto& count : counts ) is >> count;
+  }
+
+  for ( auto& histogram : fDirections ) {
+    for ( auto& count : histogram ) is >> count;
+  }
+  for ( auto& count : fDirectionMap ) is >> count;
+
+  for ( auto& maps : fEntryMaps ) maps.Read(is);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::EndOfRun(G4double realTime) const
+{
+  if ( numberOfEvent == 0 ) return;
+
+  G4cout
+    << G4endl
+    << " ----> energy budget per volume for " << numberOfEvent << " events"
+    << " (" << fNofPartial << " partial depositors)" << G4endl << G4endl;
+
+  for ( G4int i=0; i<EnergyBudget::kNofVolumes; ++i ) {
+    auto mean = fBudgetSum[i]/numberOfEvent;
+    auto rms  = std::sqrt(std::max(0., fBudgetSum2[i]/numberOfEvent - mean*mean));
+    auto partialMean = ( fNofPartial > 0 ) ? fPartialBudgetSum[i]/fNofPartial : 0.;
+
+    G4cout
+      << " " << std::setw(12) << std::left << EnergyBudget::GetName(i) << std::right
+      << ": mean = " << std::setw(7) << G4BestUnit(mean, "Energy")
+      << " rms = " << std::setw(7) << G4BestUnit(rms, "Energy")
+      << " partial depositors mean = " << std::setw(7) << G4BestUnit(partialMean, "Energy")
+      << G4endl;
+  }
+
+  G4cout
+    << G4endl
+    << " ----> stacking statistics" << G4endl << G4endl
+    << " Secondaries stacked : " << fNofStacked
+    << " (" << G4double(fNofStacked)/numberOfEvent << " per event)" << G4endl
+    << " Secondaries killed  : " << fNofKilled
+    << " depositing " << G4BestUnit(fKilledEnergy, "Energy") << " locally" << G4endl
+    << " Maximum stack size  : " << fMaxStackSize << G4endl
+    << " Geometrically escaped primaries : " << fNofEscaped
+    << " (" << 100.*fNofEscaped/numberOfEvent << " %)" << G4endl;
+
+  if ( realTime > 0. ) {
+    G4cout
+      << " Throughput          : " << numberOfEvent/realTime << " events/s, "
+      << fNofStacked/realTime << " secondaries/s" << G4endl;
+  }
+
+  // detection efficiencies with binomial errors
+  const char* names[] = { "diode", "annular", "collective" };
+  G4long counts[] = { fNofDiode, fNofAnnular, fNofCollective };
+  auto stopReason = RunProgress::Instance()->GetStopReason();
+
+  G4cout
+    << G4endl
+    << " ----> detection efficiencies for " << numberOfEvent << " events"
+    << " (run ended by " << RunProgress::GetStopReasonName(stopReason) << ")"
+    << G4endl << G4endl;
+
+  std::ofstream summary("efficiency_summary.dat", std::ios::app);
+  summary << runID << " " << numberOfEvent << " "
+          << RunProgress::GetStopReasonName(stopReason);
+
+  for ( G4int i=0; i<3; ++i ) {
+    auto efficiency = G4double(counts[i])/numberOfEvent;
+    auto error = std::sqrt(efficiency*(1. - efficiency)/numberOfEvent);
+    auto relativeError = SequentialStopping::RelativeError(counts[i], numberOfEvent);
+
+    G4cout
+      << " " << std::setw(10) << std::left << names[i] << std::right
+      << ": " << 100.*efficiency << " +- " << 100.*error << " %";
+    if ( counts[i] > 0 ) G4cout << " (relative error " << relativeError << ")";
+    G4cout << G4endl;
+
+    summary << " " << 100.*efficiency << " " << 100.*error;
+  }
+  summary << std::endl;
+
+  WriteThresholdCurve();
+  WriteReplicaEfficiencies();
+  WriteIsotropy();
+  WriteEntryMaps();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::WriteThresholdCurve() const
+{
+  // reverse cumulative sums: number of events above each threshold
+  std::array<std::vector<G4long>, kNofDetectors> above;
+  for ( G4int detector=0; detector<kNofDetectors; ++detector ) {
+    above[detector].resize(kNofThresholdBins);
+    G4long sum = 0;
+    for ( G4int i=kNofThresholdBins-1; i>=0; --i ) {
+      sum += fSpectra[detector][i];
+      above[detector][i] = sum;
+    }
+  }
+
+  std::ofstream curve("threshold_curve.dat", std::ios::app);
+  curve << "# run " << runID << " events " << numberOfEvent << "\n"
+        << "# threshold(keV) diode_eff diode_err annular_eff annular_err (in %)\n";
+
+  for ( G4int i=0; i<kNofThresholdBins; ++i ) {
+    curve << i*kThresholdBinWidth/keV;
+    for ( G4int detector=0; detector<kNofDetectors; ++detector ) {
+      auto efficiency = G4double(above[detector][i])/numberOfEvent;
+      auto error = std::sqrt(efficiency*(1. - efficiency)/numberOfEvent);
+      curve << " " << 100.*efficiency << " " << 100.*error;
+    }
+    curve << "\n";
+  }
+
+  G4cout << " Efficiency versus threshold written to threshold_curve.dat" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::WriteReplicaEfficiencies() const
+{
+  // replicas with events; each one is an unbiased estimate
+  std::vector<const std::array<G4long, 4>*> replicas;
+  for ( const auto& counts : fReplicas ) {
+    if ( counts[0] > 0 ) replicas.push_back(&counts);
+  }
+  if ( replicas.size() < 2 ) return;
+
+  const char* names[] = { "diode", "annular", "collective" };
+  auto nofReplicas = G4double(replicas.size());
+
+  G4cout
+    << G4endl
+    << " ----> randomised QMC efficiencies from " << replicas.size() << " replicas"
+    << G4endl << G4endl;
+
+  std::ofstream summary("rqmc_summary.dat", std::ios::app);
+  summary << runID << " " << numberOfEvent << " " << replicas.size();
+
+  for ( G4int i=0; i<3; ++i ) {
+    G4double sum = 0., sum2 = 0.;
+    for ( auto counts : replicas ) {
+      auto efficiency = G4double((*counts)[i+1])/(*counts)[0];
+      sum += efficiency;
+      sum2 += efficiency*efficiency;
+    }
+    auto mean = sum/nofReplicas;
+    auto variance = std::max(0., (sum2 - nofReplicas*mean*mean)/(nofReplicas - 1.));
+    auto error = std::sqrt(variance/nofReplicas);
+
+    // error of the same number of pseudo-random events
+    auto binomialError = std::sqrt(mean*(1. - mean)/numberOfEvent);
+
+    G4cout
+      << " " << std::setw(10) << std::left << names[i] << std::right
+      << ": " << 100.*mean << " +- " << 100.*error << " %";
+    if ( error > 0. ) {
+      G4cout << " (binomial error " << 100.*binomialError << " %, variance ratio "
+             << binomialError*binomialError/(error*error) << ")";
+    }
+    G4cout << G4endl;
+
+    summary << " " << 100.*mean << " " << 100.*error;
+  }
+  summary << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::WriteIsotropy() const
+{
+  G4long nofPrimaries = 0;
+  for ( auto count : fDirections[kPz] ) nofPrimaries += count;
+  if ( nofPrimaries == 0 ) return;
+
+  G4cout
+    << G4endl
+    << " ----> isotropy of the source for " << nofPrimaries << " primaries"
+    << G4endl << G4endl;
+
+  std::ofstream summary("isotropy_summary.dat", std::ios::app);
+  summary << "# run primaries map(chi2 ndf p)";
+  for ( auto name : { "px", "py", "pz", "phi" } ) {
+    summary << " " << name << "(chi2 ndf p KS_distance KS_p)";
+  }
+  summary << "\n" << runID << " " << nofPrimaries;
+
+  // all bins are equally probable
+  auto test = [&](const std::vector<std::uint32_t>& counts, const char* name, G4bool ks) {
+    std::vector<G4long> observed(counts.begin(), counts.end());
+    std::vector<G4double> probabilities(counts.size(), 1./counts.size());
+    G4int ndf = 0;
+    auto chi2 = Statistics::ChiSquare(observed, probabilities, ndf);
+    auto probability = Statistics::ChiSquareProbability(chi2, ndf);
+
+    G4cout
+      << " " << std::setw(16) << std::left << name << std::right
+      << ": chi2/ndf " << chi2 << "/" << ndf << ", p = " << probability;
+    summary << " " << chi2 << " " << ndf << " " << probability;
+    if ( ks ) {
+      // largest distance between the cumulative distributions at the bin edges
+      G4double distance = 0.;
+      G4long cumulative = 0;
+      for ( std::size_t i=0; i<counts.size(); ++i ) {
+        cumulative += counts[i];
+        distance = std::max(distance, std::fabs(G4double(cumulative)/nofPrimaries
+                                                 - G4double(i+1)/counts.size()));
+      }
+      auto ksProbability = Statistics::KolmogorovProbability(distance, nofPrimaries);
+      G4cout << "; KS distance " << distance << ", p = " << ksProbability;
+      summary << " " << distance << " " << ksProbability;
+    }
+    G4cout << G4endl;
+  };
+
+  test(fDirectionMap, "(cos theta, phi)", false);
+  const char* names[kNofComponents] = { "px", "py", "pz (cos theta)", "phi" };
+  for ( G4int component=0; component<kNofComponents; ++component ) {
+    test(fDirections[component], names[component], true);
+  }
+  summary << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::WriteEntryMaps() const
+{
+  if ( fEntryMaps[kDiodeDetector].GetNofEntries() == 0
+       && fEntryMaps[kAnnularDetector].GetNofEntries() == 0 ) return;
+
+  G4cout << G4endl << " ----> entries of the primaries into the detectors" << G4endl << G4endl;
+
+  const char* names[kNofDetectors] = { "diode", "annular" };
+  std::ofstream file("entry_maps.dat", std::ios::app);
+  for ( G4int detector=0; detector<kNofDetectors; ++detector ) {
+    fEntryMaps[detector].Print(names[detector]);
+    fEntryMaps[detector].WriteMaps(file, runID, names[detector]);
+  }
+
+  G4cout << " Entry maps written to entry_maps.dat" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -2,19 +2,50 @@
 /// \brief Implementation of the B4::RunAction class
 
 #include "RunAction.hh"
+#include "AcceptanceMap.hh"
+#include "CalorHit.hh"
+#include "Checkpoint.hh"
+#include "ColumnarWriter.hh"
+#include "DetectorConstruction.hh"
+#include "EventAction.hh"
+#include "EnergyBudget.hh"
+#include "GeometryValidator.hh"
+#include "LayoutOptimiser.hh"
+#include "MemoryReport.hh"
+#include "RandomEngine.hh"
+#include "ResponseMatrix.hh"
+#include "Run.hh"
+#include "RunMonitor.hh"
+#include "RunProgress.hh"
 
 #include "G4AnalysisManager.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 
 namespace B4
 {
 
+namespace
+{
+// ntuple baskets: each thread holds one per column, the merged ntuple
+// rows are sent to the master in batches
+constexpr unsigned int kBasketSize = 8000;     // bytes
+constexpr unsigned int kBasketEntries = 1000;
+constexpr G4int kNofNtupleColumns = 4;
+
+// H1 bins: each thread holds a copy of every H1, at about 85 bytes per bin;
+// the energy spectra keep 10 keV bins, the other H1s are coarser
+constexpr G4int kNofSpectrumBins = 1000;
+constexpr G4int kNofCoarseBins = 200;
+}
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-RunAction::RunAction()
+RunAction::RunAction(B4c::EventAction* eventAction)
+  : fEventAction(eventAction)
 {
   // set printing event number per each event
   G4RunManager::GetRunManager()->SetPrintProgress(1);
@@ -27,15 +58,27 @@ RunAction::RunAction()
   // Create directories
   analysisManager->SetVerboseLevel(1);
   analysisManager->SetNtupleMerging(true); // Note: merging ntuples is available only with Root output
+  analysisManager->SetBasketSize(kBasketSize);
+  analysisManager->SetBasketEntries(kBasketEntries);
 
   // Book histograms, ntuple
 
   // Creating histograms
-  analysisManager->CreateH1("Ediode","Edep in diode", 1000, 0., 10*MeV);
-  analysisManager->CreateH1("Eannular","Edep in Annular detector", 1000, 0., 10*MeV);
+  analysisManager->CreateH1("Ediode","Edep in diode", kNofSpectrumBins, 0., 10*MeV);
+  analysisManager->CreateH1("Eannular","Edep in Annular detector", kNofSpectrumBins, 0., 10*MeV);
 
-  analysisManager->CreateH1("Ldiode","trackL in diode", 1000, 0., 1*mm);
-  analysisManager->CreateH1("Lannular","trackL in Annular detector", 1000, 0., 1*mm);
+  analysisManager->CreateH1("Ldiode","trackL in diode", kNofCoarseBins, 0., 1*mm);
+  analysisManager->CreateH1("Lannular","trackL in Annular detector", kNofCoarseBins, 0., 1*mm);
+
+  // Digitised energies of the detector response
+  analysisManager->CreateH1("Ediode_digi","Digitised energy in diode", kNofSpectrumBins, 0., 10*MeV);
+  analysisManager->CreateH1("Eannular_digi","Digitised energy in Annular detector", kNofSpectrumBins, 0., 10*MeV);
+
+  // Energy budget per volume
+  for ( G4int i=0; i<B4c::EnergyBudget::kNofVolumes; ++i ) {
+    G4String name = B4c::EnergyBudget::GetName(i);
+    analysisManager->CreateH1("Ebudget_" + name, "Edep in " + name, kNofCoarseBins, 0., 10*MeV);
+  }
 
   // Creating ntuple
   analysisManager->CreateNtuple("B4", "Edep and TrackL");
@@ -47,22 +90,78 @@ RunAction::RunAction()
   analysisManager->CreateNtupleDColumn("Lannular");
 
   analysisManager->FinishNtuple();
+
+  fCheckpoint = new B4c::Checkpoint;
+  if ( fEventAction ) fEventAction->SetCheckpoint(fCheckpoint);
+
+  fColumnarWriter = new B4c::ColumnarWriter;
+  if ( fEventAction ) fEventAction->SetColumnarWriter(fColumnarWriter);
+  fCheckpoint->SetColumnarWriter(fColumnarWriter);
+
+  fAcceptanceMap = new B4c::AcceptanceMap;
+  if ( fEventAction ) fEventAction->SetAcceptanceMap(fAcceptanceMap);
+
+  if ( G4Threading::IsMasterThread() ) {
+    B4c::MemoryReport::Instance();   // its commands are defined on the master
+    fMonitor = new B4c::RunMonitor;
+    fResponseMatrix = new B4c::ResponseMatrix;
+    fLayoutOptimiser = new B4c::LayoutOptimiser;
+    fGeometryValidator = new B4c::GeometryValidator;
+    fRandomEngine = new B4c::RandomEngine;
+  }
 }
 
 RunAction::~RunAction()
 {
+  delete fCheckpoint;
+  delete fColumnarWriter;
+  delete fMonitor;
+  delete fResponseMatrix;
+  delete fLayoutOptimiser;
+  delete fGeometryValidator;
+  delete fRandomEngine;
+  delete fAcceptanceMap;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::BeginOfRunAction(const G4Run* /*run*/)
+G4Run* RunAction::GenerateRun()
 {
+  return new B4c::Run;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunAction::BeginOfRunAction(const G4Run* run)
+{
+  fTimer.Start();
+
+  // reset the shared progress counters before the workers start
+  if ( isMaster ) B4c::RunProgress::Instance()->Reset();
+
+  // restore an interrupted run, save the master state
+  fCheckpoint->BeginOfRun();
+
+  if ( fMonitor ) fMonitor->Start(run->GetRunID());
+  if ( fRandomEngine ) fRandomEngine->BeginOfRun();
+  B4c::DetectorConstruction::CheckFieldMap();
+
+  // the workers are initialised: record their structures
+  auto memoryReport = B4c::MemoryReport::Instance();
+  if ( isMaster ) memoryReport->BeginOfRun();
+  else if ( memoryReport->IsEnabled() ) {
+    memoryReport->Record(B4c::MemoryReport::kInitialisation, MeasureMemory(run));
+  }
+
   //inform the runManager to save random number seed
   //G4RunManager::GetRunManager()->SetRandomNumberStore(true);
 
   // Get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
+  // the runs of an internal scan write no output files
+  auto internalScan = B4c::RunProgress::Instance()->IsInternalScan();
+
   // Open output file of different types
 
   G4String fileName = "B4.root";          // Root
@@ -70,17 +169,51 @@ void RunAction::BeginOfRunAction(const G4Run* /*run*/)
   // G4String fileName = "B4.hdf5";       // HDF5 file
   // G4String fileName = "B4.xml";        // XML file
 
-  analysisManager->OpenFile(fileName);
-  G4cout << "Using " << analysisManager->GetType() << G4endl;
+  if ( ! internalScan ) {
+    analysisManager->OpenFile(fileName);
+    G4cout << "Using " << analysisManager->GetType() << G4endl;
+
+    // columnar files: the master removes those of the previous run, but the
+    // parts of an interrupted run which is resumed
+    if ( isMaster ) fColumnarWriter->RemoveFiles(fCheckpoint->HasRestored());
+    if ( fEventAction ) fColumnarWriter->Open(run->GetRunID());
+  }
+
+  if ( fEventAction ) fEventAction->BeginOfRun();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::EndOfRunAction(const G4Run* /*run*/)
+void RunAction::EndOfRunAction(const G4Run* run)
 {
+  fTimer.Stop();
+
+  if ( fMonitor ) fMonitor->Stop();
+
+  if ( fEventAction ) fEventAction->EndOfRun();
+  if ( fEventAction ) fColumnarWriter->Close();
+
+  // add the data restored from an interrupted run
+  if ( isMaster ) {
+    fCheckpoint->EndOfRun(
+      static_cast<B4c::Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun()));
+  }
+
+  // spectra of a response matrix grid point
+  if ( fResponseMatrix ) fResponseMatrix->EndOfRun(static_cast<const B4c::Run*>(run));
+
+  // efficiency of a candidate layout
+  if ( fLayoutOptimiser ) fLayoutOptimiser->EndOfRun(static_cast<const B4c::Run*>(run));
+
+  // acceptance map of the grid
+  if ( isMaster ) fAcceptanceMap->EndOfRun(static_cast<const B4c::Run*>(run));
+
+  // the runs of an internal scan only fill the above
+  auto internalScan = B4c::RunProgress::Instance()->IsInternalScan();
+
   // print histogram statistics
   auto analysisManager = G4AnalysisManager::Instance();
-  if ( analysisManager->GetH1(1) ) {
+  if ( ! internalScan && analysisManager->GetH1(1) ) {
     G4cout << G4endl << " ----> print histograms statistic ";
     if(isMaster) {
       G4cout << "for the entire run " << G4endl << G4endl;
@@ -108,11 +241,58 @@ void RunAction::EndOfRunAction(const G4Run* /*run*/)
      << G4BestUnit(analysisManager->GetH1(3)->mean(), "Length")
      << " rms = "
      << G4BestUnit(analysisManager->GetH1(3)->rms(),  "Length") << G4endl;
+
+    // digitised spectra, filled only when the detector response is enabled
+    for ( const char* name : { "Ediode_digi", "Eannular_digi" } ) {
+      auto histo = analysisManager->GetH1(analysisManager->GetH1Id(name));
+      if ( ! histo || histo->entries() == 0 ) continue;
+      G4cout << " " << name << " : entries = " << histo->entries()
+       << " mean = " << G4BestUnit(histo->mean(), "Energy")
+       << " rms = " << G4BestUnit(histo->rms(),  "Energy") << G4endl;
+    }
+  }
+
+  // print energy budget and stacking statistics for the entire run
+  if ( isMaster && ! internalScan ) {
+    static_cast<const B4c::Run*>(run)->EndOfRun(fTimer.GetRealElapsed());
   }
 
-  // save histograms & ntuple
-  analysisManager->Write();
-  analysisManager->CloseFile();
+  // save histograms & ntuple; those of an internal scan are discarded
+  if ( internalScan ) {
+    analysisManager->Reset();
+  }
+  else {
+    analysisManager->Write();
+    analysisManager->CloseFile();
+  }
+
+  if ( isMaster ) fCheckpoint->CompleteRun();
+
+  // the workers end their run before the master
+  auto memoryReport = B4c::MemoryReport::Instance();
+  if ( memoryReport->IsEnabled() ) {
+    memoryReport->Record(B4c::MemoryReport::kEndOfRun, MeasureMemory(run));
+    if ( isMaster ) memoryReport->EndOfRun(run->GetRunID());
+  }
+
+  // the hits of the run are deleted: release the pages of their pool,
+  // unless events are kept (e.g. for visualisation)
+  auto keptEvents = run->GetEventVector();
+  if ( B4c::CalorHitAllocator && ( ! keptEvents || keptEvents->empty() ) ) {
+    B4c::CalorHitAllocator->ResetStorage();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+B4c::MemoryReport::Usage RunAction::MeasureMemory(const G4Run* run) const
+{
+  // the master merges the rows of the workers
+  std::size_t ntupleBytes = std::size_t(kNofNtupleColumns)*kBasketSize;
+  if ( isMaster && G4Threading::IsMultithreadedApplication() ) {
+    ntupleBytes += std::size_t(kNofNtupleColumns)*kBasketEntries*sizeof(G4double);
+  }
+  return B4c::MemoryReport::Measure(static_cast<const B4c::Run*>(run), ntupleBytes);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,279 @@
+/// \file RunMonitor.cc
+/// \brief Implementation of the B4c::RunMonitor class
+
+#include "RunMonitor.hh"
+#include "RunProgress.hh"
+
+#include "G4GenericMessenger.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define B4_MONITOR_SOCKET 1
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunMonitor::RunMonitor()
+{
+  // the monitor runs on the master only
+  fMessenger = new G4GenericMessenger(this, "/B4/monitor/", "Live run monitoring");
+
+  fMessenger->DeclareProperty("enable", fEnabled)
+    .SetGuidance("Write a snapshot of the run progress periodically.")
+    .SetParameterName("enable", true)
+    .SetDefaultValue("true")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("period", fPeriod)
+    .SetGuidance("Time between two snapshots, in seconds.")
+    .SetParameterName("period", false)
+    .SetRange("period>0.")
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("fileName", fFileName)
+    .SetGuidance("Snapshot file name.")
+    .SetParameterName("fileName", false)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("socket", fSocketPath)
+    .SetGuidance("Path of a local Unix socket serving the snapshot.")
+    .SetGuidance("An empty path disables the socket.")
+    .SetParameterName("socket", true)
+    .SetDefaultValue("")
+    .SetToBeBroadcasted(false);
+}
+
+RunMonitor::~RunMonitor()
+{
+  Stop();
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::Start(G4int runID)
+{
+  if ( ! fEnabled || fThread.joinable() ) return;
+
+  fRunID = runID;
+  fStartTime = fLastTime = Clock::now();
+  fLastEvents = 0;
+  fLastSteps = 0;
+  fStop = false;
+
+  fSnapshot = MakeSnapshot(false);
+  if ( ! fSocketPath.empty() ) OpenSocket();
+
+  fThread = std::thread(&RunMonitor::Loop, this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::Stop()
+{
+  if ( ! fThread.joinable() ) return;
+
+  fStop = true;
+  fThread.join();
+
+  // final snapshot of the run
+  WriteSnapshot(MakeSnapshot(true));
+  CloseSocket();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::Loop()
+{
+  const auto tick = std::chrono::milliseconds(100);
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<G4double>(fPeriod));
+  auto next = Clock::now() + period;
+
+  while ( ! fStop ) {
+    if ( Clock::now() >= next ) {
+      auto snapshot = MakeSnapshot(false);
+      WriteSnapshot(snapshot);
+      {
+        std::lock_guard<std::mutex> lock(fSnapshotMutex);
+        fSnapshot = snapshot;
+      }
+      next = Clock::now() + period;
+    }
+    ServeClients();
+    std::this_thread::sleep_for(tick);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String RunMonitor::MakeSnapshot(G4bool finished)
+{
+  auto progress = RunProgress::Instance();
+  auto totals = progress->GetTotals();
+
+  auto now = Clock::now();
+  G4double elapsed = std::chrono::duration<G4double>(now - fStartTime).count();
+  G4double interval = std::chrono::duration<G4double>(now - fLastTime).count();
+
+  // rates since the previous snapshot
+  G4double eventRate = ( interval > 0. ) ? (totals.events - fLastEvents)/interval : 0.;
+  G4double stepRate  = ( interval > 0. ) ? (totals.steps - fLastSteps)/interval : 0.;
+  fLastTime = now;
+  fLastEvents = totals.events;
+  fLastSteps = totals.steps;
+
+  std::ostringstream os;
+  os << std::setprecision(6)
+     << "{\n"
+     << "  \"run\": " << fRunID << ",\n"
+     << "  \"state\": \"" << ( finished ? "finished" : "running" ) << "\",\n"
+     << "  \"elapsed_s\": " << elapsed << ",\n"
+     << "  \"events\": " << totals.events << ",\n"
+     << "  \"events_per_s\": " << eventRate << ",\n"
+     << "  \"steps\": " << totals.steps << ",\n"
+     << "  \"steps_per_s\": " << stepRate << ",\n"
+     << "  \"rss_bytes\": " << GetResidentMemory() << ",\n";
+
+  // slot 0 is the master (sequential mode, or events restored by a resume)
+  os << "  \"threads\": [";
+  G4bool first = true;
+  for ( G4int i=0; i<RunProgress::kMaxSlots; ++i ) {
+    auto events = progress->GetSlot(i).events.load(std::memory_order_relaxed);
+    if ( events == 0 ) continue;
+    os << ( first ? "\n" : ",\n" )
+       << "    { \"thread\": " << i-1 << ", \"events\": " << events << " }";
+    first = false;
+  }
+  os << ( first ? "],\n" : "\n  ],\n" );
+
+  // efficiencies in %, with binomial errors
+  const char* names[] = { "diode", "annular", "collective" };
+  G4long counts[] = { totals.diode, totals.annular, totals.collective };
+
+  os << "  \"efficiency\": {\n";
+  for ( G4int i=0; i<3; ++i ) {
+    G4double efficiency = 0., error = 0.;
+    if ( totals.events > 0 ) {
+      efficiency = G4double(counts[i])/totals.events;
+      error = std::sqrt(efficiency*(1. - efficiency)/totals.events);
+    }
+    os << "    \"" << names[i] << "\": { \"value\": " << 100.*efficiency
+       << ", \"error\": " << 100.*error << ", \"detected\": " << counts[i] << " }"
+       << ( i < 2 ? ",\n" : "\n" );
+  }
+  os << "  }\n"
+     << "}\n";
+
+  return os.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::WriteSnapshot(const G4String& snapshot) const
+{
+  // readers never see a partial file
+  auto tmpName = fFileName + ".tmp";
+  {
+    std::ofstream os(tmpName.c_str());
+    os << snapshot;
+  }
+  std::rename(tmpName.c_str(), fFileName.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4long RunMonitor::GetResidentMemory()
+{
+#ifdef __linux__
+  // second field of statm: resident set size in pages
+  std::ifstream statm("/proc/self/statm");
+  G4long size = 0, resident = 0;
+  if ( statm >> size >> resident ) return resident*sysconf(_SC_PAGESIZE);
+#endif
+  return -1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::OpenSocket()
+{
+#ifdef B4_MONITOR_SOCKET
+  sockaddr_un address{};
+  if ( fSocketPath.size() >= sizeof(address.sun_path) ) {
+    G4ExceptionDescription msg;
+    msg << "Socket path " << fSocketPath << " is too long, socket disabled.";
+    G4Exception("RunMonitor::OpenSocket()", "MyCode0009", JustWarning, msg);
+    return;
+  }
+  address.sun_family = AF_UNIX;
+  std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", fSocketPath.c_str());
+
+  unlink(fSocketPath.c_str());
+  fSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ( fSocket < 0 ||
+       bind(fSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+       listen(fSocket, 8) != 0 ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot listen on socket " << fSocketPath << ", socket disabled.";
+    G4Exception("RunMonitor::OpenSocket()", "MyCode0009", JustWarning, msg);
+    CloseSocket();
+    return;
+  }
+  fcntl(fSocket, F_SETFL, fcntl(fSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::ServeClients()
+{
+#ifdef B4_MONITOR_SOCKET
+  if ( fSocket < 0 ) return;
+
+  G4String snapshot;
+  {
+    std::lock_guard<std::mutex> lock(fSnapshotMutex);
+    snapshot = fSnapshot;
+  }
+
+  // each client receives the latest snapshot and is disconnected
+  G4int client;
+  while ( (client = accept(fSocket, nullptr, nullptr)) >= 0 ) {
+#ifdef MSG_NOSIGNAL
+    send(client, snapshot.data(), snapshot.size(), MSG_NOSIGNAL);
+#else
+    send(client, snapshot.data(), snapshot.size(), 0);
+#endif
+    close(client);
+  }
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunMonitor::CloseSocket()
+{
+#ifdef B4_MONITOR_SOCKET
+  if ( fSocket < 0 ) return;
+  close(fSocket);
+  unlink(fSocketPath.c_str());
+  fSocket = -1;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
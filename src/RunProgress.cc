@@ -0,0 +1,106 @@
+/// \file RunProgress.cc
+/// \brief Implementation of the B4c::RunProgress class
+
+#include "RunProgress.hh"
+
+#include "G4Threading.hh"
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunProgress* RunProgress::Instance()
+{
+  static RunProgress instance;
+  return &instance;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunProgress::Reset()
+{
+  for ( auto& slot : fSlots ) {
+    slot.events.store(0, std::memory_order_relaxed);
+    slot.diode.store(0, std::memory_order_relaxed);
+    slot.annular.store(0, std::memory_order_relaxed);
+    slot.collective.store(0, std::memory_order_relaxed);
+    slot.steps.store(0, std::memory_order_relaxed);
+  }
+  fStopReason.store(kNotStopped, std::memory_order_relaxed);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunProgress::Slot& RunProgress::GetSlot()
+{
+  // the master (or sequential) thread ID is -1, the workers from 0
+  auto index = G4Threading::G4GetThreadId() + 1;
+  if ( index < 0 || index >= kMaxSlots ) {
+    G4ExceptionDescription msg;
+    msg << "Thread ID " << index-1 << " exceeds the number of progress slots.";
+    G4Exception("RunProgress::GetSlot()", "MyCode0007", FatalException, msg);
+  }
+  return fSlots[index];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+RunProgress::Totals RunProgress::GetTotals() const
+{
+  Totals totals;
+  for ( const auto& slot : fSlots ) {
+    totals.events     += slot.events.load(std::memory_order_relaxed);
+    totals.diode      += slot.diode.load(std::memory_order_relaxed);
+    totals.annular    += slot.annular.load(std::memory_order_relaxed);
+    totals.collective += slot.collective.load(std::memory_order_relaxed);
+    totals.steps      += slot.steps.load(std::memory_order_relaxed);
+  }
+  return totals;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunProgress::Preload(const Totals& totals)
+{
+  auto& slot = fSlots[0];
+  slot.Increment(slot.events, totals.events);
+  slot.Increment(slot.diode, totals.diode);
+  slot.Increment(slot.annular, totals.annular);
+  slot.Increment(slot.collective, totals.collective);
+  slot.Increment(slot.steps, totals.steps);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RunProgress::AddEvent(Slot& slot, G4bool diode, G4bool annular, G4long steps)
+{
+  slot.Increment(slot.events);
+  slot.Increment(slot.steps, steps);
+  if ( diode ) slot.Increment(slot.diode);
+  if ( annular ) slot.Increment(slot.annular);
+  if ( diode || annular ) slot.Increment(slot.collective);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool RunProgress::RequestStop(StopReason reason)
+{
+  G4int expected = kNotStopped;
+  return fStopReason.compare_exchange_strong(expected, reason);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* RunProgress::GetStopReasonName(StopReason reason)
+{
+  switch ( reason ) {
+    case kPrecisionReached: return "precision";
+    case kMaxEventsReached: return "maxEvents";
+    default:                return "beamOn";
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
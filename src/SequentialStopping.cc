@@ -0,0 +1,117 @@
+/// \file SequentialStopping.cc
+/// \brief Implementation of the B4c::SequentialStopping class
+
+#include "SequentialStopping.hh"
+
+#include "G4GenericMessenger.hh"
+
+#include <cfloat>
+#include <cmath>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SequentialStopping::SequentialStopping()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/stopping/", "Sequential stopping of the run");
+
+  fMessenger->DeclareProperty("precision", fPrecision)
+    .SetGuidance("Stop the run when the relative error of the efficiency is below this value.")
+    .SetGuidance("0 disables the precision criterion.")
+    .SetParameterName("precision", false)
+    .SetRange("precision>=0.");
+
+  fMessenger->DeclareProperty("efficiency", fEfficiency)
+    .SetGuidance("Efficiency used by the precision criterion.")
+    .SetParameterName("efficiency", false)
+    .SetCandidates("diode annular collective");
+
+  fMessenger->DeclareProperty("checkInterval", fCheckInterval)
+    .SetGuidance("Number of events of each thread between two checks.")
+    .SetParameterName("checkInterval", false)
+    .SetRange("checkInterval>0");
+
+  fMessenger->DeclareProperty("minEvents", fMinEvents)
+    .SetGuidance("Minimum total number of events before the precision criterion applies.")
+    .SetParameterName("minEvents", false)
+    .SetRange("minEvents>=0");
+
+  fMessenger->DeclareProperty("maxEvents", fMaxEvents)
+    .SetGuidance("Stop the run when the total number of events reaches this value.")
+    .SetGuidance("0 leaves the number of events of /run/beamOn as the only limit.")
+    .SetParameterName("maxEvents", false)
+    .SetRange("maxEvents>=0");
+}
+
+SequentialStopping::~SequentialStopping()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SequentialStopping::BeginOfRun()
+{
+  fEventsSinceCheck = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SequentialStopping::RelativeError(G4long k, G4long n)
+{
+  if ( k <= 0 || n <= 0 ) return DBL_MAX;
+
+  auto p = G4double(k)/n;
+  return std::sqrt((1. - p)/k);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4long SequentialStopping::GetDetected(const RunProgress::Totals& totals) const
+{
+  if ( fEfficiency == "diode" ) return totals.diode;
+  if ( fEfficiency == "annular" ) return totals.annular;
+  return totals.collective;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SequentialStopping::Check(RunProgress* progress)
+{
+  // a stop requested by any thread
+  if ( progress->IsStopRequested() ) return true;
+
+  if ( ! IsEnabled() ) return false;
+  if ( ++fEventsSinceCheck < fCheckInterval ) return false;
+  fEventsSinceCheck = 0;
+
+  auto totals = progress->GetTotals();
+
+  if ( fMaxEvents > 0 && totals.events >= fMaxEvents ) {
+    if ( progress->RequestStop(RunProgress::kMaxEventsReached) ) {
+      G4cout << "--> Stopping the run: " << totals.events
+             << " events reach the cap of " << fMaxEvents << G4endl;
+    }
+    return true;
+  }
+
+  if ( fPrecision > 0. && totals.events >= fMinEvents ) {
+    auto relativeError = RelativeError(GetDetected(totals), totals.events);
+    if ( relativeError <= fPrecision ) {
+      if ( progress->RequestStop(RunProgress::kPrecisionReached) ) {
+        G4cout << "--> Stopping the run: relative error of the " << fEfficiency
+               << " efficiency " << relativeError << " after " << totals.events
+               << " events (target " << fPrecision << ")" << G4endl;
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
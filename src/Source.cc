@@ -0,0 +1,342 @@
+/// \file Source.cc
+/// \brief Implementation of the B4c::Source class
+
+#include "Source.hh"
+#include "Statistics.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4UnitsTable.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Source::Source()
+{
+  DefineCommands();
+  BuildRings();
+}
+
+Source::~Source()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/source/", "Source shape and spectrum");
+
+  fMessenger->DeclareMethod("shape", &Source::SetShape)
+    .SetGuidance("Shape of the source around the gun position:")
+    .SetGuidance("  point, disk (in the xy plane) or volume (cylinder along z).")
+    .SetParameterName("shape", false)
+    .SetCandidates("point disk volume");
+
+  fMessenger->DeclareMethodWithUnit("radius", "mm", &Source::SetRadius)
+    .SetGuidance("Radius of the disk or volume source.")
+    .SetParameterName("radius", false)
+    .SetRange("radius>=0.");
+
+  fMessenger->DeclarePropertyWithUnit("thickness", "mm", fThickness)
+    .SetGuidance("Thickness along z of the volume source.")
+    .SetParameterName("thickness", false)
+    .SetRange("thickness>=0.");
+
+  fMessenger->DeclareMethod("spectrum", &Source::SetSpectrum)
+    .SetGuidance("Read the energy spectrum from a file, \"none\" for the gun energy.")
+    .SetGuidance("Each line is a line \"E weight\" or a bin \"Elow Ehigh weight\", in MeV.")
+    .SetParameterName("fileName", false);
+
+  fMessenger->DeclareMethod("radialProfile", &Source::SetRadialProfile)
+    .SetGuidance("Read the radial activity profile from a file, \"none\" for uniform.")
+    .SetGuidance("Each line is \"r(mm) weight\", interpolated linearly.")
+    .SetParameterName("fileName", false);
+
+  fMessenger->DeclareMethod("selfTest", &Source::SelfTest)
+    .SetGuidance("Sample the source and test the distributions.")
+    .SetGuidance("In MT mode, it runs on the first worker with /run/workersProcessCmds.")
+    .SetParameterName("nofSamples", true)
+    .SetDefaultValue("1000000")
+    .SetRange("nofSamples>0");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::SetShape(const G4String& shape)
+{
+  if ( shape == "point" ) fShape = kPoint;
+  else if ( shape == "disk" ) fShape = kDisk;
+  else fShape = kVolume;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::SetRadius(G4double radius)
+{
+  fRadius = radius;
+  BuildRings();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::SetSpectrum(const G4String& fileName)
+{
+  fEntries.clear();
+  fEnergyTable.Clear();
+  if ( fileName == "none" ) return;
+
+  std::vector<G4double> weights;
+  if ( ! ReadSpectrum(fileName, fEntries, weights) || ! fEnergyTable.Build(weights) ) {
+    fEntries.clear();
+    G4ExceptionDescription msg;
+    msg << "Cannot read an energy spectrum from " << fileName
+        << ", the gun energy is used.";
+    G4Exception("Source::SetSpectrum()", "MyCode0011", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool Source::ReadSpectrum(const G4String& fileName, std::vector<Entry>& entries,
+                            std::vector<G4double>& weights)
+{
+  entries.clear();
+  weights.clear();
+
+  std::ifstream file(fileName.c_str());
+  std::string line;
+  while ( std::getline(file, line) ) {
+    auto comment = line.find('#');
+    if ( comment != std::string::npos ) line.erase(comment);
+
+    std::istringstream is(line);
+    std::vector<G4double> values;
+    G4double value;
+    while ( is >> value ) values.push_back(value);
+    if ( values.empty() ) continue;
+
+    if ( values.size() == 2 ) {
+      entries.push_back({ values[0]*MeV, values[0]*MeV });
+    }
+    else if ( values.size() == 3 && values[1] > values[0] ) {
+      entries.push_back({ values[0]*MeV, values[1]*MeV });
+    }
+    else {
+      entries.clear();
+      weights.clear();
+      return false;
+    }
+    weights.push_back(values.back());
+  }
+
+  return ! entries.empty();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::SetRadialProfile(const G4String& fileName)
+{
+  fProfileRadii.clear();
+  fProfileWeights.clear();
+
+  if ( fileName != "none" ) {
+    std::ifstream file(fileName.c_str());
+    std::string line;
+    G4double radius, weight;
+    while ( std::getline(file, line) ) {
+      auto comment = line.find('#');
+      if ( comment != std::string::npos ) line.erase(comment);
+      std::istringstream is(line);
+      if ( ! (is >> radius >> weight) ) continue;
+      if ( weight < 0. || ( ! fProfileRadii.empty() && radius*mm <= fProfileRadii.back() ) ) {
+        fProfileRadii.clear();
+        break;
+      }
+      fProfileRadii.push_back(radius*mm);
+      fProfileWeights.push_back(weight);
+    }
+
+    if ( fProfileRadii.empty() ) {
+      fProfileWeights.clear();
+      G4ExceptionDescription msg;
+      msg << "Cannot read a radial profile from " << fileName
+          << " (increasing radii, positive weights), the source is uniform.";
+      G4Exception("Source::SetRadialProfile()", "MyCode0011", JustWarning, msg);
+    }
+  }
+
+  BuildRings();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double Source::GetProfile(G4double radius) const
+{
+  if ( fProfileRadii.empty() ) return 1.;
+
+  auto upper = std::upper_bound(fProfileRadii.begin(), fProfileRadii.end(), radius);
+  if ( upper == fProfileRadii.begin() ) return fProfileWeights.front();
+  if ( upper == fProfileRadii.end() ) return fProfileWeights.back();
+
+  auto i = std::size_t(upper - fProfileRadii.begin());
+  G4double t = (radius - fProfileRadii[i-1])/(fProfileRadii[i] - fProfileRadii[i-1]);
+  return (1. - t)*fProfileWeights[i-1] + t*fProfileWeights[i];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::BuildRings()
+{
+  // rings of equal width, weighted by their area and the profile; the
+  // activity is uniform within a ring
+  fRingTable.Clear();
+  if ( fRadius <= 0. ) return;
+
+  std::vector<G4double> weights(kNofRings);
+  for ( G4int i=0; i<kNofRings; ++i ) {
+    G4double rMin = fRadius*i/kNofRings, rMax = fRadius*(i+1)/kNofRings;
+    weights[i] = GetProfile(0.5*(rMin + rMax))*(rMax*rMax - rMin*rMin);
+  }
+
+  if ( ! fRingTable.Build(weights) ) {
+    G4ExceptionDescription msg;
+    msg << "The radial profile is zero over the source radius, the source is a point.";
+    G4Exception("Source::BuildRings()", "MyCode0011", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double Source::GetRadialCDF(G4double radius) const
+{
+  if ( radius <= 0. ) return 0.;
+  if ( radius >= fRadius ) return 1.;
+
+  G4double x = radius/fRadius*kNofRings;
+  auto ring = G4int(x);
+  G4double cdf = 0.;
+  for ( G4int i=0; i<ring; ++i ) cdf += fRingTable.GetProbability(i);
+
+  G4double rMin = fRadius*ring/kNofRings, rMax = fRadius*(ring+1)/kNofRings;
+  return cdf + fRingTable.GetProbability(ring)
+               *(radius*radius - rMin*rMin)/(rMax*rMax - rMin*rMin);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreeVector Source::SamplePosition() const
+{
+  if ( ! IsExtended() || fRingTable.IsEmpty() ) return G4ThreeVector();
+
+  auto ring = fRingTable.Sample(G4UniformRand());
+  G4double rMin = fRadius*ring/kNofRings, rMax = fRadius*(ring+1)/kNofRings;
+  G4double radius = std::sqrt(rMin*rMin + G4UniformRand()*(rMax*rMax - rMin*rMin));
+  G4double phi = twopi*G4UniformRand();
+  G4double z = ( fShape == kVolume ) ? (G4UniformRand() - 0.5)*fThickness : 0.;
+
+  return G4ThreeVector(radius*std::cos(phi), radius*std::sin(phi), z);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double Source::SampleEnergy() const
+{
+  const auto& entry = fEntries[fEnergyTable.Sample(G4UniformRand())];
+  if ( entry.high == entry.low ) return entry.low;
+  return entry.low + G4UniformRand()*(entry.high - entry.low);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Source::SelfTest(G4int nofSamples)
+{
+  // the command is executed by all workers, one test is enough
+  if ( G4Threading::G4GetThreadId() > 0 ) return;
+
+  G4cout << G4endl << "--------------------Source self-test, " << nofSamples
+         << " samples--------------------" << G4endl;
+
+  auto report = [](const G4String& name, G4double value, G4int ndf, G4double probability) {
+    G4cout << " " << name << " = " << value;
+    if ( ndf >= 0 ) G4cout << " / " << ndf;
+    G4cout << ", p-value = " << probability
+           << ( probability > 1.e-3 ? "  OK" : "  FAILED" ) << G4endl;
+  };
+
+  // energy: frequencies of the spectrum entries
+  if ( HasSpectrum() ) {
+    std::vector<G4long> counts(fEntries.size());
+    std::vector<G4double> probabilities(fEntries.size());
+    for ( std::size_t i=0; i<fEntries.size(); ++i ) {
+      probabilities[i] = fEnergyTable.GetProbability(i);
+    }
+    for ( G4int n=0; n<nofSamples; ++n ) ++counts[fEnergyTable.Sample(G4UniformRand())];
+
+    G4int ndf;
+    auto chi2 = Statistics::ChiSquare(counts, probabilities, ndf);
+    report("energy entries, chi2", chi2, ndf, Statistics::ChiSquareProbability(chi2, ndf));
+  }
+  else {
+    G4cout << " energy: gun energy" << G4endl;
+  }
+
+  // position: radial rings and radial distribution, and depth
+  if ( IsExtended() && ! fRingTable.IsEmpty() ) {
+    std::vector<G4long> counts(kNofRings);
+    std::vector<G4double> probabilities(kNofRings);
+    for ( G4int i=0; i<kNofRings; ++i ) probabilities[i] = fRingTable.GetProbability(i);
+
+    std::vector<G4double> radii(nofSamples), depths(nofSamples);
+    for ( G4int n=0; n<nofSamples; ++n ) {
+      auto position = SamplePosition();
+      radii[n] = position.perp();
+      depths[n] = position.z();
+      ++counts[std::min(G4int(radii[n]/fRadius*kNofRings), kNofRings-1)];
+    }
+
+    G4int ndf;
+    auto chi2 = Statistics::ChiSquare(counts, probabilities, ndf);
+    report("radial rings, chi2", chi2, ndf, Statistics::ChiSquareProbability(chi2, ndf));
+
+    // Kolmogorov-Smirnov distance to the expected cumulative distribution
+    auto distance = [nofSamples](std::vector<G4double>& values, auto cdf) {
+      std::sort(values.begin(), values.end());
+      G4double d = 0.;
+      for ( G4int n=0; n<nofSamples; ++n ) {
+        G4double f = cdf(values[n]);
+        d = std::max({ d, f - G4double(n)/nofSamples, G4double(n+1)/nofSamples - f });
+      }
+      return d;
+    };
+
+    auto d = distance(radii, [this](G4double r) { return GetRadialCDF(r); });
+    report("radius, KS distance", d, -1, Statistics::KolmogorovProbability(d, nofSamples));
+
+    if ( fShape == kVolume && fThickness > 0. ) {
+      d = distance(depths, [this](G4double z) {
+        return std::min(1., std::max(0., z/fThickness + 0.5)); });
+      report("depth, KS distance", d, -1, Statistics::KolmogorovProbability(d, nofSamples));
+    }
+  }
+  else {
+    G4cout << " position: point source" << G4endl;
+  }
+
+  G4cout << "------------------------------------------------------------" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,174 @@
+/// \file StackingAction.cc
+/// \brief Implementation of the B4c::StackingAction class
+
+#include "StackingAction.hh"
+#include "EventAction.hh"
+#include "CalorimeterSD.hh"
+#include "Run.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ParticleTable.hh"
+#include "G4RegionStore.hh"
+#include "G4RunManager.hh"
+#include "G4StackManager.hh"
+#include "G4Track.hh"
+#include "G4UIcommand.hh"
+
+#include <sstream>
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StackingAction::StackingAction(EventAction* eventAction)
+  : fEventAction(eventAction)
+{
+  DefineCommands();
+}
+
+StackingAction::~StackingAction()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::PrepareNewEvent()
+{
+  fRun = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+
+  // The regions are resolved once per run as the geometry may be rebuilt
+  if ( fRun->GetRunID() != fRunID ) {
+    fRunID = fRun->GetRunID();
+    ResolveThresholds();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+{
+  // keep primaries
+  if ( track->GetParentID() == 0 ) return fUrgent;
+
+  fRun->AddStackedSecondary(stackManager->GetNTotalTrack());
+
+  if ( fThresholds.empty() ) return fUrgent;
+
+  auto volume = track->GetVolume();
+  if ( ! volume ) return fUrgent;
+
+  auto logicalVolume = volume->GetLogicalVolume();
+  auto region = logicalVolume->GetRegion();
+  auto particle = track->GetDefinition();
+  auto energy = track->GetKineticEnergy();
+
+  for ( const auto& threshold : fThresholds ) {
+    if ( threshold.particle != particle ) continue;
+    if ( threshold.region && threshold.region != region ) continue;
+    if ( energy >= threshold.energy ) return fUrgent;
+
+    // deposit the kinetic energy locally; the annihilation energy of a
+    // positron is not, as its photons would mostly leave the thin detectors
+    fEventAction->GetEnergyBudget().Add(logicalVolume, energy);
+    auto sd = dynamic_cast<CalorimeterSD*>(logicalVolume->GetSensitiveDetector());
+    if ( sd ) sd->AddEdep(track->GetTouchable(), energy);
+
+    fRun->AddKilledSecondary(energy);
+    return fKill;
+  }
+
+  return fUrgent;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::SetThreshold(const G4String& value)
+{
+  std::istringstream is(value);
+  Threshold threshold;
+  G4double energy = 0.;
+  G4String unit;
+  is >> threshold.particleName >> threshold.regionName >> energy >> unit;
+
+  if ( is.fail() ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot parse threshold \"" << value << "\"" << G4endl
+        << "Expected: <particle> <region|all> <value> <unit>";
+    G4Exception("StackingAction::SetThreshold()", "MyCode0005", JustWarning, msg);
+    return;
+  }
+
+  threshold.particle = G4ParticleTable::GetParticleTable()->FindParticle(threshold.particleName);
+  if ( ! threshold.particle ) {
+    G4ExceptionDescription msg;
+    msg << "Particle " << threshold.particleName << " not found.";
+    G4Exception("StackingAction::SetThreshold()", "MyCode0005", JustWarning, msg);
+    return;
+  }
+  threshold.energy = energy*G4UIcommand::ValueOf(unit.c_str());
+
+  // replace an existing threshold for the same particle and region
+  for ( auto& existing : fThresholds ) {
+    if ( existing.particleName == threshold.particleName &&
+         existing.regionName == threshold.regionName ) {
+      existing = threshold;
+      fRunID = -1;
+      return;
+    }
+  }
+
+  // thresholds for a given region are checked before the "all" ones
+  if ( threshold.regionName == "all" ) {
+    fThresholds.push_back(threshold);
+  }
+  else {
+    fThresholds.insert(fThresholds.begin(), threshold);
+  }
+  fRunID = -1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::ClearThresholds()
+{
+  fThresholds.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::ResolveThresholds()
+{
+  for ( auto& threshold : fThresholds ) {
+    threshold.region = nullptr;
+    if ( threshold.regionName == "all" ) continue;
+
+    threshold.region = G4RegionStore::GetInstance()->GetRegion(threshold.regionName, false);
+    if ( ! threshold.region ) {
+      G4ExceptionDescription msg;
+      msg << "Region " << threshold.regionName << " not found, "
+          << "the " << threshold.particleName << " threshold is applied in all regions.";
+      G4Exception("StackingAction::ResolveThresholds()", "MyCode0006", JustWarning, msg);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingAction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/stack/", "Secondary stacking control");
+
+  fMessenger->DeclareMethod("threshold", &StackingAction::SetThreshold)
+    .SetGuidance("Kill secondaries below an energy threshold and deposit their energy locally.")
+    .SetGuidance("  <particle> <region|all> <value> <unit>, e.g. e- Hamamatsu 20 keV")
+    .SetParameterName("threshold", false);
+
+  fMessenger->DeclareMethod("clearThresholds", &StackingAction::ClearThresholds)
+    .SetGuidance("Remove all the stacking thresholds.");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
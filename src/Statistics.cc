@@ -0,0 +1,108 @@
+/// \file Statistics.cc
+/// \brief Implementation of the B4c statistical tests
+
+#include "Statistics.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace B4c
+{
+namespace Statistics
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ChiSquareProbability(G4double chi2, G4int ndf)
+{
+  // regularised upper incomplete gamma function Q(ndf/2, chi2/2)
+  if ( ndf <= 0 ) return 1.;
+  if ( chi2 <= 0. ) return 1.;
+
+  G4double a = 0.5*ndf, x = 0.5*chi2;
+  G4double logPrefactor = -x + a*std::log(x) - std::lgamma(a);
+
+  if ( x < a + 1. ) {
+    // series of P(a,x)
+    G4double term = 1./a, sum = term;
+    for ( G4int n=1; n<1000 && std::fabs(term) > std::fabs(sum)*1.e-15; ++n ) {
+      term *= x/(a + n);
+      sum += term;
+    }
+    return 1. - sum*std::exp(logPrefactor);
+  }
+
+  // continued fraction of Q(a,x), modified Lentz method
+  const G4double tiny = 1.e-300;
+  G4double b = x + 1. - a, c = 1./tiny, d = 1./b, h = d;
+  for ( G4int n=1; n<1000; ++n ) {
+    G4double an = -n*(n - a);
+    b += 2.;
+    d = an*d + b;
+    if ( std::fabs(d) < tiny ) d = tiny;
+    c = b + an/c;
+    if ( std::fabs(c) < tiny ) c = tiny;
+    d = 1./d;
+    G4double delta = d*c;
+    h *= delta;
+    if ( std::fabs(delta - 1.) < 1.e-15 ) break;
+  }
+  return h*std::exp(logPrefactor);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ChiSquare(const std::vector<G4long>& observed,
+                   const std::vector<G4double>& probabilities, G4int& ndf)
+{
+  G4long total = 0;
+  for ( auto count : observed ) total += count;
+
+  G4double chi2 = 0.;
+  G4double lowExpected = 0., lowObserved = 0.;
+  G4int nofBins = 0;
+  for ( std::size_t i=0; i<observed.size(); ++i ) {
+    G4double expected = probabilities[i]*total;
+    if ( expected < 5. ) {
+      lowExpected += expected;
+      lowObserved += observed[i];
+      continue;
+    }
+    chi2 += (observed[i] - expected)*(observed[i] - expected)/expected;
+    ++nofBins;
+  }
+  if ( lowExpected > 0. ) {
+    chi2 += (lowObserved - lowExpected)*(lowObserved - lowExpected)/lowExpected;
+    ++nofBins;
+  }
+
+  // the total is fixed
+  ndf = nofBins - 1;
+  return chi2;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double KolmogorovProbability(G4double distance, G4long n)
+{
+  if ( n <= 0 ) return 1.;
+
+  // asymptotic distribution, with the small-sample correction of Stephens
+  G4double sqrtN = std::sqrt(G4double(n));
+  G4double lambda = (sqrtN + 0.12 + 0.11/sqrtN)*distance;
+  if ( lambda < 0.2 ) return 1.;
+
+  G4double sum = 0., sign = 1.;
+  for ( G4int j=1; j<=100; ++j ) {
+    G4double term = sign*2.*std::exp(-2.*j*j*lambda*lambda);
+    sum += term;
+    if ( std::fabs(term) < 1.e-12*std::fabs(sum) ) break;
+    sign = -sign;
+  }
+  return std::min(1., std::max(0., sum));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
+}
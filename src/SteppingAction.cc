@@ -0,0 +1,70 @@
+/// \file SteppingAction.cc
+/// \brief Implementation of the B4c::SteppingAction class
+
+#include "SteppingAction.hh"
+#include "AcceptanceMap.hh"
+#include "EventAction.hh"
+#include "EscapeFilter.hh"
+#include "Run.hh"
+
+#include "G4RunManager.hh"
+#include "G4Step.hh"
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SteppingAction::SteppingAction(EventAction* eventAction)
+  : fEventAction(eventAction)
+{}
+
+SteppingAction::~SteppingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SteppingAction::UserSteppingAction(const G4Step* step)
+{
+  fEventAction->AddStep();
+
+  // energy deposit
+  auto edep = step->GetTotalEnergyDeposit();
+  if ( edep != 0. ) {
+    // volume of the current step
+    auto touchable = step->GetPreStepPoint()->GetTouchable();
+    auto volume = touchable->GetVolume()->GetLogicalVolume();
+
+    auto& budget = fEventAction->GetEnergyBudget();
+    auto index = budget.GetIndex(volume);
+    budget.Add(index, edep);
+
+    // the modules are the daughters of the world
+    auto acceptanceMap = fEventAction->GetAcceptanceMap();
+    if ( index == EnergyBudget::kDiode && acceptanceMap && acceptanceMap->IsEnabled() ) {
+      acceptanceMap->AddModuleEdep(fEventAction->GetCurrentPrimary(),
+                                   touchable->GetCopyNumber(touchable->GetHistoryDepth()-1), edep);
+    }
+  }
+
+  // kill a primary leaving the array when it cannot reach it again
+  auto track = step->GetTrack();
+  if ( track->GetParentID() != 0 ) return;
+
+  const auto& escapeFilter = fEventAction->GetEscapeFilter();
+  if ( ! escapeFilter.IsActive() ) return;
+
+  auto postStepPoint = step->GetPostStepPoint();
+  if ( postStepPoint->GetPhysicalVolume() != escapeFilter.GetWorld() ) return;
+  if ( track->GetTrackStatus() != fAlive ) return;
+
+  if ( escapeFilter.IsEscaping(postStepPoint->GetPosition(), postStepPoint->GetMomentumDirection()) ) {
+    track->SetTrackStatus(fStopAndKill);
+    auto run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+    run->AddEscaped();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
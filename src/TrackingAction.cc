@@ -0,0 +1,45 @@
+/// \file TrackingAction.cc
+/// \brief Implementation of the B4c::TrackingAction class
+
+#include "TrackingAction.hh"
+#include "EventAction.hh"
+#include "EscapeFilter.hh"
+#include "Run.hh"
+
+#include "G4RunManager.hh"
+#include "G4Track.hh"
+
+namespace B4c
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrackingAction::TrackingAction(EventAction* eventAction)
+  : fEventAction(eventAction)
+{}
+
+TrackingAction::~TrackingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingAction::PreUserTrackingAction(const G4Track* track)
+{
+  fEventAction->SetCurrentPrimary(track);
+
+  if ( track->GetParentID() != 0 ) return;
+
+  const auto& escapeFilter = fEventAction->GetEscapeFilter();
+  if ( ! escapeFilter.IsActive() ) return;
+  if ( track->GetVolume() != escapeFilter.GetWorld() ) return;
+
+  if ( escapeFilter.IsEscaping(track->GetPosition(), track->GetMomentumDirection()) ) {
+    const_cast<G4Track*>(track)->SetTrackStatus(fStopAndKill);
+    auto run = static_cast<Run*>(G4RunManager::GetRunManager()->GetNonConstCurrentRun());
+    run->AddEscaped();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}
@@ -0,0 +1,221 @@
+/// \file WorkerInitialization.cc
+/// \brief Implementation of the B4c::WorkerInitialization class
+
+#include "WorkerInitialization.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace B4c
+{
+
+namespace
+{
+const char* kPolicyNames[] = { "none", "compact", "scatter", "numa" };
+
+#ifdef __linux__
+// a value of a /sys file, or the default if it cannot be read
+G4int ReadValue(const std::string& path, G4int defaultValue)
+{
+  std::ifstream file(path.c_str());
+  G4int value = defaultValue;
+  if ( ! (file >> value) ) return defaultValue;
+  return value;
+}
+
+// a CPU list of /sys, e.g. "0-7,16-23"
+std::vector<G4int> ReadCpuList(const std::string& path)
+{
+  std::vector<G4int> cpus;
+  std::ifstream file(path.c_str());
+  std::string list;
+  if ( ! (file >> list) ) return cpus;
+
+  std::istringstream is(list);
+  std::string range;
+  while ( std::getline(is, range, ',') ) {
+    auto dash = range.find('-');
+    auto first = std::stoi(range.substr(0, dash));
+    auto last = ( dash == std::string::npos ) ? first : std::stoi(range.substr(dash+1));
+    for ( G4int cpu=first; cpu<=last; ++cpu ) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+WorkerInitialization::WorkerInitialization()
+{
+  fMessenger = new G4GenericMessenger(this, "/B4/affinity/", "Worker thread pinning");
+
+  fMessenger->DeclareMethod("policy", &WorkerInitialization::SetPolicy)
+    .SetGuidance("Pinning of the worker threads, before the first run:")
+    .SetGuidance("  none: not pinned")
+    .SetGuidance("  compact: fill a socket, sharing the cores, before the next one")
+    .SetGuidance("  scatter: alternate between the NUMA nodes, one thread per core first")
+    .SetGuidance("  numa: alternate between the NUMA nodes, free within the node")
+    .SetParameterName("policy", false)
+    .SetCandidates("none compact scatter numa")
+    .SetToBeBroadcasted(false);
+}
+
+WorkerInitialization::~WorkerInitialization()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorkerInitialization::SetPolicy(const G4String& value)
+{
+  fPolicy = kNone;
+  for ( auto policy : { kCompact, kScatter, kNuma } ) {
+    if ( value == kPolicyNames[policy] ) fPolicy = policy;
+  }
+  if ( fPolicy == kNone ) return;
+
+  fCpus = ReadTopology();
+  if ( fCpus.empty() ) {
+    fPolicy = kNone;
+    G4ExceptionDescription msg;
+    msg << "Cannot read the CPU topology (Linux only); the workers are not pinned.";
+    G4Exception("WorkerInitialization::SetPolicy()", "MyCode0017", JustWarning, msg);
+    return;
+  }
+
+  // compact: a core, then a socket, then a node at a time
+  std::sort(fCpus.begin(), fCpus.end(), [](const Cpu& a, const Cpu& b) {
+    return std::tie(a.node, a.package, a.core, a.id) < std::tie(b.node, b.package, b.core, b.id);
+  });
+
+  // scatter: per node, one hyperthread of each core first
+  std::map<G4int, std::vector<Cpu>> nodes;
+  for ( const auto& cpu : fCpus ) nodes[cpu.node].push_back(cpu);
+  fNodeCpus.clear();
+  for ( auto& node : nodes ) {
+    std::sort(node.second.begin(), node.second.end(), [](const Cpu& a, const Cpu& b) {
+      return std::tie(a.sibling, a.package, a.core, a.id)
+           < std::tie(b.sibling, b.package, b.core, b.id);
+    });
+    fNodeCpus.push_back(node.second);
+  }
+
+  G4cout << "--> Worker threads pinned (" << kPolicyNames[fPolicy] << ") on " << fCpus.size()
+         << " CPUs, " << fNodeCpus.size() << " NUMA node(s)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<WorkerInitialization::Cpu> WorkerInitialization::ReadTopology()
+{
+  std::vector<Cpu> cpus;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ) return cpus;
+
+  // node of each CPU; a single node if the system has no NUMA information
+  std::map<G4int, G4int> nodeOf;
+  const std::string nodeDir = "/sys/devices/system/node";
+  if ( auto dir = opendir(nodeDir.c_str()) ) {
+    while ( auto entry = readdir(dir) ) {
+      std::string name(entry->d_name);
+      if ( name.compare(0, 4, "node") != 0 || name.size() == 4
+           || name.find_first_not_of("0123456789", 4) != std::string::npos ) continue;
+      auto node = std::stoi(name.substr(4));
+      for ( auto cpu : ReadCpuList(nodeDir + "/" + name + "/cpulist") ) nodeOf[cpu] = node;
+    }
+    closedir(dir);
+  }
+
+  for ( G4int id=0; id<CPU_SETSIZE; ++id ) {
+    if ( ! CPU_ISSET(id, &allowed) ) continue;
+    auto topology = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+    Cpu cpu;
+    cpu.id = id;
+    cpu.node = nodeOf.count(id) ? nodeOf[id] : 0;
+    cpu.package = ReadValue(topology + "physical_package_id", 0);
+    cpu.core = ReadValue(topology + "core_id", id);
+    cpus.push_back(cpu);
+  }
+
+  // the hyperthreads of a core are ranked by CPU number
+  for ( auto& cpu : cpus ) {
+    cpu.sibling = G4int(std::count_if(cpus.begin(), cpus.end(), [&cpu](const Cpu& other) {
+      return other.package == cpu.package && other.core == cpu.core && other.id < cpu.id;
+    }));
+  }
+#endif
+  return cpus;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4int> WorkerInitialization::GetCpus(G4int worker) const
+{
+  // more workers than CPUs wrap around
+  std::vector<G4int> ids;
+  switch ( fPolicy ) {
+    case kCompact:
+      ids.push_back(fCpus[worker % fCpus.size()].id);
+      break;
+    case kScatter: {
+      const auto& node = fNodeCpus[worker % fNodeCpus.size()];
+      ids.push_back(node[(worker / fNodeCpus.size()) % node.size()].id);
+      break;
+    }
+    case kNuma:
+      for ( const auto& cpu : fNodeCpus[worker % fNodeCpus.size()] ) ids.push_back(cpu.id);
+      break;
+    case kNone:
+      break;
+  }
+  return ids;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorkerInitialization::WorkerInitialize() const
+{
+  if ( fPolicy == kNone ) return;
+
+#ifdef __linux__
+  auto worker = G4Threading::G4GetThreadId();
+  if ( worker < 0 ) return;
+
+  auto ids = GetCpus(worker);
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for ( auto id : ids ) CPU_SET(id, &cpus);
+
+  if ( pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0 ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot pin worker " << worker << "; it is not pinned.";
+    G4Exception("WorkerInitialization::WorkerInitialize()", "MyCode0017", JustWarning, msg);
+    return;
+  }
+
+  G4cout << "--> Worker " << worker << " pinned to CPU";
+  if ( ids.size() == 1 ) G4cout << " " << ids[0];
+  else G4cout << "s of NUMA node " << fNodeCpus[worker % fNodeCpus.size()][0].node;
+  G4cout << G4endl;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}